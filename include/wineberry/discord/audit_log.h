@@ -19,8 +19,8 @@ struct winecord_get_guild_audit_log {
     u64snowflake user_id;
     /** the type of audit log event */
     int action_type;
-    /** the number of entries before a certain entry */
-    int before;
+    /** filter the log before a certain entry id */
+    u64snowflake before;
     /** the maximum number of entries to return (1-100) */
     int limit;
 };
@@ -49,6 +49,10 @@ extern "C" {
 /** @brief dup shutdown fd to listen for winecord_shutdown_async() */
 int winecord_dup_shutdown_fd(void);
 
+/** @brief Get the process-wide curl share, `NULL` unless enabled with
+ *      wineberry_global_share_enable() */
+CURLSH *winecord_global_share(void);
+
 /** @brief Get client from its nested field */
 #define CLIENT(ptr, path) CONTAINEROF(ptr, struct winecord, path)
 
@@ -190,6 +194,417 @@ unsigned winecord_internal_timer(struct winecord *client,
  * @brief Store, manage and dispatch individual requests
  *  @{ */
 
+/** @defgroup WinecordInternalRESTRequestMetrics Metrics
+ * @brief Counters and latency histograms of routes
+ *  @{ */
+
+/** amount of a latency histogram's upper bounds, excluding `+Inf` */
+#define WINECORD_HISTOGRAM_LEN 12
+
+/**
+ * @brief Latency histogram
+ * @note updated from the `REST` thread, read atomically from any thread
+ */
+struct winecord_histogram {
+    /** observations per upper bound (declared at winecord-rest_metrics.c),
+     *      the last one counts observations past every bound */
+    uint64_t counts[WINECORD_HISTOGRAM_LEN + 1];
+    /** sum of observations (in microseconds) */
+    uint64_t sum;
+};
+
+/**
+ * @brief Counters and latencies of a bucket's route
+ * @note updated from the `REST` thread, read atomically from any thread
+ */
+struct winecord_metrics {
+    /** requests that have been completed */
+    uint64_t requests;
+    /** requests that have been retried */
+    uint64_t retries;
+    /** `GET` requests that have been duplicated for being slow
+     *      @see winecord_rest_set_hedging() */
+    uint64_t hedges;
+    /** `429 Too Many Requests` responses by their scope */
+    struct {
+        /** bot-wide ratelimit */
+        uint64_t global;
+        /** the bucket's own ratelimit */
+        uint64_t bucket;
+        /** ratelimit shared by every bot accessing the resource */
+        uint64_t shared;
+    } ratelimited;
+    /** time waited before being assigned to the bucket */
+    struct winecord_histogram queue_wait;
+    /** time waited at the bucket before being sent */
+    struct winecord_histogram ratelimit_wait;
+    /** time taken by the HTTP transfer */
+    struct winecord_histogram http;
+};
+
+/**
+ * @brief Record an observation to a latency histogram
+ *
+ * @param hist the histogram to be updated
+ * @param elapsed_us the observation (in microseconds)
+ */
+void winecord_metrics_observe(struct winecord_histogram *hist,
+                              int64_t elapsed_us);
+
+/**
+ * @brief Estimate a quantile of a latency histogram
+ *
+ * @param hist the histogram to be read from
+ * @param q the quantile, between `0` and `1`
+ * @param min_count observations needed for the estimate to be trusted
+ * @return the upper bound (in microseconds) of the quantile's bucket, or `-1`
+ *      if there are too few observations or it lies past every bound
+ */
+int64_t winecord_metrics_quantile(const struct winecord_histogram *hist,
+                                  double q,
+                                  uint64_t min_count);
+
+/**
+ * @brief Write the metrics of every route in the Prometheus text format
+ *
+ * @param rest the handle initialized with winecord_rest_init()
+ * @param fp the stream to write to
+ */
+void winecord_metrics_write(struct winecord_rest *rest, FILE *fp);
+
+/**
+ * @brief Stop serving metrics from the Unix socket, if any
+ * @note connections that metrics are still being sent to are closed
+ * @see winecord_rest_metrics_serve()
+ *
+ * @param rest the handle initialized with winecord_rest_init()
+ */
+void winecord_metrics_cleanup(struct winecord_rest *rest);
+
+/** @} WinecordInternalRESTRequestMetrics */
+
+/** @defgroup WinecordInternalRESTRequestFairness Fair queuing
+ * @brief Weights of the tenants that requests are fairly queued by
+ *  @{ */
+
+/** virtual time a request of a tenant of weight `1` takes up */
+#define WINECORD_FAIR_QUANTUM 65536
+
+/** @brief Weights of the tenants that requests are fairly queued by */
+struct winecord_tenants {
+    /** tenants that have been assigned a weight, indexed by their key */
+    struct {
+        /** amount of tenants assigned a weight */
+        int length;
+        /** cap before increase */
+        int capacity;
+        /** @note datatype declared at winecord-rest_fairness.c */
+        struct _winecord_tenant *buckets;
+    } weights;
+
+    /** lock for accessing weights from multiple threads */
+    pthread_mutex_t lock;
+};
+
+/**
+ * @brief Initialize the tenants weights
+ *
+ * @param tenants the tenants weights to be initialized
+ */
+void winecord_tenants_init(struct winecord_tenants *tenants);
+
+/**
+ * @brief Free the tenants weights
+ *
+ * @param tenants the handle initialized with winecord_tenants_init()
+ */
+void winecord_tenants_cleanup(struct winecord_tenants *tenants);
+
+/**
+ * @brief Get the tenant of the calling thread's context, that requests made
+ *      from it are fairly queued by if they don't set their own
+ *
+ * @return the tenant set by winecord_tenant_context_swap(), `0` if none
+ */
+u64snowflake winecord_tenant_context_get(void);
+
+/**
+ * @brief Set the tenant of the calling thread's context (e.g. the guild of
+ *      the Gateway event whose callbacks are being executed)
+ *
+ * @param tenant the context's tenant, `0` for none
+ * @return the previous tenant, to be restored once the context is left
+ */
+u64snowflake winecord_tenant_context_swap(u64snowflake tenant);
+
+/**
+ * @brief Get a tenant's weight
+ *
+ * @param tenants the handle initialized with winecord_tenants_init()
+ * @param tenant the tenant's key
+ * @return the tenant's weight, `1` if it hasn't been assigned one
+ */
+int winecord_tenants_get_weight(struct winecord_tenants *tenants,
+                                u64snowflake tenant);
+
+struct winecord_request;
+
+/**
+ * @brief Requests queued at a bucket, each tenant with a queue of its own
+ * @note the next request is taken from the head of the tenants' queues,
+ *      without walking the requests queued behind them
+ */
+struct winecord_flows {
+    /** tenants that have requests queued, indexed by their key */
+    struct {
+        /** amount of tenants that have requests queued */
+        int length;
+        /** cap before increase */
+        int capacity;
+        /** @note datatype declared at winecord-rest_fairness.c */
+        struct _winecord_flows_entry *buckets;
+    } tenants;
+    /**
+     * tenants' queues, ordered by their next request
+     * @note datatype declared at winecord-rest_fairness.c
+     */
+    QUEUE(struct _winecord_flow) queue;
+};
+
+/**
+ * @brief Initialize the tenants' queues of a bucket
+ *
+ * @param flows the tenants' queues to be initialized
+ */
+void winecord_flows_init(struct winecord_flows *flows);
+
+/**
+ * @brief Free the tenants' queues of a bucket
+ * @note the queued requests are left untouched
+ *
+ * @param flows the handle initialized with winecord_flows_init()
+ */
+void winecord_flows_cleanup(struct winecord_flows *flows);
+
+/**
+ * @brief Get the finish tag of a tenant's last queued request
+ *
+ * @param flows the handle initialized with winecord_flows_init()
+ * @param tenant the tenant's key
+ * @return the finish tag, `0` if the tenant has no requests queued
+ */
+uint64_t winecord_flows_get_finish(struct winecord_flows *flows,
+                                   u64snowflake tenant);
+
+/**
+ * @brief Queue a request at its tenant's queue
+ *
+ * @param flows the handle initialized with winecord_flows_init()
+ * @param req the request to be queued, its fair queuing tags already set
+ * @param high_priority if `true` then request goes before every other
+ *      queued request (e.g. a retry)
+ */
+void winecord_flows_insert(struct winecord_flows *flows,
+                           struct winecord_request *req,
+                           bool high_priority);
+
+/**
+ * @brief Remove a request from its tenant's queue
+ *
+ * @param flows the handle initialized with winecord_flows_init()
+ * @param req the queued request to be removed
+ */
+void winecord_flows_remove(struct winecord_flows *flows,
+                           struct winecord_request *req);
+
+/**
+ * @brief Get the next request to be sent
+ *
+ * @param flows the handle initialized with winecord_flows_init()
+ * @return the request, NULL if none is queued
+ */
+struct winecord_request *winecord_flows_peek(struct winecord_flows *flows);
+
+/** @} WinecordInternalRESTRequestFairness */
+
+/** @defgroup WinecordInternalRESTRequestWebhooks Webhook executor
+ * @brief Per-webhook queues of embeds, merged into as few messages as
+ *      possible
+ *  @{ */
+
+/** @brief The webhook executor's queues */
+struct winecord_webhooks {
+    /** `WINECORD_WEBHOOKS` logging module */
+    struct logconf conf;
+
+    /** webhook queues, indexed by the webhook's id */
+    struct {
+        /** amount of webhooks that have been pushed to */
+        int length;
+        /** cap before increase */
+        int capacity;
+        /** @note datatype declared at winecord-rest_webhooks.c */
+        struct _winecord_webhooks_entry *buckets;
+    } queues;
+
+    /** lock for accessing the queues from multiple threads */
+    pthread_mutex_t lock;
+};
+
+/**
+ * @brief Initialize the webhook executor
+ *
+ * @param webhooks the webhook executor to be initialized
+ * @param conf pointer to @ref winecord_rest logging module
+ */
+void winecord_webhooks_init(struct winecord_webhooks *webhooks,
+                            struct logconf *conf);
+
+/**
+ * @brief Free the webhook executor, dropping embeds that haven't been sent
+ *
+ * @param webhooks the handle initialized with winecord_webhooks_init()
+ */
+void winecord_webhooks_cleanup(struct winecord_webhooks *webhooks);
+
+/** @} WinecordInternalRESTRequestWebhooks */
+
+/** @defgroup WinecordInternalRESTRequestBans Bulk bans
+ * @brief Bans of a guild coalesced into bulk bans
+ *  @{ */
+
+/** max amount of users per bulk ban */
+#define WINECORD_BULK_BAN_MAX 200
+
+/** @brief Bans waiting to be coalesced, per guild */
+struct winecord_bans {
+    /** `WINECORD_BANS` logging module */
+    struct logconf conf;
+    /** time bans are collected for, `0` if disabled
+     *      @see winecord_rest_set_ban_coalescing() */
+    u64unix_ms window;
+    /** `true` while a timer is set to send the batches that are due */
+    bool is_scheduled;
+
+    /** batches being collected, indexed by their guild's id */
+    struct {
+        /** amount of guilds that have a batch */
+        int length;
+        /** cap before increase */
+        int capacity;
+        /** @note datatype declared at winecord-rest_bans.c */
+        struct _winecord_bans_entry *buckets;
+    } batches;
+
+    /** lock for accessing the batches from multiple threads */
+    pthread_mutex_t lock;
+};
+
+/**
+ * @brief Initialize the bans coalescer
+ *
+ * @param bans the bans coalescer to be initialized
+ * @param conf pointer to @ref winecord_rest logging module
+ */
+void winecord_bans_init(struct winecord_bans *bans, struct logconf *conf);
+
+/**
+ * @brief Free the bans coalescer, dropping bans that haven't been sent
+ *
+ * @param bans the handle initialized with winecord_bans_init()
+ */
+void winecord_bans_cleanup(struct winecord_bans *bans);
+
+/**
+ * @brief Coalesce a ban into its guild's next bulk ban
+ *
+ * @param client the client created with winecord_init()
+ * @param guild_id the guild the user belongs to
+ * @param user_id the user to be banned
+ * @param params the ban's parameters
+ * @param ret the ban's return handle, its callbacks are executed once the
+ *      bulk ban completes
+ * @return `true` if the ban has been coalesced, `false` if it must be
+ *      performed on its own
+ */
+bool winecord_bans_coalesce(struct winecord *client,
+                            u64snowflake guild_id,
+                            u64snowflake user_id,
+                            struct winecord_create_guild_ban *params,
+                            struct winecord_ret *ret);
+
+/** @} WinecordInternalRESTRequestBans */
+
+/** @defgroup WinecordInternalRESTRequestRoles Role changes
+ * @brief Role changes of a guild member coalesced into as few requests as
+ *      possible
+ *  @{ */
+
+/** @brief Role changes waiting to be coalesced, per guild member */
+struct winecord_role_deltas {
+    /** `WINECORD_ROLES` logging module */
+    struct logconf conf;
+    /** time role changes are collected for, `0` if disabled
+     *      @see winecord_rest_set_role_coalescing() */
+    u64unix_ms window;
+    /** `true` while a timer is set to send the changes that are due */
+    bool is_scheduled;
+
+    /** changes being collected, indexed by `<guild_id>:<user_id>` */
+    struct {
+        /** amount of members that have changes */
+        int length;
+        /** cap before increase */
+        int capacity;
+        /** @note datatype declared at winecord-rest_roles.c */
+        struct _winecord_role_deltas_entry *buckets;
+    } members;
+
+    /** lock for accessing the changes from multiple threads */
+    pthread_mutex_t lock;
+};
+
+/**
+ * @brief Initialize the role changes coalescer
+ *
+ * @param deltas the role changes coalescer to be initialized
+ * @param conf pointer to @ref winecord_rest logging module
+ */
+void winecord_role_deltas_init(struct winecord_role_deltas *deltas,
+                               struct logconf *conf);
+
+/**
+ * @brief Free the role changes coalescer, dropping changes that haven't been
+ *      sent
+ *
+ * @param deltas the handle initialized with winecord_role_deltas_init()
+ */
+void winecord_role_deltas_cleanup(struct winecord_role_deltas *deltas);
+
+/**
+ * @brief Coalesce a role change into its member's next requests
+ *
+ * @param client the client created with winecord_init()
+ * @param guild_id the guild the member belongs to
+ * @param user_id the member's user id
+ * @param role_id the role to be added or removed
+ * @param is_added `true` if the role is added, `false` if removed
+ * @param reason the change's audit log reason, may be `NULL`
+ * @param ret the change's return handle, its callbacks are executed once
+ *      the requests its change has been sent with complete
+ * @return `true` if the change has been coalesced, `false` if it must be
+ *      performed on its own
+ */
+bool winecord_role_deltas_coalesce(struct winecord *client,
+                                   u64snowflake guild_id,
+                                   u64snowflake user_id,
+                                   u64snowflake role_id,
+                                   bool is_added,
+                                   const char reason[],
+                                   struct winecord_ret *ret);
+
+/** @} WinecordInternalRESTRequestRoles */
+
 /** @defgroup WinecordInternalRESTRequestRatelimit Ratelimiting
  * @brief Enforce ratelimiting per the official Winecord Documentation
  *  @{ */
@@ -200,6 +615,20 @@ unsigned winecord_internal_timer(struct winecord *client,
  */
 #define WINECORD_BUCKET_TIMEOUT (void *)(0xf)
 
+/**
+ * @brief Client-side global ratelimit shared by every `REST` thread
+ *
+ * Requests are spaced by `1000 / rate` milliseconds, allowing for bursts of
+ *      up to `rate` requests (i.e. a token bucket refilled every second)
+ */
+struct winecord_global_ratelimit {
+    /** requests per second, `0` to disable @see winecord_rest_set_rate() */
+    long rate;
+    /** theoretical timestamp (in microseconds) of when the next request
+     *      would be sent if requests were perfectly spaced */
+    u64unix_ms arrival_tstamp;
+};
+
 /**
  * @brief The ratelimiter struct for handling ratelimiting
  * @note this struct **SHOULD** only be handled from the `REST` manager thread
@@ -216,15 +645,30 @@ struct winecord_ratelimiter {
      * @note datatype declared at winecord-rest_ratelimit.c
      */
     struct _winecord_route *routes;
-    /** singleton bucket for requests that haven't been matched to a
-     *      known or new bucket (i.e first time running the request) */
-    struct winecord_bucket *null;
-    /** singleton bucket for requests that are not part of any known
-     *      ratelimiting group */
-    struct winecord_bucket *miss;
 
     /* client-wide global ratelimiting */
     u64unix_ms *global_wait_tstamp;
+    /**
+     * client-side global ratelimit, so that the global ratelimit is never hit
+     *      by bursts of requests spread across many buckets
+     * @note shared by every `REST` thread, and only updated atomically
+     */
+    struct winecord_global_ratelimit *global;
+    /** whether a timer has been set to wait for the global ratelimit */
+    bool is_global_waiting;
+    /** virtual time of fair queuing, the start tag of the last request
+     *      selected @see winecord_bucket_insert() */
+    uint64_t vtime;
+
+    /**
+     * lock for inspecting the routes from other threads
+     * @note only held by the `REST` thread when adding routes
+     */
+    pthread_mutex_t lock;
+
+    /** file where discovered routes are persisted to, so that they are
+     *      known from startup at the next run */
+    char *persist_path;
 
     /** bucket queues */
     struct {
@@ -236,13 +680,38 @@ struct winecord_ratelimiter {
 /**
  * @brief Initialize ratelimiter handle
  *
- * A hashtable shall be used for storage and retrieval of discovered buckets
+ * A hashtable shall be used for storage and retrieval of discovered buckets,
+ *      routes persisted by a previous run (see `winecord.ratelimit_file` at
+ *      the config file) are preloaded to it, if assigned to its `REST` thread
+ * @note the global ratelimit is shared with the first `REST` thread's
+ *      ratelimiter, so it must be initialized first
  * @param rl the ratelimiter handle to be initialized
  * @param conf pointer to @ref winecord_rest logging module
  */
 void winecord_ratelimiter_init(struct winecord_ratelimiter *rl,
                               struct logconf *conf);
 
+/**
+ * @brief Preload routes persisted at `path` that are assigned to the
+ *      ratelimiter's `REST` thread, and persist discovered routes to it at
+ *      winecord_ratelimiter_save()
+ *
+ * @param rl the handle initialized with winecord_ratelimiter_init()
+ * @param path the file that discovered routes are persisted to
+ * @note routes are preloaded from the ratelimiter's `REST` thread, so this
+ *      may be called from any thread
+ */
+void winecord_ratelimiter_persist(struct winecord_ratelimiter *rl,
+                                 const char path[]);
+
+/**
+ * @brief Persist the routes discovered by every `REST` thread
+ * @note must be called before any of the ratelimiters is cleaned up
+ *
+ * @param rl the first `REST` thread's ratelimiter
+ */
+void winecord_ratelimiter_save(struct winecord_ratelimiter *rl);
+
 /**
  * @brief Cleanup all buckets that have been discovered
  *
@@ -251,6 +720,23 @@ void winecord_ratelimiter_init(struct winecord_ratelimiter *rl,
  */
 void winecord_ratelimiter_cleanup(struct winecord_ratelimiter *rl);
 
+/**
+ * @brief Iterate over every route discovered by the ratelimiter
+ * @note may be called from any thread, the bucket's fields must be read
+ *      atomically
+ *
+ * @param rl the handle initialized with winecord_ratelimiter_init()
+ * @param iter the callback executed for each route, given its key and its
+ *      bucket's hash
+ * @param data user arbitrary data to be passed to `iter`
+ */
+void winecord_ratelimiter_foreach(struct winecord_ratelimiter *rl,
+                                 void (*iter)(void *data,
+                                              const char key[],
+                                              const char hash[],
+                                              struct winecord_bucket *b),
+                                 void *data);
+
 /**
  * @brief Build unique key formed from the HTTP method and endpoint
  * @see https://winecord.com/developers/docs/topics/rate-limits
@@ -265,14 +751,32 @@ void winecord_ratelimiter_build_key(enum http_method method,
                                    const char endpoint_fmt[],
                                    va_list args);
 
+/**
+ * @brief Hash the major parameter (channel, guild or webhook id) of a key
+ *
+ * @param key obtained from winecord_ratelimiter_build_key()
+ * @return hash of the key's major parameter, or of the whole key if it has
+ *      none
+ */
+unsigned long winecord_ratelimiter_hash_major(const char key[]);
+
+/**
+ * @brief Get the major parameter (channel, guild or webhook id) of a key
+ *
+ * @param key obtained from winecord_ratelimiter_build_key()
+ * @return the key's major parameter, `0` if it has none
+ */
+u64snowflake winecord_ratelimiter_get_major(const char key[]);
+
 /**
  * @brief Update the bucket with response header data
  *
  * @param rl the handle initialized with winecord_ratelimiter_init()
- * @param bucket NULL when bucket is first discovered
+ * @param bucket the bucket the request was sent from
  * @param key obtained from winecord_ratelimiter_build_key()
  * @param info informational struct containing details on the current transfer
- * @note If the bucket was just discovered it will be created here.
+ * @note If the bucket is provisional it will be matched to its ratelimiting
+ *      group here.
  */
 void winecord_ratelimiter_build(struct winecord_ratelimiter *rl,
                                struct winecord_bucket *bucket,
@@ -301,6 +805,27 @@ struct winecord_bucket {
     long remaining;
     /** timestamp of when cooldown timer resets */
     u64unix_ms reset_tstamp;
+    /**
+     * `true` if the bucket's route hasn't received a response yet, so its
+     *      ratelimiting group is unknown
+     * @note provisional buckets are limited to a single request at a time
+     */
+    bool is_provisional;
+    /** retry state of the bucket's route @see winecord_retry */
+    struct {
+        /** retries spent that haven't been paid back by sent requests */
+        double spent;
+        /** consecutive failed requests */
+        int failures;
+        /** timestamp of when the open circuit lets a request through, `0`
+         *      if the circuit is closed */
+        u64unix_ms open_tstamp;
+        /** `true` while the circuit is half-open: its cooldown is over, and
+         *      the single request it has let through is in flight */
+        bool is_probing;
+    } retry;
+    /** counters and latencies of the bucket's route */
+    struct winecord_metrics metrics;
 
     /**
      * pointer to this bucket's currently busy request
@@ -310,11 +835,30 @@ struct winecord_bucket {
 
     /** request queues */
     struct {
-        /** next requests queue */
-        QUEUE(struct winecord_request) next;
+        /** next requests queue, kept per tenant for fair queuing */
+        struct winecord_flows next;
     } queues;
+    /**
+     * the next requests that have a deadline, as a min-heap ordered by it
+     * @note so expired requests are found without walking the whole queue
+     */
+    struct {
+        /** heap array, its first request has the earliest deadline */
+        struct winecord_request **array;
+        /** amount of requests in the heap */
+        int size;
+        /** allocated capacity of the heap */
+        int realsize;
+    } deadlines;
     /** entry for @ref winecord_ratelimiter pending buckets queue */
     QUEUE entry;
+    /**
+     * `true` if its next request has changed since the bucket has been
+     *      positioned at the pending buckets queue
+     * @note the queue is kept ordered by the buckets' next requests, so only
+     *      these have to be positioned again
+     */
+    bool has_new_head;
 };
 
 /**
@@ -331,7 +875,7 @@ void winecord_bucket_set_timeout(struct winecord_bucket *bucket,
  *
  * @param rl the handle initialized with winecord_ratelimiter_init()
  * @param key obtained from winecord_ratelimiter_build_key()
- * @return bucket matched to `key`
+ * @return bucket matched to `key`, a provisional one if none is known yet
  */
 struct winecord_bucket *winecord_bucket_get(struct winecord_ratelimiter *rl,
                                           const char key[]);
@@ -342,25 +886,58 @@ struct winecord_bucket *winecord_bucket_get(struct winecord_ratelimiter *rl,
  * @param rl the handle initialized with winecord_ratelimiter_init()
  * @param b the bucket to insert the request to
  * @param req the request to be inserted to bucket
- * @param high_priority if high priority then request shall be prioritized over
- *      already enqueued requests
+ * @param high_priority if `true` then request is inserted at the queue's head
+ *      (e.g. a retry), otherwise it is ordered by its scheduling class,
+ *      deadline, and then fairly among tenants (by weighted fair queuing)
  */
 void winecord_bucket_insert(struct winecord_ratelimiter *rl,
                            struct winecord_bucket *b,
                            struct winecord_request *req,
                            bool high_priority);
 
+/**
+ * @brief Remove a request from its bucket's next requests queue
+ *
+ * @param b the bucket that the request has been inserted to
+ * @param req the request to be removed from the bucket
+ */
+void winecord_bucket_remove(struct winecord_bucket *b,
+                           struct winecord_request *req);
+
+/**
+ * @brief Get the scheduling class of a request
+ *
+ * @param req the request to be checked
+ * @return the request's @ref winecord_priority, at least
+ *      `WINECORD_PRIORITY_HIGH` if `high_priority` has been set
+ */
+int winecord_request_get_class(const struct winecord_request *req);
+
+/**
+ * @brief Check if a request should be sent before another
+ *
+ * @param a the request to be checked
+ * @param b the request to be checked against
+ * @return `true` if `a` has a higher class, then an earlier deadline, and
+ *      then an earlier fair queuing finish tag than `b`
+ */
+bool winecord_request_precedes(const struct winecord_request *a,
+                               const struct winecord_request *b);
+
 /**
  * @brief Iterate and select next requests
  * @note winecord_bucket_unselect() must be called once bucket's current request
  *      is done and its next one should be selected
  *
  * @param rl the handle initialized with winecord_ratelimiter_init()
+ * @param budget max amount of requests to be selected, the remaining ones
+ *      are kept pending
  * @param data user arbitrary data
  * @param iter the user callback to be called per bucket
  */
 void winecord_bucket_request_selector(
     struct winecord_ratelimiter *rl,
+    int budget,
     void *data,
     void (*iter)(void *data, struct winecord_request *req));
 
@@ -376,13 +953,128 @@ void winecord_bucket_request_unselect(struct winecord_ratelimiter *rl,
                                      struct winecord_bucket *b,
                                      struct winecord_request *req);
 
+/**
+ * @brief Take a spare request from the bucket of a request in flight, so that
+ *      it may be duplicated
+ *
+ * @param rl the handle initialized with winecord_ratelimiter_init()
+ * @param b the request's bucket
+ * @param req the request in flight
+ * @return `true` if both the bucket and the global ratelimit have a request
+ *      to spare
+ */
+bool winecord_bucket_hedge_take(struct winecord_ratelimiter *rl,
+                               struct winecord_bucket *b,
+                               struct winecord_request *req);
+
 /** @} WinecordInternalRESTRequestRatelimit */
 
+/** @defgroup WinecordInternalRESTRequestRetry Retry policies
+ * @brief Backoff, retry budgets and circuit breaking of failed requests
+ *  @{ */
+
+/**
+ * @brief Retry policies of routes
+ * @note the retry state of each route is kept at its @ref winecord_bucket
+ */
+struct winecord_retry {
+    /** `WINECORD_RETRY` logging module */
+    struct logconf conf;
+    /** policy of routes that haven't been individually assigned one */
+    struct winecord_retry_policy default_policy;
+
+    /** routes policies, indexed by their endpoint format string */
+    struct {
+        /** amount of routes assigned a policy */
+        int length;
+        /** cap before increase */
+        int capacity;
+        /** @note datatype declared at winecord-rest_retry.c */
+        struct _winecord_retry_route *buckets;
+    } routes;
+
+    /** seed for the backoff jitter */
+    unsigned seed;
+    /** lock for accessing policies and seed from multiple threads */
+    pthread_mutex_t lock;
+};
+
+/**
+ * @brief Initialize the retry policies
+ *
+ * @param retry the retry policies to be initialized
+ * @param conf pointer to @ref winecord_requestor logging module
+ */
+void winecord_retry_init(struct winecord_retry *retry, struct logconf *conf);
+
+/**
+ * @brief Free the retry policies
+ *
+ * @param retry the handle initialized with winecord_retry_init()
+ */
+void winecord_retry_cleanup(struct winecord_retry *retry);
+
+/**
+ * @brief Update the route's retry state with a request's outcome
+ *
+ * @param retry the handle initialized with winecord_retry_init()
+ * @param req the request that has just been performed
+ * @param has_failed `true` if request failed with a server or transport error
+ */
+void winecord_retry_record(struct winecord_retry *retry,
+                           struct winecord_request *req,
+                           bool has_failed);
+
+/**
+ * @brief Schedule a request to be retried
+ *
+ * Failed requests are reinserted to their bucket once their backoff is over,
+ *      other requests (e.g. ratelimited ones) are reinserted right away
+ * @param retry the handle initialized with winecord_retry_init()
+ * @param req the request to be retried
+ * @param has_failed `true` if request failed with a server or transport error
+ * @return `false` if the request should give up instead
+ */
+bool winecord_retry_schedule(struct winecord_retry *retry,
+                             struct winecord_request *req,
+                             bool has_failed);
+
+/**
+ * @brief Check if the bucket's circuit is open
+ *
+ * @param bucket the bucket to be checked
+ * @param now the current timestamp
+ * @return `true` if the bucket's requests should fail right away
+ */
+bool winecord_retry_is_open(const struct winecord_bucket *bucket,
+                            u64unix_ms now);
+
+/**
+ * @brief Check if the bucket's circuit is half-open with a request in flight
+ *
+ * @param bucket the bucket to be checked
+ * @return `true` if the bucket's requests should wait on the probe's outcome
+ */
+bool winecord_retry_is_probing(const struct winecord_bucket *bucket);
+
+/**
+ * @brief Have a circuit that has been open let the selected request through
+ *      as its single probe
+ *
+ * @param bucket the bucket whose request has been selected
+ */
+void winecord_retry_on_select(struct winecord_bucket *bucket);
+
+/** @} WinecordInternalRESTRequestRetry */
+
 /** @brief Generic request dispatcher */
 struct winecord_ret_dispatch {
     WINEBERRY_RET_DEFAULT_FIELDS;
     /** `true` if may receive a datatype from response */
     bool has_type;
+    /** `true` if the response must come from Winecord rather than from the
+     *      response cache (e.g. a resource that is read to be modified) */
+    bool skip_cache;
 
     /**
      * optional callback to be executed on a successful request
@@ -401,6 +1093,26 @@ struct winecord_ret_dispatch {
      * perform on-spot. On success the response object will be written to
      * the address. */
     void *sync;
+
+    /**
+     * optional callback to be executed for each of a list's elements, as
+     *      they are received
+     * @see @ref WINECORD_ATTR_STREAM_INIT
+     */
+    void (*item)(struct winecord *client,
+                 struct winecord_response *resp,
+                 const void *item);
+};
+
+/**
+ * @brief Request body to be serialized straight into the request's buffer
+ * @see @ref WINECORD_ATTR_BODY_INIT
+ */
+struct winecord_body_builder {
+    /** serialize `params` as JSON, return `0` if `size` isn't enough */
+    size_t (*to_json)(char buf[], size_t size, const void *params);
+    /** the datatype to be serialized */
+    const void *params;
 };
 
 /** @brief Attributes of response datatype */
@@ -415,6 +1127,23 @@ struct winecord_ret_response {
     size_t (*from_json)(const char *json, size_t len, void *data);
     /** cleanup function for datatype */
     void (*cleanup)(void *data);
+
+    /**
+     * attributes of a list's elements, so they can be decoded as they are
+     *      received
+     * @see @ref WINECORD_ATTR_STREAM_INIT
+     */
+    struct {
+        /** size of element datatype in bytes */
+        size_t size;
+        /** populate element datatype with JSON values */
+        size_t (*from_json)(const char *json, size_t len, void *data);
+        /** cleanup function for element datatype */
+        void (*cleanup)(void *data);
+        /** append a zeroed element to the list, and return it
+         *      @see @ref WINECORD_LIST_ACCESSOR */
+        void *(*push)(void *list);
+    } item;
 };
 
 /**
@@ -428,6 +1157,8 @@ struct winecord_ret_response {
     struct winecord_ret_response response;                                     \
     /** if @ref HTTP_MIMEPOST provide attachments for file transfer */        \
     struct winecord_attachments attachments;                                   \
+    /** request body to be serialized at winecord_request_begin() */           \
+    struct winecord_body_builder builder;                                      \
     /** indicated reason to why the action was taken @note when used at       \
      *      @ref winecord_request buffer is kept and reused */                 \
     char *reason
@@ -448,6 +1179,8 @@ struct winecord_request {
 
     /** the request's bucket */
     struct winecord_bucket *b;
+    /** `true` while the request is queued at its bucket */
+    bool is_queued;
     /** request body handle @note buffer is kept and reused */
     struct ccord_szbuf_reusable body;
     /** the request's http method */
@@ -456,18 +1189,308 @@ struct winecord_request {
     char endpoint[WINECORD_ENDPT_LEN];
     /** the request bucket's key */
     char key[WINECORD_ROUTE_LEN];
+    /**
+     * the request's route (its endpoint format string)
+     * @note expected to be a string literal
+     */
+    const char *route;
+    /** timestamp after which the request fails rather than being sent, `0`
+     *      for none */
+    u64unix_ms deadline;
+    /** position at its bucket's deadlines heap (starting from `1`), `0` if
+     *      it isn't queued with a deadline */
+    int deadline_pos;
+    /** timestamps (in microseconds) for the route's metrics */
+    struct {
+        /** when the request has been started */
+        int64_t started;
+        /** when the request has been last assigned to its bucket */
+        int64_t bucketed;
+        /** when the request has been last sent */
+        int64_t sent;
+    } tstamps;
+    /** fair queuing of the request among the requests of other tenants */
+    struct {
+        /** the request's tenant */
+        u64snowflake tenant;
+        /** virtual time at which the request is due to start */
+        uint64_t start;
+        /** virtual time at which the request is due to finish, requests
+         *      are sent in order of it */
+        uint64_t finish;
+    } fair;
+    /** `true` if request is revalidating a stale cached response */
+    bool is_revalidating;
+    /** the requestor this request has been started from */
+    struct winecord_requestor *rqtor;
+    /** the response being received */
+    struct {
+        /**
+         * response body
+         * @note if streaming, only the element being currently received is
+         *      kept
+         * @note buffer is kept and reused
+         */
+        struct ccord_szbuf_reusable body;
+        /** `true` if list elements are decoded as they are received */
+        bool is_streaming;
+        /** `true` once the list's opening bracket has been received */
+        bool has_started;
+        /** `true` once the list's closing bracket has been received */
+        bool has_ended;
+        /** `true` if currently inside a JSON string */
+        bool in_string;
+        /** `true` if last character was an escape character */
+        bool is_escaped;
+        /** nesting depth of the element being currently received */
+        int depth;
+        /**
+         * elements decoded for the `item` callback, handed over to it from
+         *      the request's executor once the list is received whole
+         * @note buffer is kept and reused
+         */
+        struct ccord_szbuf_reusable items;
+    } recv;
     /** the connection handler assigned */
     struct ua_conn *conn;
+    /**
+     * duplicate of a `GET` request that has taken longer than its route's
+     *      p95, the first response received is kept
+     * @see winecord_rest_set_hedging()
+     */
+    struct {
+        /** the duplicate's connection, `NULL` if none is in flight */
+        struct ua_conn *conn;
+        /** the duplicate's response body @note buffer is kept and reused */
+        struct ccord_szbuf_reusable body;
+        /** timer that sends the duplicate, `0` if none is scheduled */
+        unsigned timer;
+    } hedge;
     /** request's status code */
     WINEBERRYcode code;
-    /** current retry attempt (stop at rest->retry_limit) */
+    /** current retry attempt (stop at its route's retry policy) */
     int retry_attempt;
     /** synchronize synchronous requests */
     pthread_cond_t *cond;
+    /** the request's future, if requested by the client */
+    struct winecord_future *future;
+    /**
+     * next request in a singly-linked stack
+     * @note used by @ref winecord_requestor `pending` stack and the
+     *      thread-local recycling cache
+     */
+    struct winecord_request *next;
+    /**
+     * identical `GET` requests attached to this one, linked by `next`
+     * @see @ref winecord_singleflight
+     */
+    struct winecord_request *followers;
     /** entry for @ref winecord_ratelimiter and @ref winecord_bucket queues */
     QUEUE entry;
 };
 
+/**
+ * @brief In-flight `GET` requests that identical requests may attach to
+ *
+ * A `GET` request whose endpoint matches one that is already pending or
+ *      being performed won't be sent, instead it shares the response of the
+ *      matching request. A request of a higher class or earlier deadline
+ *      takes over a matching request that is still waiting at its bucket,
+ *      and if the shared request fails for its own reason (its deadline or
+ *      cancellation) the requests attached to it are enqueued again
+ * @note only accessed from the `REST` thread
+ */
+struct winecord_singleflight {
+    /** amount of in-flight requests */
+    int length;
+    /** cap before increase */
+    int capacity;
+    /**
+     * in-flight requests indexed by their endpoint
+     * @note datatype declared at winecord-rest_request.c
+     */
+    struct _winecord_inflight *inflights;
+};
+
+/** @defgroup WinecordInternalRESTRequestCache Response cache
+ * @brief Cache of `GET` responses, invalidated by Gateway events
+ *  @{ */
+
+/** @brief Cache of `GET` responses with per-route time-to-live */
+struct winecord_rest_cache {
+    /** `WINECORD_REST_CACHE` logging module */
+    struct logconf conf;
+    /** time-to-live of routes that haven't been individually assigned one */
+    u64unix_ms default_ttl;
+
+    /** cached responses indexed by their endpoint */
+    struct {
+        /** amount of cached responses */
+        int length;
+        /** cap before increase */
+        int capacity;
+        /** @note datatype declared at winecord-rest_cache.c */
+        struct _winecord_cached_response *buckets;
+    } responses;
+
+    /** routes time-to-live, indexed by their endpoint format string */
+    struct {
+        /** amount of routes assigned a time-to-live */
+        int length;
+        /** cap before increase */
+        int capacity;
+        /** @note datatype declared at winecord-rest_cache.c */
+        struct _winecord_cached_route *buckets;
+    } routes;
+
+    /** lock for accessing the cache from multiple threads */
+    pthread_mutex_t lock;
+};
+
+/**
+ * @brief Initialize the response cache
+ *
+ * @param cache the cache to be initialized
+ * @param conf pointer to @ref winecord_requestor logging module
+ * @param default_ttl time-to-live in milliseconds for routes that haven't
+ *      been assigned one, `0` to only cache routes explicitly assigned one
+ */
+void winecord_rest_cache_init(struct winecord_rest_cache *cache,
+                             struct logconf *conf,
+                             u64unix_ms default_ttl);
+
+/**
+ * @brief Free cached responses
+ *
+ * @param cache the cache initialized with winecord_rest_cache_init()
+ */
+void winecord_rest_cache_cleanup(struct winecord_rest_cache *cache);
+
+/**
+ * @brief Get a route's time-to-live
+ *
+ * @param cache the cache initialized with winecord_rest_cache_init()
+ * @param route the request's endpoint format string
+ * @return time-to-live in milliseconds, `0` if route shouldn't be cached
+ */
+u64unix_ms winecord_rest_cache_get_ttl(struct winecord_rest_cache *cache,
+                                      const char route[]);
+
+/**
+ * @brief Get a copy of an endpoint's response, if it hasn't expired yet
+ *
+ * @param cache the cache initialized with winecord_rest_cache_init()
+ * @param endpoint the request's endpoint
+ * @param[out] body copy of the cached response, must be free'd by the caller
+ * @return `true` if a fresh response has been found
+ */
+bool winecord_rest_cache_find(struct winecord_rest_cache *cache,
+                             const char endpoint[],
+                             struct ccord_szbuf *body);
+
+/**
+ * @brief Get an expired response's entity tag, for conditional revalidation
+ *
+ * @param cache the cache initialized with winecord_rest_cache_init()
+ * @param endpoint the request's endpoint
+ * @param[out] etag the entity tag
+ * @param size `etag` buffer size
+ * @return `true` if an entity tag has been found
+ */
+bool winecord_rest_cache_get_etag(struct winecord_rest_cache *cache,
+                                 const char endpoint[],
+                                 char etag[],
+                                 size_t size);
+
+/**
+ * @brief Refresh an expired response once the server confirms it hasn't
+ *      been modified
+ *
+ * @param cache the cache initialized with winecord_rest_cache_init()
+ * @param route the request's endpoint format string
+ * @param endpoint the request's endpoint
+ * @param[out] body copy of the cached response, must be free'd by the caller
+ * @return `true` if response was still cached
+ */
+bool winecord_rest_cache_revalidate(struct winecord_rest_cache *cache,
+                                   const char route[],
+                                   const char endpoint[],
+                                   struct ccord_szbuf *body);
+
+/**
+ * @brief Store a response
+ *
+ * @param cache the cache initialized with winecord_rest_cache_init()
+ * @param route the request's endpoint format string
+ * @param endpoint the request's endpoint
+ * @param body the response body
+ * @param etag the response entity tag (may be empty)
+ */
+void winecord_rest_cache_store(struct winecord_rest_cache *cache,
+                              const char route[],
+                              const char endpoint[],
+                              const struct ua_szbuf_readonly *body,
+                              const struct ua_szbuf_readonly *etag);
+
+/**
+ * @brief Drop cached responses of endpoints matching `prefix`
+ *
+ * An endpoint matches if it starts with `prefix`, followed by either a
+ *      sub-route or a query string. If `prefix` ends with `$` then
+ *      sub-routes won't match.
+ * @param cache the cache initialized with winecord_rest_cache_init()
+ * @param prefix the endpoint prefix
+ */
+void winecord_rest_cache_drop(struct winecord_rest_cache *cache,
+                             const char prefix[]);
+
+/**
+ * @brief Drop cached responses made outdated by a Gateway event
+ *
+ * @param cache the cache initialized with winecord_rest_cache_init()
+ * @param event the Gateway event
+ * @param data the event's payload `d` field
+ * @param json the event's payload JSON
+ */
+void winecord_rest_cache_on_event(struct winecord_rest_cache *cache,
+                                 enum winecord_gateway_events event,
+                                 const jsmnf_pair *data,
+                                 const char json[]);
+
+/**
+ * @brief Drop cached responses made outdated by a successful `POST`, `PUT`,
+ *      `PATCH` or `DELETE` request
+ *
+ * Responses of the endpoint and its sub-routes are dropped, along with the
+ *      ones of its parent paths (e.g. a write to `/channels/{id}/messages/{id}`
+ *      drops `/channels/{id}/messages`)
+ * @param cache the cache initialized with winecord_rest_cache_init()
+ * @param endpoint the written endpoint
+ */
+void winecord_rest_cache_on_write(struct winecord_rest_cache *cache,
+                                 const char endpoint[]);
+
+/** @} WinecordInternalRESTRequestCache */
+
+/** amount of lanes for @ref WINECORD_EXECUTOR_LANES */
+#define WINECORD_LANES_MAX 64
+
+/**
+ * @brief Completed requests whose callbacks are executed in order
+ * @see @ref WINECORD_EXECUTOR_LANES
+ */
+struct winecord_lane {
+    /** requests waiting for their callbacks to be executed */
+    QUEUE(struct winecord_request) finished;
+    /** `true` if a worker has been assigned to execute the lane */
+    bool is_busy;
+    /** lock for accessing the lane from multiple threads */
+    pthread_mutex_t lock;
+};
+
+/** max amount of connections kept warm by each `REST` thread */
+#define WINECORD_WARM_MAX 16
+
 /** @brief The handle used for handling asynchronous requests */
 struct winecord_requestor {
     /** `WINECORD_REQUEST` logging module */
@@ -476,30 +1499,108 @@ struct winecord_requestor {
     struct user_agent *ua;
     /** curl_multi handle for performing asynchronous requests */
     CURLM *mhandle;
+    /**
+     * timestamp (in microseconds) of when curl's earliest timeout expires,
+     *      `-1` if there is none
+     * @note set by curl's `CURLMOPT_TIMERFUNCTION`
+     */
+    int64_t timeout;
+    /**
+     * connections of the requestor's transfers
+     * @note updated from the `REST` thread, read atomically from any thread
+     */
+    struct {
+        /** warm-up transfers in flight, `NULL` for unused slots */
+        CURL *warming[WINECORD_WARM_MAX];
+        /** timestamp (in microseconds) of when a request was last sent */
+        int64_t last_tstamp;
+        /** requests transferred */
+        uint64_t transfers;
+        /** requests that reused an open connection */
+        uint64_t reused;
+        /** connections opened by requests, paying for DNS, TCP and TLS
+         *      setup */
+        uint64_t handshakes;
+        /** connections opened ahead of requests */
+        uint64_t warm_handshakes;
+    } conns;
+    /**
+     * adaptive limit of in-flight transfers, grown additively while
+     *      transfers are healthy and cut multiplicatively once they degrade
+     * @note updated from the `REST` thread, read atomically from any thread
+     */
+    struct {
+        /** transfers in flight */
+        int in_flight;
+        /** current limit of in-flight transfers */
+        int limit;
+        /** healthy transfers since the limit has last grown, it grows by
+         *      one once it reaches `limit` */
+        int healthy;
+        /** smoothed latency (in microseconds) of transfers */
+        int64_t latency;
+        /** timestamp (in microseconds) of when the limit was last cut */
+        int64_t cut_tstamp;
+    } aimd;
     /** enforce Winecord's ratelimiting for requests */
     struct winecord_ratelimiter ratelimiter;
+    /** coalesce identical `GET` requests */
+    struct winecord_singleflight singleflight;
+    /**
+     * cache of `GET` responses
+     * @note `NULL` unless enabled with winecord_rest_cache_enable()
+     * @note shared by every `REST` thread
+     */
+    struct winecord_rest_cache *cache;
 
-    /** max amount of retries before a failed request gives up */
-    int retry_limit;
+    /** retry policies of failed requests */
+    struct winecord_retry *retry;
 
-    /** request queues */
+    /**
+     * lock-free stack of pending requests waiting to be assigned to a
+     *      bucket
+     * @note pushed to by any thread, drained all at once by the `REST`
+     *      thread
+     */
+    struct winecord_request *pending;
+    /**
+     * `true` if the `REST` thread has already been signaled to drain
+     *      `pending`, so that a burst of requests cost a single wakeup
+     */
+    bool wakeup_pending;
+
+    /**
+     * request queues
+     * @note shared by every `REST` thread
+     */
     struct {
-        /** requests for recycling */
+        /**
+         * requests for recycling
+         * @note each thread keeps a small cache of its own, this queue is
+         *      only touched when a thread's cache over or underflows
+         */
         QUEUE(struct winecord_request) recycling;
-        /** pending requests waiting to be assigned to a bucket */
-        QUEUE(struct winecord_request) pending;
         /**
          * finished requests that are done performing and waiting for
          *      their callbacks to be called from the main thread
          */
         QUEUE(struct winecord_request) finished;
+        /** finished requests waiting for their callbacks to be called from
+         *      the worker threadpool, in order */
+        struct winecord_lane lanes[WINECORD_LANES_MAX];
+        /**
+         * `true` if a lane couldn't be assigned a worker, it is assigned
+         *      one again from the main thread
+         * @see winecord_requestor_dispatch_responses()
+         */
+        bool has_stalled_lanes;
     } * queues;
 
     /** queue locks */
     struct {
         /** recycling queue lock */
         pthread_mutex_t recycling;
-        /** pending queue lock */
+        /** synchronous requests lock (see @ref winecord_request `cond`) */
         pthread_mutex_t pending;
         /** finished queue lock */
         pthread_mutex_t finished;
@@ -511,6 +1612,9 @@ struct winecord_requestor {
  *
  * This shall initialize a `CURLM` multi handle for performing requests
  *      asynchronously, and a queue for storing individual requests
+ * @note the requestors of every `REST` thread but the first share the
+ *      first's queues and retry policies, so it must be initialized first
+ *      and cleaned up last
  * @param rqtor the requestor handle to be initialized
  * @param conf pointer to @ref winecord_rest logging module
  * @param token the bot token
@@ -526,6 +1630,25 @@ void winecord_requestor_init(struct winecord_requestor *rqtor,
  */
 void winecord_requestor_cleanup(struct winecord_requestor *rqtor);
 
+/** interval (in milliseconds) after which idle connections are warmed up
+ *      again, kept below curl's `CURLOPT_MAXAGE_CONN` */
+#define WINECORD_WARM_INTERVAL_MS 30000
+
+/**
+ * @brief Open connections to the API host ahead of requests
+ *
+ * Connections that are already open are reused by the warm-up transfers,
+ *      which keeps them from being closed for being idle
+ * @param rqtor the requestor handle initialized with winecord_requestor_init()
+ * @param amount the amount of connections to be kept warm
+ * @param force if `false` then connections are only warmed up if no request
+ *      has been sent for @ref WINECORD_WARM_INTERVAL_MS
+ * @note must be called from the `REST` thread
+ */
+void winecord_requestor_warm(struct winecord_requestor *rqtor,
+                             int amount,
+                             bool force);
+
 /**
  * @brief Check for and start pending bucket's requests
  *
@@ -535,7 +1658,21 @@ void winecord_requestor_cleanup(struct winecord_requestor *rqtor);
 WINEBERRYcode winecord_requestor_start_pending(struct winecord_requestor *rqtor);
 
 /**
- * @brief Poll for request's completion
+ * @brief Get time until curl's earliest timeout expires
+ *
+ * @param rqtor the handle initialized with winecord_requestor_init()
+ * @param now current time in microseconds
+ * @param max_time max time allowed
+ * @return time in microseconds until curl's timeout, or max
+ */
+int64_t winecord_requestor_get_next_trigger(struct winecord_requestor *rqtor,
+                                           int64_t now,
+                                           int64_t max_time);
+
+/**
+ * @brief Act on curl's expired timeouts and poll for request's completion
+ * @note the sockets of on-going transfers are acted on by the `REST`
+ *      thread's poller as they become ready
  *
  * @param rqtor the handle initialized with winecord_requestor_init()
  * @WINEBERRY_return
@@ -549,8 +1686,29 @@ WINEBERRYcode winecord_requestor_info_read(struct winecord_requestor *rqtor);
  */
 void winecord_requestor_dispatch_responses(struct winecord_requestor *rqtor);
 
+/**
+ * @brief Have the calling thread cache the requests it recycles until it
+ *      exits
+ * @note only called from the `REST` threads, other threads cache requests
+ *      for the duration of a dispatch, as they may outlive the requestor
+ */
+void winecord_requestor_cache_attach(void);
+
+/**
+ * @brief Complete a request that won't be sent with a failure code
+ *
+ * @param rqtor the requestor handle initialized with winecord_requestor_init()
+ * @param req the enqueued request to be failed
+ * @param code the request's completion code
+ */
+void winecord_request_fail(struct winecord_requestor *rqtor,
+                           struct winecord_request *req,
+                           WINEBERRYcode code);
+
 /**
  * @brief Mark request as canceled and move it to the recycling queue
+ * @note only called from the `REST` thread, as the request may still be
+ *      coalescing identical requests
  *
  * @param rqtor the requestor handle initialized with winecord_requestor_init()
  * @param req the on-going request to be canceled
@@ -569,36 +1727,157 @@ void winecord_request_cancel(struct winecord_requestor *rqtor,
  * @param method the request's HTTP method
  * @param endpoint the request's endpoint
  * @param key the request bucket's group for ratelimiting
+ * @param route the request's endpoint format string
  * @WINEBERRY_return
+ * @note an asynchronous request whose body couldn't be formed is handed
+ *      @ref WINEBERRY_MALFORMED_PAYLOAD at its callbacks and future
  */
 WINEBERRYcode winecord_request_begin(struct winecord_requestor *rqtor,
                                 struct winecord_attributes *req,
                                 struct ccord_szbuf *body,
                                 enum http_method method,
                                 char endpoint[WINECORD_ENDPT_LEN],
-                                char key[WINECORD_ROUTE_LEN]);
+                                char key[WINECORD_ROUTE_LEN],
+                                const char route[]);
+
+/**
+ * @brief Hand a code over to a request's callbacks without performing it
+ *
+ * The callbacks are executed from the client's executor, just like those of a
+ *      request that has been performed
+ * @note may be called from any thread
+ *
+ * @param rqtor the requestor handle initialized with winecord_requestor_init()
+ * @param attr the request's attributes, can't be synchronous
+ * @param code the request's completion code
+ */
+void winecord_request_dispatch_code(struct winecord_requestor *rqtor,
+                                    struct winecord_attributes *attr,
+                                    WINEBERRYcode code);
+
+/** @defgroup WinecordInternalRESTFuture Futures
+ * @brief Completion handles for joining on requests
+ *  @{ */
+
+/**
+ * @brief Create a future for a request
+ *
+ * @param client the client created with winecord_init()
+ * @return a future with two references: one for the client and one for the
+ *      request, the latter is dropped at winecord_future_dispatch()
+ */
+struct winecord_future *winecord_future_create(struct winecord *client);
+
+/**
+ * @brief Mark future as completed and wake up its waiters
+ * @note only the first call has any effect
+ *
+ * @param future the future to be completed
+ * @param code the request's completion code
+ * @param result the response datatype (if any), it will be kept alive until
+ *      the future is released
+ */
+void winecord_future_complete(struct winecord_future *future,
+                              WINEBERRYcode code,
+                              void *result);
+
+/**
+ * @brief Run the future's chained callbacks and drop the request's reference
+ * @note should be called after the request's `done` or `fail` callbacks
+ *
+ * @param future the completed future
+ */
+void winecord_future_dispatch(struct winecord_future *future);
+
+/** @} WinecordInternalRESTFuture */
 
 /** @} WinecordInternalRESTRequest */
 
 /**
  * @brief The handle used for interfacing with Winecord's REST API
  *
- * This handle will manage the special REST thread where requests are performed
- *      in
+ * This handle will manage the special REST threads where requests are
+ *      performed in
  */
 struct winecord_rest {
     /** `WINECORD_HTTP` or `WINECORD_WEBHOOK` logging module */
     struct logconf conf;
+    /** Unix socket that metrics are served from, `-1` if none
+     *      @see winecord_rest_metrics_serve() */
+    int metrics_fd;
+    /** path of `metrics_fd`, unlinked at cleanup */
+    char *metrics_path;
+    /** connections that metrics are still being sent to
+     *      @note datatype declared at winecord-rest_metrics.c */
+    QUEUE(struct _winecord_metrics_scrape) metrics_scrapes;
+    /** where callbacks of completed requests are executed by default */
+    enum winecord_executor executor;
+    /** connections kept warm by each `REST` thread
+     *      (`WINEBERRY_REST_WARM_CONNECTIONS` environment variable, `0` by
+     *      default) @see winecord_rest_set_warm_connections() */
+    int warm_connections;
+    /** `true` if slow `GET` requests are duplicated
+     *      @see winecord_rest_set_hedging() */
+    bool is_hedging;
+    /** weights of tenants for fair queuing
+     *      @see winecord_rest_set_tenant_weight() */
+    struct winecord_tenants tenants;
+    /** queues of embeds pushed with winecord_rest_webhook_push() */
+    struct winecord_webhooks webhooks;
+    /** bans coalesced into bulk bans
+     *      @see winecord_rest_set_ban_coalescing() */
+    struct winecord_bans bans;
+    /** role changes coalesced into member modifies
+     *      @see winecord_rest_set_role_coalescing() */
+    struct winecord_role_deltas role_deltas;
+    /**
+     * the REST threads, buckets are assigned to them by their major
+     *      parameter
+     * @note the first one owns the state that is shared between them
+     */
+    struct winecord_rest_shard *shards;
+    /** amount of REST threads (`WINEBERRY_REST_THREADS` environment variable,
+     *      `1` by default) */
+    int n_shards;
+};
+
+/**
+ * @brief A REST thread, performing the requests of the buckets assigned to it
+ *
+ * Each thread has its own buckets, connections and timers, so that buckets
+ *      of distinct major parameters are performed in parallel
+ */
+struct winecord_rest_shard {
     /** the requests handler */
     struct winecord_requestor requestor;
     /** the timer queue for the rest thread */
     struct winecord_timers timers;
     /** poller for REST requests */
     struct io_poller *io_poller;
-    /** threadpool for managing the REST thread */
-    struct threadpool_t *tpool;
+    /** the REST thread */
+    pthread_t thread;
+    /** `false` once the REST thread should stop */
+    bool is_running;
+    /** the REST handle this thread belongs to */
+    struct winecord_rest *rest;
 };
 
+/** @brief Get the REST thread that a requestor belongs to */
+#define REST_SHARD(rqtor)                                                     \
+    CONTAINEROF(rqtor, struct winecord_rest_shard, requestor)
+/** @brief Get client from a REST thread's requestor */
+#define REQUESTOR_CLIENT(rqtor) CLIENT(REST_SHARD(rqtor)->rest, rest)
+
+/**
+ * @brief Get the REST thread that a bucket's requests are performed by
+ *
+ * @param rest the handle initialized with winecord_rest_init()
+ * @param key obtained from winecord_ratelimiter_build_key()
+ * @return the REST thread assigned to the key's major parameter
+ */
+struct winecord_rest_shard *winecord_rest_get_shard(struct winecord_rest *rest,
+                                                    const char key[]);
+
 /**
  * @brief Initialize an REST handle
  *
@@ -1058,6 +2337,26 @@ WINEBERRYcode winecord_refcounter_incr(struct winecord_refcounter *rc, void *dat
  */
 WINEBERRYcode winecord_refcounter_decr(struct winecord_refcounter *rc, void *data);
 
+/**
+ * @brief Reference the `data` and `keep` of a return handle, the same as
+ *      a request would, for a call that is completed at a later time
+ * @see winecord_refcounter_release_ret()
+ *
+ * @param rc the handle initialized with winecord_refcounter_init()
+ * @param ret the return handle of the call
+ */
+void winecord_refcounter_hold_ret(struct winecord_refcounter *rc,
+                                  const struct winecord_ret *ret);
+
+/**
+ * @brief Release the references taken by winecord_refcounter_hold_ret()
+ *
+ * @param rc the handle initialized with winecord_refcounter_init()
+ * @param ret the return handle of the call
+ */
+void winecord_refcounter_release_ret(struct winecord_refcounter *rc,
+                                     const struct winecord_ret *ret);
+
 /** @} WinecordInternalRefcount */
 
 /** @defgroup WinecordInternalMessageCommands Message Commands API
@@ -1238,7 +2537,7 @@ struct winecord {
 
     /** keep tab of amount of worker threads being used by client */
     struct {
-        /** amount of worker-threads currently being used by client */
+        /** amount of tasks queued or being run for the client */
         int count;
         /** synchronize `count` between workers */
         pthread_mutex_t lock;
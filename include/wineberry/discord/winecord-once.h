@@ -27,6 +27,22 @@ int wineberry_shutting_down();
  */
 WINEBERRYcode wineberry_global_init();
 
+/**
+ * @brief Share DNS lookups and TLS sessions between every client
+ *
+ * By default each client (and each of its `REST` threads, Gateway and voice
+ *      connections) keeps DNS lookups and TLS sessions of its own, so a
+ *      process running several bots repeats them for the same hosts. Once
+ *      enabled, they are shared process-wide, and TLS sessions are resumed
+ *      rather than negotiated from scratch
+ * @note must be called after wineberry_global_init() and before clients are
+ *      created
+ * @note connections themselves aren't shared, as libcurl doesn't support
+ *      sharing them between concurrent threads
+ * @return WINEBERRY_OK on success, WINEBERRY_GLOBAL_INIT on error
+ */
+WINEBERRYcode wineberry_global_share_enable();
+
 /** @brief Cleanup global shared-resources */
 void wineberry_global_cleanup();
 
@@ -15,6 +15,10 @@ typedef void (*cast_done_typed)(struct winecord *,
 typedef void (*cast_init)(void *);
 typedef void (*cast_cleanup)(void *);
 typedef size_t (*cast_from_json)(const char *, size_t, void *);
+typedef void (*cast_item)(struct winecord *,
+                          struct winecord_response *,
+                          const void *);
+typedef size_t (*cast_to_json)(char[], size_t, const void *);
 
 /* helper typedef for getting sizeof of `struct winecord_ret` common fields */
 typedef struct {
@@ -72,6 +76,51 @@ typedef struct {
         if (ret) _RET_COPY_TYPED(attr.dispatch, *ret);                        \
     } while (0)
 
+/**
+ * @brief Define the accessor that appends an element to a specs-generated
+ *      list, as expected by WINECORD_ATTR_STREAM_INIT()
+ * @note expanded at file scope, once per list datatype of the file
+ *
+ * @param[in] type datatype of the list
+ */
+#define WINECORD_LIST_ACCESSOR(type)                                          \
+    static void *_##type##_push(void *p_list)                                 \
+    {                                                                         \
+        struct type *list = p_list;                                           \
+        if (list->size == list->realsize) {                                   \
+            int realsize = list->realsize ? 2 * list->realsize : 16;          \
+            void *tmp = realloc(list->array,                                  \
+                                (size_t)realsize * sizeof *list->array);      \
+            ASSERT_S(tmp != NULL, "Out of memory");                           \
+            list->array = tmp;                                                \
+            list->realsize = realsize;                                        \
+        }                                                                     \
+        memset(list->array + list->size, 0, sizeof *list->array);             \
+        return list->array + list->size++;                                    \
+    }
+
+/**
+ * @brief Helper for setting attributes for a specs-generated list that can be
+ *      decoded as its elements are received
+ * @note the list's accessor must be defined with WINECORD_LIST_ACCESSOR()
+ *
+ * @param[out] attr @ref winecord_attributes handler to be initialized
+ * @param[in] type datatype of the list
+ * @param[in] item_type datatype of the list's elements
+ * @param[in] ret dispatch attributes (generated by WINECORD_RETURN_LIST())
+ * @param[in] _reason reason for request (if available)
+ */
+#define WINECORD_ATTR_STREAM_INIT(attr, type, item_type, ret, _reason)        \
+    do {                                                                      \
+        WINECORD_ATTR_LIST_INIT(attr, type, ret, _reason);                    \
+        (attr).response.item.push = &_##type##_push;                          \
+        (attr).response.item.size = sizeof(struct item_type);                 \
+        (attr).response.item.from_json =                                      \
+            (cast_from_json)item_type##_from_json;                            \
+        (attr).response.item.cleanup = (cast_cleanup)item_type##_cleanup;     \
+        if (ret) (attr).dispatch.item = (cast_item)(ret)->item;               \
+    } while (0)
+
 /**
  * @brief Helper for setting attributes for requests that doesn't expect a
  *      response object
@@ -86,6 +135,21 @@ typedef struct {
         if (ret) _RET_COPY_TYPELESS(attr.dispatch, *ret);                     \
     } while (0)
 
+/**
+ * @brief Helper for having a datatype serialized as the request's body
+ *
+ * The datatype is serialized straight into the request's reusable buffer
+ *      at winecord_request_begin(), which grows as needed
+ * @param[out] attr @ref winecord_attributes handler to be initialized
+ * @param[in] type datatype of the request's body
+ * @param[in] _params the datatype to be serialized
+ */
+#define WINECORD_ATTR_BODY_INIT(attr, type, _params)                          \
+    do {                                                                      \
+        (attr).builder.to_json = (cast_to_json)type##_to_json;                \
+        (attr).builder.params = (_params);                                    \
+    } while (0)
+
 /**
  * @brief Helper for initializing attachments ids
  *
@@ -8,6 +8,10 @@
 #ifndef WINECORD_RESPONSE_H
 #define WINECORD_RESPONSE_H
 
+/* forward declaration */
+struct winecord_future;
+/**/
+
 /** @brief The response for the completed request */
 struct winecord_response {
     /** user arbitrary data provided at @ref winecord_ret */
@@ -18,6 +22,33 @@ struct winecord_response {
     WINEBERRYcode code;
 };
 
+/** @brief Scheduling class of a request */
+enum winecord_priority {
+    /** sent after requests of every other class */
+    WINECORD_PRIORITY_LOW = -1,
+    /** the default class */
+    WINECORD_PRIORITY_NORMAL = 0,
+    /** same as enabling `high_priority` */
+    WINECORD_PRIORITY_HIGH,
+    /** sent before requests of every other class (e.g. interaction
+     *      responses) */
+    WINECORD_PRIORITY_CRITICAL
+};
+
+/** @brief Where the callbacks of a completed request are executed */
+enum winecord_executor {
+    /** the client's executor @see winecord_rest_set_executor() */
+    WINECORD_EXECUTOR_DEFAULT = 0,
+    /** the main thread, in between Gateway events (the client's default) */
+    WINECORD_EXECUTOR_MAIN,
+    /** the worker threadpool, callbacks may be executed concurrently and
+     *      out of order */
+    WINECORD_EXECUTOR_WORKER,
+    /** the worker threadpool, callbacks of requests sharing a lane are
+     *      executed in order of completion, one at a time */
+    WINECORD_EXECUTOR_LANES
+};
+
 /******************************************************************************
  * Templates for generating type-safe return handles for async requests
  ******************************************************************************/
@@ -37,6 +68,28 @@ struct winecord_response {
     /** if `true` then request will be prioritized over already enqueued      \
         requests */                                                           \
     bool high_priority;                                                       \
+    /** the request's scheduling class, requests of a higher class are sent   \
+        first, and then the ones with the earliest deadline */                \
+    enum winecord_priority priority;                                          \
+    /** if set, then request fails with @ref WINEBERRY_WINECORD_DEADLINE      \
+        rather than being sent after this many milliseconds, or as soon as    \
+        its ratelimit won't reset in time */                                  \
+    u64unix_ms deadline_ms;                                                   \
+    /** where the `done` or `fail` callbacks are executed */                  \
+    enum winecord_executor executor;                                          \
+    /** if @ref WINECORD_EXECUTOR_LANES, the lane that the request belongs    \
+        to, by default the route's channel, guild or webhook id */            \
+    u64snowflake lane;                                                        \
+    /** the tenant that the request is fairly queued by within its bucket    \
+        (e.g. the guild an interaction comes from), by default the guild of   \
+        the Gateway event (or request) whose callback it is made from,        \
+        otherwise the route's guild, channel or webhook id                    \
+        @see winecord_rest_set_tenant_weight() */                             \
+    u64snowflake tenant;                                                      \
+    /** if an address is provided, then a @ref winecord_future handle that    \
+        completes alongside the request will be written to it               \
+        @note must be released with winecord_future_release() */           \
+    struct winecord_future **future;                                          \
     /** optional callback to be executed on a failed request */               \
     void (*fail)(struct winecord * client, struct winecord_response * resp)
 
@@ -55,6 +108,30 @@ struct winecord_response {
         struct winecord_##_type *sync;                                        \
     }
 
+#define WINECORD_RETURN_LIST(_type, _item)                                    \
+    /** @brief Request's return context */                                    \
+    struct winecord_ret_##_type {                                             \
+        WINEBERRY_RET_DEFAULT_FIELDS;                                         \
+        /** optional callback to be executed on a successful request          \
+            @note the list is empty if `item` is set */                       \
+        void (*done)(struct winecord * client,                                \
+                     struct winecord_response *resp,                          \
+                     const struct winecord_##_type *ret);                     \
+        /** if an address is provided, then request will block the thread and \
+           perform on-spot.                                                   \
+           On success the response object will be written to the address,     \
+           unless enabled with @ref WINECORD_SYNC_FLAG */                     \
+        struct winecord_##_type *sync;                                        \
+        /** optional callback to be executed for each of the list's elements, \
+            before `done`. Elements are decoded as they are received, so the  \
+            list's JSON is never kept whole in memory                         \
+            @note executed from the request's executor, once the whole list   \
+                has been received */                                          \
+        void (*item)(struct winecord * client,                                \
+                     struct winecord_response *resp,                          \
+                     const struct winecord_##_item *item);                    \
+    }
+
 /** @brief Request's return context */
 struct winecord_ret {
     WINEBERRY_RET_DEFAULT_FIELDS;
@@ -67,6 +144,146 @@ struct winecord_ret {
 /** @brief flag for enabling `sync` mode without expecting a datatype return */
 #define WINECORD_SYNC_FLAG ((void *)-1)
 
+/** @defgroup WinecordRESTError REST error codes
+ * @brief Request completion codes specific to Winecord's REST API
+ *  @{ */
+/** the request has been canceled before it could be completed */
+#define WINEBERRY_WINECORD_CANCELED 10
+/** the request couldn't be sent before its deadline */
+#define WINEBERRY_WINECORD_DEADLINE 11
+/** the request's route is failing, and its circuit has been opened */
+#define WINEBERRY_WINECORD_CIRCUIT_OPEN 12
+/** @} WinecordRESTError */
+
+/** @defgroup WinecordFuture Futures
+ * @brief Join on concurrent requests from any thread
+ *
+ * Every REST function accepts a `future` address at its return handle,
+ *      once the request is enqueued a @ref winecord_future is written to it.
+ *      A request that couldn't be started gets an already completed future
+ *      carrying its error code instead, while one that failed its
+ *      parameters validation leaves the address untouched, so it should be
+ *      initialized to `NULL`. A `NULL` future is treated as completed with
+ *      @ref WINEBERRY_BAD_PARAMETER by the functions below, and may be
+ *      released. Many requests may be started in sequence and then joined
+ *      at once:
+ * @code{.c}
+ * struct winecord_future *futures[2] = { 0 };
+ * winecord_get_channel(client, ch_a, &(struct winecord_ret_channel){
+ *                                        .future = &futures[0] });
+ * winecord_get_channel(client, ch_b, &(struct winecord_ret_channel){
+ *                                        .future = &futures[1] });
+ * winecord_future_wait_all(futures, 2, 5000);
+ * @endcode
+ *  @{ */
+
+/**
+ * @brief Callback to be executed once a future is completed
+ *
+ * @param client the client created with winecord_init()
+ * @param future the completed future
+ * @param data user arbitrary data provided at winecord_future_then()
+ * @return a future to chain to, whose outcome will be forwarded to the
+ *      future returned by winecord_future_then(), or `NULL` to forward
+ *      `future` outcome instead
+ * @note ownership of the returned future is transferred to Winecord
+ */
+typedef struct winecord_future *(*winecord_future_cb)(
+    struct winecord *client, struct winecord_future *future, void *data);
+
+/**
+ * @brief Block the thread until the future is completed
+ *
+ * @param future the future to wait on
+ * @param timeout_ms max amount of time to wait for, `-1` to wait indefinitely
+ * @return the request's completion code, or @ref WINEBERRY_PENDING if
+ *      `timeout_ms` has been reached first
+ */
+WINEBERRYcode winecord_future_wait(struct winecord_future *future,
+                                  int64_t timeout_ms);
+
+/**
+ * @brief Block the thread until all of the futures are completed
+ *
+ * @param futures the futures to wait on
+ * @param amount amount of futures
+ * @param timeout_ms max amount of time to wait for, `-1` to wait indefinitely
+ * @return @ref WINEBERRY_OK if all requests succeeded, the first failed
+ *      request's code otherwise, or @ref WINEBERRY_PENDING if `timeout_ms`
+ *      has been reached first
+ */
+WINEBERRYcode winecord_future_wait_all(struct winecord_future *futures[],
+                                      int amount,
+                                      int64_t timeout_ms);
+
+/**
+ * @brief Block the thread until any of the futures is completed
+ *
+ * @param futures the futures to wait on
+ * @param amount amount of futures
+ * @param timeout_ms max amount of time to wait for, `-1` to wait indefinitely
+ * @return the index of the first completed future found, or `-1` if
+ *      `timeout_ms` has been reached first
+ */
+int winecord_future_wait_any(struct winecord_future *futures[],
+                             int amount,
+                             int64_t timeout_ms);
+
+/**
+ * @brief Execute a callback once the future is completed
+ * @note the callback is executed from the same thread as the request's `done`
+ *      and `fail` callbacks, or immediately if that has already happened
+ *
+ * @param future the future to chain the callback to
+ * @param callback the callback to be executed
+ * @param data user arbitrary data to be passed to `callback`
+ * @return a future that completes once `callback` (and the future it returns,
+ *      if any) is completed
+ * @note the returned future must be released with winecord_future_release()
+ * @note if `future` is `NULL` the callback is never executed, and `NULL` is
+ *      returned
+ */
+struct winecord_future *winecord_future_then(struct winecord_future *future,
+                                            winecord_future_cb callback,
+                                            void *data);
+
+/**
+ * @brief Check whether the future has been completed
+ *
+ * @param future the future to be checked
+ * @return `true` if completed
+ */
+bool winecord_future_is_ready(struct winecord_future *future);
+
+/**
+ * @brief Get the completion code of a future
+ *
+ * @param future the future to retrieve the code from
+ * @return the request's completion code, or @ref WINEBERRY_PENDING if not
+ *      yet completed
+ */
+WINEBERRYcode winecord_future_get_code(struct winecord_future *future);
+
+/**
+ * @brief Get the response object of a future
+ * @note the object is kept alive until the future is released
+ *
+ * @param future the future to retrieve the response object from
+ * @return the response datatype (e.g `struct winecord_channel` for
+ *      winecord_get_channel()), or `NULL` if the request didn't succeed or
+ *      doesn't return a datatype
+ */
+const void *winecord_future_get_result(struct winecord_future *future);
+
+/**
+ * @brief Release the caller's reference to a future
+ *
+ * @param future the future to be released
+ */
+void winecord_future_release(struct winecord_future *future);
+
+/** @} WinecordFuture */
+
 /** @addtogroup WinecordAPIOAuth2
  *  @{ */
 WINECORD_RETURN(application);
@@ -89,7 +306,7 @@ WINECORD_RETURN(auto_moderation_rules);
 WINECORD_RETURN(channel);
 WINECORD_RETURN(channels);
 WINECORD_RETURN(message);
-WINECORD_RETURN(messages);
+WINECORD_RETURN_LIST(messages, message);
 WINECORD_RETURN(followed_channel);
 WINECORD_RETURN(thread_members);
 WINECORD_RETURN(thread_response_body);
@@ -107,11 +324,12 @@ WINECORD_RETURN(guild);
 WINECORD_RETURN(guilds);
 WINECORD_RETURN(guild_preview);
 WINECORD_RETURN(guild_member);
-WINECORD_RETURN(guild_members);
+WINECORD_RETURN_LIST(guild_members, guild_member);
 WINECORD_RETURN(guild_widget);
 WINECORD_RETURN(guild_widget_settings);
 WINECORD_RETURN(ban);
-WINECORD_RETURN(bans);
+WINECORD_RETURN_LIST(bans, ban);
+WINECORD_RETURN(bulk_ban);
 WINECORD_RETURN(role);
 WINECORD_RETURN(roles);
 WINECORD_RETURN(welcome_screen);
@@ -153,7 +371,7 @@ WINECORD_RETURN(list_nitro_sticker_packs);
 /** @addtogroup WinecordAPIUser
  *  @{ */
 WINECORD_RETURN(user);
-WINECORD_RETURN(users);
+WINECORD_RETURN_LIST(users, user);
 WINECORD_RETURN(connections);
 /** @} WinecordAPIUser */
 
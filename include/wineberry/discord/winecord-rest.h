@@ -0,0 +1,763 @@
+/**
+ * @file winecord-rest.h
+ * @author Cogmasters
+ * @brief Tuning of the REST requests behavior
+ */
+
+#ifndef WINECORD_REST_H
+#define WINECORD_REST_H
+
+/** @defgroup WinecordClientREST REST
+ * @ingroup WinecordClient
+ * @brief Tuning of the REST requests behavior
+ *  @{ */
+
+/** @defgroup WinecordClientRESTCache Response cache
+ * @brief Cache of `GET` responses
+ *
+ * Responses are cached by their endpoint, and kept for as long as their
+ *      route's time-to-live. Cached responses are served without being
+ *      ratelimited, and are dropped once a Gateway event that outdates
+ *      them is received (e.g. `GUILD_ROLE_UPDATE` drops the guild's roles),
+ *      or once the client successfully writes to their endpoint or one of
+ *      its sub-routes (e.g. modifying a member drops the member and the
+ *      guild's members list).
+ *      Expired responses that came with an entity tag are conditionally
+ *      revalidated with the server.
+ * @note Gateway events are only received for the enabled intents, routes
+ *      that aren't covered by them should be assigned a short time-to-live
+ *  @{ */
+
+/**
+ * @brief Enable caching of `GET` responses
+ *
+ * @param client the client created with winecord_init()
+ * @param default_ttl_ms time-to-live for routes that haven't been assigned
+ *      one with winecord_rest_cache_set_ttl(), `0` to only cache routes that
+ *      have been explicitly assigned one
+ */
+void winecord_rest_cache_enable(struct winecord *client,
+                               u64unix_ms default_ttl_ms);
+
+/**
+ * @brief Assign a time-to-live to a route
+ *
+ * Routes are identified by their endpoint format string, as it appears at
+ *      the Winecord API documentation
+ * @code{.c}
+ * winecord_rest_cache_set_ttl(client, "/guilds/%" PRIu64 "/roles", 60000);
+ * @endcode
+ * @param client the client created with winecord_init()
+ * @param route the route's endpoint format string
+ * @param ttl_ms time-to-live in milliseconds, `0` to disable caching
+ */
+void winecord_rest_cache_set_ttl(struct winecord *client,
+                                const char route[],
+                                u64unix_ms ttl_ms);
+
+/**
+ * @brief Drop cached responses of endpoints starting with `prefix`
+ *
+ * @param client the client created with winecord_init()
+ * @param prefix the endpoint prefix (e.g. `/guilds/1234`), sub-routes are
+ *      dropped too unless `prefix` ends with `$`
+ */
+void winecord_rest_cache_invalidate(struct winecord *client,
+                                   const char prefix[]);
+
+/** @} WinecordClientRESTCache */
+
+/** @defgroup WinecordClientRESTPaginator Paginators
+ * @brief Walk through listings that span across many pages
+ *
+ * A paginator requests page after page of a listing, moving the cursor
+ *      along on its own. The next page is requested as soon as its cursor
+ *      is known, before the current page's callbacks are executed, so
+ *      pages keep being fetched while the callbacks are still running. The
+ *      pages' callbacks are still executed in order, one at a time: with
+ *      the @ref WINECORD_EXECUTOR_WORKER executor they are executed from
+ *      the lane of the listing's channel or guild instead
+ * @code{.c}
+ * static bool
+ * on_member(struct winecord *client,
+ *           void *data,
+ *           const struct winecord_guild_member *member)
+ * {
+ *     ++*(int *)data;
+ *     return true; // return false to stop early
+ * }
+ *
+ * winecord_paginate_guild_members(
+ *     client, guild_id, 0,
+ *     &(struct winecord_paginate_guild_members){ .data = &count,
+ *                                                .item = &on_member });
+ * @endcode
+ *  @{ */
+
+/**
+ * @brief Generate paginator attributes for a listing
+ *
+ * @param _type the datatype of a single page
+ * @param _item the datatype of a page's element
+ */
+#define WINECORD_PAGINATE(_type, _item)                                       \
+    /** @brief Paginator attributes */                                        \
+    struct winecord_paginate_##_type {                                        \
+        /** user arbitrary data to be passed to callbacks */                  \
+        void *data;                                                           \
+        /** cleanup method to be called for `data` once pagination is over */ \
+        void (*cleanup)(struct winecord * client, void *data);                \
+        /** max amount of elements to be walked through, `0` for all */       \
+        int limit;                                                            \
+        /** amount of elements per page, `0` for the route's maximum */       \
+        int page_size;                                                        \
+        /** optional callback to be executed for each page, return `false`    \
+            to stop paginating */                                             \
+        bool (*page)(struct winecord * client,                                \
+                     void *data,                                              \
+                     const struct winecord_##_type *page);                    \
+        /** optional callback to be executed for each of the page's           \
+            elements, return `false` to stop paginating */                    \
+        bool (*item)(struct winecord * client,                                \
+                     void *data,                                              \
+                     const struct winecord_##_item *item);                    \
+        /** optional callback to be executed once pagination is over, `code`  \
+            is @ref WINEBERRY_OK unless a page couldn't be fetched */         \
+        void (*done)(struct winecord * client, void *data,                    \
+                     WINEBERRYcode code);                                     \
+    }
+
+WINECORD_PAGINATE(messages, message);
+WINECORD_PAGINATE(guild_members, guild_member);
+WINECORD_PAGINATE(users, user);
+WINECORD_PAGINATE(audit_log, audit_log_entry);
+WINECORD_PAGINATE(thread_response_body, channel);
+
+/**
+ * @brief Walk through a channel's messages, from newest to oldest
+ *
+ * @param client the client created with winecord_init()
+ * @param channel_id the channel to get messages from
+ * @param before start from messages before this message, `0` for latest
+ * @param attr the paginator attributes
+ * @WINEBERRY_return
+ */
+WINEBERRYcode winecord_paginate_channel_messages(
+    struct winecord *client,
+    u64snowflake channel_id,
+    u64snowflake before,
+    struct winecord_paginate_messages *attr);
+
+/**
+ * @brief Walk through a guild's members, ordered by their user ID
+ *
+ * @param client the client created with winecord_init()
+ * @param guild_id the guild to get members from
+ * @param after start from members after this user ID, `0` for first
+ * @param attr the paginator attributes
+ * @WINEBERRY_return
+ */
+WINEBERRYcode winecord_paginate_guild_members(
+    struct winecord *client,
+    u64snowflake guild_id,
+    u64snowflake after,
+    struct winecord_paginate_guild_members *attr);
+
+/**
+ * @brief Walk through the users that reacted with a given emoji
+ *
+ * @param client the client created with winecord_init()
+ * @param channel_id the channel that the message belongs to
+ * @param message_id the message reacted to
+ * @param emoji_id the emoji id (leave as 0 if not a custom emoji)
+ * @param emoji_name the emoji name
+ * @param after start from users after this user ID, `0` for first
+ * @param attr the paginator attributes
+ * @WINEBERRY_return
+ */
+WINEBERRYcode winecord_paginate_reactions(struct winecord *client,
+                                     u64snowflake channel_id,
+                                     u64snowflake message_id,
+                                     u64snowflake emoji_id,
+                                     const char emoji_name[],
+                                     u64snowflake after,
+                                     struct winecord_paginate_users *attr);
+
+/**
+ * @brief Walk through a guild's audit log, from newest to oldest entry
+ *
+ * @param client the client created with winecord_init()
+ * @param guild_id the guild to retrieve the audit log from
+ * @param params request parameters, `before` is where it starts from and
+ *      `limit` is ignored in favor of `attr` fields
+ * @param attr the paginator attributes
+ * @WINEBERRY_return
+ */
+WINEBERRYcode winecord_paginate_guild_audit_log(
+    struct winecord *client,
+    u64snowflake guild_id,
+    struct winecord_get_guild_audit_log *params,
+    struct winecord_paginate_audit_log *attr);
+
+/**
+ * @brief Walk through a channel's public archived threads
+ *
+ * @param client the client created with winecord_init()
+ * @param channel_id the channel to be searched for threads
+ * @param before start from threads archived before this timestamp, `0` for
+ *      latest
+ * @param attr the paginator attributes
+ * @WINEBERRY_return
+ */
+WINEBERRYcode winecord_paginate_public_archived_threads(
+    struct winecord *client,
+    u64snowflake channel_id,
+    u64unix_ms before,
+    struct winecord_paginate_thread_response_body *attr);
+
+/**
+ * @brief Walk through a channel's private archived threads
+ *
+ * @param client the client created with winecord_init()
+ * @param channel_id the channel to be searched for threads
+ * @param before start from threads archived before this timestamp, `0` for
+ *      latest
+ * @param attr the paginator attributes
+ * @WINEBERRY_return
+ */
+WINEBERRYcode winecord_paginate_private_archived_threads(
+    struct winecord *client,
+    u64snowflake channel_id,
+    u64unix_ms before,
+    struct winecord_paginate_thread_response_body *attr);
+
+/**
+ * @brief Walk through a channel's private archived threads that current user
+ *      has joined
+ *
+ * @param client the client created with winecord_init()
+ * @param channel_id the channel to be searched for threads
+ * @param before start from threads archived before this timestamp, `0` for
+ *      latest
+ * @param attr the paginator attributes
+ * @WINEBERRY_return
+ */
+WINEBERRYcode winecord_paginate_joined_private_archived_threads(
+    struct winecord *client,
+    u64snowflake channel_id,
+    u64unix_ms before,
+    struct winecord_paginate_thread_response_body *attr);
+
+/** @} WinecordClientRESTPaginator */
+
+/** @defgroup WinecordClientRESTAttachment Shared attachments
+ * @brief Attachment contents that are referenced rather than copied
+ *
+ * An attachment's `content` is copied once its request is enqueued, unless
+ *      it has been shared with winecord_attachment_share(). Shared contents
+ *      are referenced by the requests instead, and kept alive until the last
+ *      of them is done, so a single buffer may be uploaded to many channels
+ *      at once. Either way the content is streamed to the connection as it
+ *      is uploaded, rather than copied into the multipart form
+ * @code{.c}
+ * winecord_attachment_share(client, content, NULL, true);
+ * for (int i = 0; i < amount; ++i)
+ *     winecord_create_message(client, channel_ids[i], &params, NULL);
+ * // content is free'd once the last upload is done
+ * winecord_attachment_unshare(client, content);
+ * @endcode
+ * @note local files set by `filename` (without `content`) are always read
+ *      from disk as they are uploaded
+ *  @{ */
+
+/**
+ * @brief Share an attachment's content between requests
+ *
+ * @param client the client created with winecord_init()
+ * @param content the attachment's content
+ * @param cleanup optional cleanup method to be called for `content`, once
+ *      it's no longer being referenced
+ * @param should_free whether `content` should be free'd after `cleanup`
+ */
+void winecord_attachment_share(struct winecord *client,
+                               void *content,
+                               void (*cleanup)(struct winecord *client,
+                                               void *content),
+                               bool should_free);
+
+/**
+ * @brief Drop the reference held to a shared content since
+ *      winecord_attachment_share()
+ *
+ * @param client the client created with winecord_init()
+ * @param content the shared content
+ */
+void winecord_attachment_unshare(struct winecord *client, void *content);
+
+/** @} WinecordClientRESTAttachment */
+
+/** @defgroup WinecordClientRESTRatelimit Ratelimiting
+ * @brief Tuning of the client-side ratelimiting
+ *  @{ */
+
+/**
+ * @brief Set how many requests per second may be sent across all routes
+ *
+ * Requests are held back before being sent once the rate is exceeded, so
+ *      that bursts spread across many routes never hit Winecord's global
+ *      ratelimit, which would stall every route. Interaction endpoints are
+ *      not accounted for, as they aren't bound to the global ratelimit
+ * @param client the client created with winecord_init()
+ * @param rate requests per second (`50` by default), `0` to disable
+ */
+void winecord_rest_set_rate(struct winecord *client, long rate);
+
+/**
+ * @brief Persist discovered ratelimiting buckets to a file
+ *
+ * Routes are matched to their buckets as their first responses arrive,
+ *      until then they are all sent one at a time. Routes persisted by
+ *      a previous run are preloaded from `path`, and routes discovered by
+ *      this run are saved to it once the client is cleaned up. The file may
+ *      also be set by the config file's `winecord.ratelimit_file` field
+ * @param client the client created with winecord_init()
+ * @param path the file that discovered routes are persisted to
+ * @note routes are preloaded from the `REST` threads shortly after, those
+ *      that have already been requested by then are discovered as usual
+ */
+void winecord_rest_persist_ratelimits(struct winecord *client,
+                                      const char path[]);
+
+/** @brief Snapshot of a route's ratelimiting bucket */
+struct winecord_ratelimit_info {
+    /** the route's key, formed from its method and endpoint (with its major
+        parameter, e.g. `:2:channels:1234:messages`) */
+    char key[256];
+    /** the bucket's ratelimiting group, `null` until the route's first
+        response arrives, `miss` if the route isn't ratelimited by any */
+    char hash[64];
+    /** requests allowed per ratelimit window */
+    long limit;
+    /** requests left until the ratelimit resets */
+    long remaining;
+    /** timestamp (in milliseconds) of when the ratelimit resets */
+    u64unix_ms reset_tstamp;
+};
+
+/**
+ * @brief Take a snapshot of every known route's ratelimiting bucket
+ *
+ * @param client the client created with winecord_init()
+ * @param[out] infos the array to write the snapshots to
+ * @param size the capacity of `infos`
+ * @return the amount of known routes, which may exceed `size` (only `size`
+ *      snapshots are written then)
+ * @note buckets keep changing as requests are performed, so the snapshot
+ *      is only approximate
+ */
+int winecord_ratelimit_inspect(struct winecord *client,
+                               struct winecord_ratelimit_info infos[],
+                               int size);
+
+/** @} WinecordClientRESTRatelimit */
+
+/** @defgroup WinecordClientRESTMetrics Metrics
+ * @brief Counters and latency histograms of each route
+ *
+ * Each route keeps track of its completed requests, retries and `429`
+ *      responses (by their `global`, `bucket` or `shared` scope), along
+ *      with latency histograms of the time spent waiting to be assigned to
+ *      its bucket, waiting on its ratelimit, and performing the HTTP
+ *      transfer. They are exported in the Prometheus text format, along
+ *      with a snapshot of each route's bucket
+ *  @{ */
+
+/**
+ * @brief Write the REST metrics to a file
+ *
+ * The file is replaced at once, so that a scraper never reads a partial
+ *      export
+ * @param client the client created with winecord_init()
+ * @param path the file to write to
+ * @WINEBERRY_return
+ */
+WINEBERRYcode winecord_rest_metrics_export(struct winecord *client,
+                                          const char path[]);
+
+/**
+ * @brief Serve the REST metrics from a Unix socket
+ *
+ * Every connection to the socket is sent the REST metrics, and closed
+ * @code{.sh}
+ * $ socat - UNIX-CONNECT:/tmp/bot-metrics.sock
+ * @endcode
+ * @param client the client created with winecord_init()
+ * @param path the Unix socket path, replaced if it already exists, and
+ *      removed at winecord_cleanup()
+ * @WINEBERRY_return
+ * @note connections are served from the main thread, in between Gateway
+ *      events, and without waiting on a connection that is slow to read
+ */
+WINEBERRYcode winecord_rest_metrics_serve(struct winecord *client,
+                                         const char path[]);
+
+/** @} WinecordClientRESTMetrics */
+
+/** @defgroup WinecordClientRESTRetry Retry policies
+ * @brief Tuning of how failed requests are retried
+ *
+ * Requests that fail with a server error or a transient transport error
+ *      (couldn't connect, timed out or connection reset, the latter two not
+ *      being retried for `POST` requests) are retried after an exponential
+ *      backoff with jitter, so that a struggling route isn't hammered by
+ *      every retry at once. Retries are also bound by a budget that is
+ *      refilled as requests are sent, so that a storm of failures doesn't
+ *      amplify the load. Once a route keeps failing its circuit is opened,
+ *      and its requests fail with
+ *      @ref WINEBERRY_WINECORD_CIRCUIT_OPEN for as long as the cooldown. The
+ *      circuit is then half-open: a single request is let through while the
+ *      others wait, closing it if it succeeds or reopening it otherwise
+ * @note requests that are ratelimited are always retried once their
+ *      ratelimit resets
+ *  @{ */
+
+/** @brief Retry policy of a route */
+struct winecord_retry_policy {
+    /** max amount of retries before a failed request gives up */
+    int max_attempts;
+    /** backoff before the first retry, doubled at each following one */
+    u64unix_ms base_delay_ms;
+    /** backoff cap */
+    u64unix_ms max_delay_ms;
+    /** retries that are allowed per request sent, once the reserve of
+        retries has been spent, `0` for unbounded retries */
+    double budget_ratio;
+    /** consecutive failures after which the route's circuit is opened, `0`
+        to never open it */
+    int failure_threshold;
+    /** how long the route's circuit is kept open before a request may be
+        sent again */
+    u64unix_ms cooldown_ms;
+};
+
+/** @brief The retry policy of routes that haven't been assigned one */
+#define WINECORD_RETRY_POLICY_DEFAULT                                         \
+    {                                                                         \
+        .max_attempts = 3, .base_delay_ms = 500, .max_delay_ms = 16000,       \
+        .budget_ratio = 0.2, .failure_threshold = 5, .cooldown_ms = 10000,    \
+    }
+
+/**
+ * @brief Assign a retry policy to a route
+ *
+ * Routes are identified by their endpoint format string, as it appears at
+ *      the Winecord API documentation
+ * @code{.c}
+ * winecord_rest_set_retry_policy(
+ *     client, "/channels/%" PRIu64 "/messages",
+ *     &(struct winecord_retry_policy){ .max_attempts = 5,
+ *                                      .base_delay_ms = 250,
+ *                                      .max_delay_ms = 8000 });
+ * @endcode
+ * @param client the client created with winecord_init()
+ * @param route the route's endpoint format string, `NULL` to replace the
+ *      default policy
+ * @param policy the policy to be assigned
+ */
+void winecord_rest_set_retry_policy(struct winecord *client,
+                                    const char route[],
+                                    const struct winecord_retry_policy *policy);
+
+/** @} WinecordClientRESTRetry */
+
+/** @defgroup WinecordClientRESTExecutor Completion executors
+ * @brief Where the callbacks of completed requests are executed
+ *
+ * By default callbacks are executed from the main thread in between Gateway
+ *      events, so a slow event callback holds back every completion. They
+ *      may instead be handed over to the worker threadpool, either
+ *      unordered or in ordered lanes (by default one per channel, guild or
+ *      webhook). A request's `executor` field overrides the client's
+ * @note callbacks that aren't executed from the main thread must be
+ *      thread-safe, and @ref WINECORD_EXECUTOR_WORKER gives no ordering:
+ *      callbacks of requests completed in sequence may be executed
+ *      concurrently. Paginators are kept to their parent's lane instead
+ *  @{ */
+
+/**
+ * @brief Set where the callbacks of the client's completed requests are
+ *      executed
+ *
+ * @param client the client created with winecord_init()
+ * @param executor the executor of requests that don't set their own,
+ *      @ref WINECORD_EXECUTOR_MAIN by default
+ */
+void winecord_rest_set_executor(struct winecord *client,
+                                enum winecord_executor executor);
+
+/** @} WinecordClientRESTExecutor */
+
+/** @defgroup WinecordClientRESTConnections Connections
+ * @brief Keeping connections to the API host warm
+ *
+ * Connections are opened as requests are sent, so the first request after
+ *      an idle period pays for DNS, TCP and TLS setup (which may take a
+ *      good part of an interaction's 3 seconds window). Connections may
+ *      instead be opened ahead of requests, and kept warm across idle gaps
+ *  @{ */
+
+/** @brief Connection reuse of the client's requests */
+struct winecord_connection_stats {
+    /** requests transferred, including retries */
+    uint64_t transfers;
+    /** requests that reused an open connection */
+    uint64_t reused;
+    /** connections opened by requests, paying for their setup */
+    uint64_t handshakes;
+    /** connections opened ahead of requests */
+    uint64_t warm_handshakes;
+    /** ratio of requests that reused an open connection */
+    double reuse_ratio;
+};
+
+/**
+ * @brief Set the amount of connections kept warm by each `REST` thread
+ *
+ * Connections are opened at once, and warmed up again whenever no request
+ *      has been sent for a while
+ * @param client the client created with winecord_init()
+ * @param amount the amount of connections (up to 16), `0` to disable it
+ * @note may also be set with the `WINEBERRY_REST_WARM_CONNECTIONS`
+ *      environment variable, so connections are opened at winecord_init()
+ */
+void winecord_rest_set_warm_connections(struct winecord *client, int amount);
+
+/**
+ * @brief Get the connection reuse of the client's requests
+ *
+ * @param client the client created with winecord_init()
+ * @param stats the stats to be written to
+ */
+void winecord_rest_get_connection_stats(
+    struct winecord *client, struct winecord_connection_stats *stats);
+
+/**
+ * @brief Get the adaptive limit of in-flight transfers
+ *
+ * Each `REST` thread limits its transfers in flight, the limit grows by one
+ *      per round of healthy transfers, and is halved once transfers time
+ *      out, get ratelimited, fail with a server error or take much longer
+ *      than usual. So that transfers don't pile up once the API slows down
+ * @param client the client created with winecord_init()
+ * @return the sum of every `REST` thread's limit
+ */
+int winecord_rest_get_inflight_limit(struct winecord *client);
+
+/**
+ * @brief Duplicate `GET` requests that take longer than usual
+ *
+ * Once a `GET` request has taken longer than its route's p95 latency, a
+ *      duplicate is sent over another connection and the first response
+ *      received is kept, the other transfer is stopped. Duplicates are only
+ *      sent while the route's bucket, the global ratelimit and the
+ *      in-flight limit have a request to spare
+ * @param client the client created with winecord_init()
+ * @param enable `true` to duplicate slow `GET` requests, `false` by default
+ * @note streamed lists and revalidated cached responses aren't duplicated
+ */
+void winecord_rest_set_hedging(struct winecord *client, bool enable);
+
+/** @} WinecordClientRESTConnections */
+
+/** @defgroup WinecordClientRESTFairness Fair queuing
+ * @brief Keeping a tenant's backlog from holding back everyone else
+ *
+ * Requests that share a bucket are sent in order of their scheduling class
+ *      and deadline, and then by weighted fair queuing across their tenant.
+ *      A guild running a mass action only pushes back its own requests,
+ *      rather than the replies of every other guild
+ *
+ * A request's tenant is its `tenant` field, or else the guild of the
+ *      Gateway event whose callback it is made from (requests made from a
+ *      request's callbacks share its tenant). Any other request falls back
+ *      to its route's guild, channel or webhook id, which every request of
+ *      its bucket shares: those of routes without one (e.g. interaction
+ *      responses made from outside an event callback) are only fairly
+ *      queued with an explicit `tenant`
+ *  @{ */
+
+/**
+ * @brief Set the weight of a tenant's requests
+ *
+ * A tenant of weight `2` is sent twice as many requests as a tenant of
+ *      weight `1` while both have requests queued at the same bucket
+ * @param client the client created with winecord_init()
+ * @param tenant the tenant's key (e.g. a guild id)
+ * @param weight the tenant's weight (up to 1024), `1` by default
+ */
+void winecord_rest_set_tenant_weight(struct winecord *client,
+                                     u64snowflake tenant,
+                                     int weight);
+
+/** @} WinecordClientRESTFairness */
+
+/** @defgroup WinecordClientRESTWebhooks Webhook executor
+ * @brief Fan out embeds to many webhooks
+ *
+ * Embeds are queued per webhook, and each webhook has a single message in
+ *      flight at a time: while it waits on the webhook's bucket, embeds
+ *      pushed in the meantime are merged into its next message (up to 10
+ *      per message). A REST-only process may then push to hundreds of
+ *      webhooks without keeping track of their ratelimits
+ * @code{.c}
+ * struct winecord *client = winecord_init(NULL);
+ * struct winecord_embed embed = { .title = "Deploy finished" };
+ *
+ * for (int i = 0; i < n_webhooks; ++i)
+ *     winecord_rest_webhook_push(client, webhooks[i].id, webhooks[i].token,
+ *                                &embed);
+ * @endcode
+ *  @{ */
+
+/**
+ * @brief Queue an embed to be sent by a webhook
+ *
+ * @param client the client created with winecord_init()
+ * @param webhook_id the webhook to send the embed
+ * @param webhook_token the webhook's token, replaces the one it has been
+ *      pushed to with
+ * @param embed the embed to be sent, serialized at once so it may be
+ *      cleaned up after the call
+ * @WINEBERRY_return
+ * @note messages that fail are logged and dropped
+ */
+WINEBERRYcode winecord_rest_webhook_push(struct winecord *client,
+                                        u64snowflake webhook_id,
+                                        const char webhook_token[],
+                                        const struct winecord_embed *embed);
+
+/** @} WinecordClientRESTWebhooks */
+
+/** @defgroup WinecordClientRESTBans Bulk bans
+ * @brief Ban many users of a guild at once
+ *
+ * Rather than a request per banned user, users are banned in batches of up
+ *      to 200 per request. Individual winecord_create_guild_ban() calls may
+ *      also be coalesced: calls for the same guild issued within a short
+ *      window are merged into bulk bans, so that a raid of thousands of
+ *      accounts is stopped by a handful of requests
+ *  @{ */
+
+/** @brief Parameters of winecord_bulk_guild_ban() */
+struct winecord_bulk_guild_ban {
+    /** the users to be banned, split into batches of up to 200 */
+    struct snowflakes *user_ids;
+    /** seconds of messages to be deleted (up to 604800) */
+    int delete_message_seconds;
+    /** the audit log reason */
+    char *reason;
+};
+
+/** @brief Outcome of a bulk ban */
+struct winecord_bulk_ban {
+    /** the users that have been banned */
+    struct snowflakes *banned_users;
+    /** the users that couldn't be banned */
+    struct snowflakes *failed_users;
+};
+
+/** @brief Serialize a @ref winecord_bulk_guild_ban batch
+ *      @see winecord_bulk_guild_ban() */
+size_t winecord_bulk_guild_ban_to_json(
+    char buf[], size_t size, const struct winecord_bulk_guild_ban *this);
+/** @brief Initialize a @ref winecord_bulk_ban */
+void winecord_bulk_ban_init(struct winecord_bulk_ban *this);
+/** @brief Populate a @ref winecord_bulk_ban from its JSON */
+size_t winecord_bulk_ban_from_json(const char buf[],
+                                   size_t size,
+                                   struct winecord_bulk_ban *this);
+/** @brief Free the fields of a @ref winecord_bulk_ban */
+void winecord_bulk_ban_cleanup(struct winecord_bulk_ban *this);
+
+/**
+ * @brief Ban users from a guild, and delete their messages
+ * @note Requires the BAN_MEMBERS and MANAGE_GUILD permissions
+ *
+ * @param client the client created with winecord_init()
+ * @param guild_id the guild the users belong to
+ * @param params request parameters
+ * @WINEBERRY_ret_obj{ret,bulk_ban}
+ * @WINEBERRY_return
+ * @note users are sent in batches of up to 200 per request, the `done` and
+ *      `fail` callbacks are executed per batch
+ * @note in `sync` mode the batches are performed in turn, an outcome may
+ *      only be written to `ret->sync` for up to 200 users
+ */
+WINEBERRYcode winecord_bulk_guild_ban(struct winecord *client,
+                                     u64snowflake guild_id,
+                                     struct winecord_bulk_guild_ban *params,
+                                     struct winecord_ret_bulk_ban *ret);
+
+/**
+ * @brief Coalesce winecord_create_guild_ban() calls into bulk bans
+ *
+ * Bans of a guild are collected for `window_ms` from the first one, and
+ *      then sent as bulk bans of up to 200 users. Users a bulk ban fails
+ *      for (e.g. already banned ones) are then banned on their own, so a
+ *      ban's callbacks get the same outcome as an uncoalesced one
+ * @param client the client created with winecord_init()
+ * @param window_ms the time bans are collected for, `0` to disable it
+ * @note bulk bans require the `MANAGE_GUILD` permission, on top of the
+ *      `BAN_MEMBERS` one required by winecord_create_guild_ban()
+ * @note bans performed in `sync` mode or with a future aren't coalesced
+ * @note callbacks of coalesced bans are executed from the client's executor
+ * @see winecord_rest_set_executor()
+ */
+void winecord_rest_set_ban_coalescing(struct winecord *client,
+                                      u64unix_ms window_ms);
+
+/** @} WinecordClientRESTBans */
+
+/** @defgroup WinecordClientRESTRoles Role changes
+ * @brief Coalesce a member's role changes into a single request
+ *
+ * Bots that sync roles add or remove them one at a time, each a request
+ *      to the same member's bucket. Role changes of a member may instead be
+ *      collected for a short window, so that changes that cancel each other
+ *      out are dropped, and many of them are applied to the member's current
+ *      roles with a single winecord_modify_guild_member()
+ *  @{ */
+
+/**
+ * @brief Coalesce winecord_add_guild_member_role() and
+ *      winecord_remove_guild_member_role() calls into member modifies
+ *
+ * Role changes of a member are collected for `window_ms` from the first
+ *      one, the last change of a role being the one that's kept. If only up
+ *      to 2 roles are changed, each is added or removed with a request of its
+ *      own. Otherwise the member is fetched, and its final roles sent at once
+ *      (changes are applied in the order they were issued). Changes issued
+ *      while those requests are in flight are collected for the next ones
+ * @param client the client created with winecord_init()
+ * @param window_ms the time role changes are collected for, `0` to disable
+ *      it
+ * @note role changes performed in `sync` mode or with a future aren't
+ *      coalesced
+ * @note callbacks of coalesced changes are executed from the client's
+ *      executor
+ * @see winecord_rest_set_executor()
+ * @note the member is always fetched from Winecord, rather than from the
+ *      response cache @see winecord_rest_cache_enable()
+ * @warning when more than 2 roles are changed, the member's whole roles are
+ *      written back: roles changed by anyone else (another bot, a moderator
+ *      or a request made without coalescing) in between fetching the member
+ *      and modifying it are overwritten
+ */
+void winecord_rest_set_role_coalescing(struct winecord *client,
+                                       u64unix_ms window_ms);
+
+/** @} WinecordClientRESTRoles */
+
+/** @} WinecordClientREST */
+
+#endif /* WINECORD_REST_H */
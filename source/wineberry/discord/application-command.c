@@ -31,8 +31,6 @@ winecord_create_global_application_command(
     struct winecord_ret_application_command *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct ccord_szbuf body;
-    char buf[4096];
 
     WINEBERRY_EXPECT(client, application_id != 0, WINEBERRY_BAD_PARAMETER, "");
     WINEBERRY_EXPECT(client, params != NULL, WINEBERRY_BAD_PARAMETER, "");
@@ -42,11 +40,10 @@ winecord_create_global_application_command(
 
     WINECORD_ATTR_INIT(attr, winecord_application_command, ret, NULL);
 
-    body.size = winecord_create_global_application_command_to_json(
-        buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_create_global_application_command,
+                            params);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_POST,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_POST,
                             "/applications/%" PRIu64 "/commands",
                             application_id);
 }
@@ -79,19 +76,16 @@ winecord_edit_global_application_command(
     struct winecord_ret_application_command *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct ccord_szbuf body;
-    char buf[4096];
 
     WINEBERRY_EXPECT(client, application_id != 0, WINEBERRY_BAD_PARAMETER, "");
     WINEBERRY_EXPECT(client, command_id != 0, WINEBERRY_BAD_PARAMETER, "");
 
-    body.size = winecord_edit_global_application_command_to_json(
-        buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_edit_global_application_command,
+                            params);
 
     WINECORD_ATTR_INIT(attr, winecord_application_command, ret, NULL);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_PATCH,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_PATCH,
                             "/applications/%" PRIu64 "/commands/%" PRIu64,
                             application_id, command_id);
 }
@@ -122,18 +116,15 @@ winecord_bulk_overwrite_global_application_commands(
     struct winecord_ret_application_commands *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct ccord_szbuf body;
-    char buf[8192];
 
     WINEBERRY_EXPECT(client, application_id != 0, WINEBERRY_BAD_PARAMETER, "");
     WINEBERRY_EXPECT(client, params != NULL, WINEBERRY_BAD_PARAMETER, "");
 
-    body.size = winecord_application_commands_to_json(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_application_commands, params);
 
     WINECORD_ATTR_LIST_INIT(attr, winecord_application_commands, ret, NULL);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_PUT,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_PUT,
                             "/applications/%" PRIu64 "/commands",
                             application_id);
 }
@@ -167,8 +158,6 @@ winecord_create_guild_application_command(
     struct winecord_ret_application_command *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct ccord_szbuf body;
-    char buf[4096];
 
     WINEBERRY_EXPECT(client, application_id != 0, WINEBERRY_BAD_PARAMETER, "");
     WINEBERRY_EXPECT(client, guild_id != 0, WINEBERRY_BAD_PARAMETER, "");
@@ -177,13 +166,12 @@ winecord_create_guild_application_command(
     WINEBERRY_EXPECT(client, NOT_EMPTY_STR(params->description),
                  WINEBERRY_BAD_PARAMETER, "");
 
-    body.size = winecord_create_guild_application_command_to_json(
-        buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_create_guild_application_command,
+                            params);
 
     WINECORD_ATTR_INIT(attr, winecord_application_command, ret, NULL);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_POST,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_POST,
                             "/applications/%" PRIu64 "/guilds/%" PRIu64
                             "/commands",
                             application_id, guild_id);
@@ -221,20 +209,17 @@ winecord_edit_guild_application_command(
     struct winecord_ret_application_command *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct ccord_szbuf body;
-    char buf[4096];
 
     WINEBERRY_EXPECT(client, application_id != 0, WINEBERRY_BAD_PARAMETER, "");
     WINEBERRY_EXPECT(client, guild_id != 0, WINEBERRY_BAD_PARAMETER, "");
     WINEBERRY_EXPECT(client, command_id != 0, WINEBERRY_BAD_PARAMETER, "");
 
-    body.size = winecord_edit_guild_application_command_to_json(
-        buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_edit_guild_application_command,
+                            params);
 
     WINECORD_ATTR_INIT(attr, winecord_application_command, ret, NULL);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_PATCH,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_PATCH,
                             "/applications/%" PRIu64 "/guilds/%" PRIu64
                             "/commands/%" PRIu64,
                             application_id, guild_id, command_id);
@@ -270,20 +255,17 @@ winecord_bulk_overwrite_guild_application_commands(
     struct winecord_ret_application_commands *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct ccord_szbuf body;
-    char buf[8192];
 
     WINEBERRY_EXPECT(client, application_id != 0, WINEBERRY_BAD_PARAMETER, "");
     WINEBERRY_EXPECT(client, guild_id != 0, WINEBERRY_BAD_PARAMETER, "");
     WINEBERRY_EXPECT(client, params != NULL, WINEBERRY_BAD_PARAMETER, "");
 
-    body.size = winecord_bulk_overwrite_guild_application_commands_to_json(
-        buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(
+        attr, winecord_bulk_overwrite_guild_application_commands, params);
 
     WINECORD_ATTR_LIST_INIT(attr, winecord_application_commands, ret, NULL);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_PUT,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_PUT,
                             "/applications/%" PRIu64 "/guilds/%" PRIu64
                             "/commands",
                             application_id, guild_id);
@@ -51,8 +51,6 @@ winecord_create_auto_moderation_rule(
     struct winecord_ret_auto_moderation_rule *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct ccord_szbuf body;
-    char buf[4096];
 
     WINEBERRY_EXPECT(client, guild_id != 0, WINEBERRY_BAD_PARAMETER, "");
     WINEBERRY_EXPECT(client, params != NULL, WINEBERRY_BAD_PARAMETER, "");
@@ -63,11 +61,9 @@ winecord_create_auto_moderation_rule(
 
     WINECORD_ATTR_INIT(attr, winecord_auto_moderation_rule, ret, params->reason);
 
-    body.size =
-        winecord_create_auto_moderation_rule_to_json(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_create_auto_moderation_rule, params);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_POST,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_POST,
                             "/guilds/%" PRIu64 "/auto-moderation/rules",
                             guild_id);
 }
@@ -81,8 +77,6 @@ winecord_modify_auto_moderation_rule(
     struct winecord_ret_auto_moderation_rule *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct ccord_szbuf body;
-    char buf[4096];
 
     WINEBERRY_EXPECT(client, guild_id != 0, WINEBERRY_BAD_PARAMETER, "");
     WINEBERRY_EXPECT(client, auto_moderation_rule_id != 0, WINEBERRY_BAD_PARAMETER,
@@ -94,11 +88,9 @@ winecord_modify_auto_moderation_rule(
 
     WINECORD_ATTR_INIT(attr, winecord_auto_moderation_rule, ret, params->reason);
 
-    body.size =
-        winecord_modify_auto_moderation_rule_to_json(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_modify_auto_moderation_rule, params);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_PATCH,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_PATCH,
                             "/guilds/%" PRIu64
                             "/auto-moderation/rules/%" PRIu64,
                             guild_id, auto_moderation_rule_id);
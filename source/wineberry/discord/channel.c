@@ -7,6 +7,10 @@
 #include "winecord-request.h"
 #include "queriec.h"
 
+/* lists that are decoded as their elements are received */
+WINECORD_LIST_ACCESSOR(winecord_messages)
+WINECORD_LIST_ACCESSOR(winecord_users)
+
 /******************************************************************************
  * Custom functions
  ******************************************************************************/
@@ -119,18 +123,15 @@ winecord_modify_channel(struct winecord *client,
                        struct winecord_ret_channel *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct ccord_szbuf body;
-    char buf[1024];
 
     WINEBERRY_EXPECT(client, channel_id != 0, WINEBERRY_BAD_PARAMETER, "");
     WINEBERRY_EXPECT(client, params != NULL, WINEBERRY_BAD_PARAMETER, "");
 
-    body.size = winecord_modify_channel_to_json(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_modify_channel, params);
 
     WINECORD_ATTR_INIT(attr, winecord_channel, ret, params->reason);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_PATCH,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_PATCH,
                             "/channels/%" PRIu64, channel_id);
 }
 
@@ -199,7 +200,8 @@ winecord_get_channel_messages(struct winecord *client,
         }
     }
 
-    WINECORD_ATTR_LIST_INIT(attr, winecord_messages, ret, NULL);
+    WINECORD_ATTR_STREAM_INIT(attr, winecord_messages, winecord_message, ret,
+                              NULL);
 
     return winecord_rest_run(&client->rest, &attr, NULL, HTTP_GET,
                             "/channels/%" PRIu64 "/messages%s", channel_id,
@@ -231,9 +233,7 @@ winecord_create_message(struct winecord *client,
                        struct winecord_ret_message *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct ccord_szbuf body;
     enum http_method method;
-    char buf[16384]; /**< @todo dynamic buffer */
 
     WINEBERRY_EXPECT(client, channel_id != 0, WINEBERRY_BAD_PARAMETER, "");
     WINEBERRY_EXPECT(client, params != NULL, WINEBERRY_BAD_PARAMETER, "");
@@ -247,12 +247,11 @@ winecord_create_message(struct winecord *client,
         method = HTTP_POST;
     }
 
-    body.size = winecord_create_message_to_json(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_create_message, params);
 
     WINECORD_ATTR_INIT(attr, winecord_message, ret, NULL);
 
-    return winecord_rest_run(&client->rest, &attr, &body, method,
+    return winecord_rest_run(&client->rest, &attr, NULL, method,
                             "/channels/%" PRIu64 "/messages", channel_id);
 }
 
@@ -443,7 +442,7 @@ winecord_get_reactions(struct winecord *client,
     else
         snprintf(emoji_endpoint, sizeof(emoji_endpoint), "%s", pct_emoji_name);
 
-    WINECORD_ATTR_LIST_INIT(attr, winecord_users, ret, NULL);
+    WINECORD_ATTR_STREAM_INIT(attr, winecord_users, winecord_user, ret, NULL);
 
     code = winecord_rest_run(&client->rest, &attr, NULL, HTTP_GET,
                             "/channels/%" PRIu64 "/messages/%" PRIu64
@@ -519,19 +518,16 @@ winecord_edit_message(struct winecord *client,
                      struct winecord_ret_message *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct ccord_szbuf body;
-    char buf[16384]; /**< @todo dynamic buffer */
 
     WINEBERRY_EXPECT(client, channel_id != 0, WINEBERRY_BAD_PARAMETER, "");
     WINEBERRY_EXPECT(client, message_id != 0, WINEBERRY_BAD_PARAMETER, "");
     WINEBERRY_EXPECT(client, params != NULL, WINEBERRY_BAD_PARAMETER, "");
 
-    body.size = winecord_edit_message_to_json(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_edit_message, params);
 
     WINECORD_ATTR_INIT(attr, winecord_message, ret, NULL);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_PATCH,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_PATCH,
                             "/channels/%" PRIu64 "/messages/%" PRIu64,
                             channel_id, message_id);
 }
@@ -564,8 +560,6 @@ winecord_bulk_delete_messages(struct winecord *client,
 {
     const u64unix_ms now = winecord_timestamp(client);
     struct winecord_attributes attr = { 0 };
-    struct ccord_szbuf body;
-    char buf[4096] = "";
 
     WINEBERRY_EXPECT(client, params != NULL, WINEBERRY_BAD_PARAMETER, "");
     WINEBERRY_EXPECT(client, params->messages != NULL, WINEBERRY_BAD_PARAMETER, "");
@@ -581,12 +575,11 @@ winecord_bulk_delete_messages(struct winecord *client,
                      "Messages should not be older than 2 weeks.");
     }
 
-    body.size = winecord_bulk_delete_messages_to_json(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_bulk_delete_messages, params);
 
     WINECORD_ATTR_BLANK_INIT(attr, ret, params->reason);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_POST,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_POST,
                             "/channels/%" PRIu64 "/messages/bulk-delete",
                             channel_id);
 }
@@ -600,20 +593,16 @@ winecord_edit_channel_permissions(
     struct winecord_ret *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct ccord_szbuf body;
-    char buf[1024];
 
     WINEBERRY_EXPECT(client, channel_id != 0, WINEBERRY_BAD_PARAMETER, "");
     WINEBERRY_EXPECT(client, overwrite_id != 0, WINEBERRY_BAD_PARAMETER, "");
     WINEBERRY_EXPECT(client, params != NULL, WINEBERRY_BAD_PARAMETER, "");
 
-    body.size =
-        winecord_edit_channel_permissions_to_json(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_edit_channel_permissions, params);
 
     WINECORD_ATTR_BLANK_INIT(attr, ret, params->reason);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_PUT,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_PUT,
                             "/channels/%" PRIu64 "/permissions/%" PRIu64,
                             channel_id, overwrite_id);
 }
@@ -640,19 +629,15 @@ winecord_create_channel_invite(struct winecord *client,
                               struct winecord_ret_invite *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct ccord_szbuf body;
-    char buf[1024];
 
     WINEBERRY_EXPECT(client, channel_id != 0, WINEBERRY_BAD_PARAMETER, "");
 
-    body.size =
-        winecord_create_channel_invite_to_json(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_create_channel_invite, params);
 
     WINECORD_ATTR_INIT(attr, winecord_invite, ret,
                       params ? params->reason : NULL);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_POST,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_POST,
                             "/channels/%" PRIu64 "/invites", channel_id);
 }
 
@@ -683,20 +668,17 @@ winecord_follow_news_channel(struct winecord *client,
                             struct winecord_ret_followed_channel *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct ccord_szbuf body;
-    char buf[256]; /* should be more than enough for this */
 
     WINEBERRY_EXPECT(client, channel_id != 0, WINEBERRY_BAD_PARAMETER, "");
     WINEBERRY_EXPECT(client, params != NULL, WINEBERRY_BAD_PARAMETER, "");
     WINEBERRY_EXPECT(client, params->webhook_channel_id != 0, WINEBERRY_BAD_PARAMETER,
                  "");
 
-    body.size = winecord_follow_news_channel_to_json(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_follow_news_channel, params);
 
     WINECORD_ATTR_INIT(attr, winecord_channel, ret, NULL);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_POST,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_POST,
                             "/channels/%" PRIu64 "/followers", channel_id);
 }
 
@@ -724,7 +706,8 @@ winecord_get_pinned_messages(struct winecord *client,
 
     WINEBERRY_EXPECT(client, channel_id != 0, WINEBERRY_BAD_PARAMETER, "");
 
-    WINECORD_ATTR_LIST_INIT(attr, winecord_messages, ret, NULL);
+    WINECORD_ATTR_STREAM_INIT(attr, winecord_messages, winecord_message, ret,
+                              NULL);
 
     return winecord_rest_run(&client->rest, &attr, NULL, HTTP_GET,
                             "/channels/%" PRIu64 "/pins", channel_id);
@@ -776,20 +759,16 @@ winecord_group_dm_add_recipient(struct winecord *client,
                                struct winecord_ret *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct ccord_szbuf body;
-    char buf[1024];
 
     WINEBERRY_EXPECT(client, channel_id != 0, WINEBERRY_BAD_PARAMETER, "");
     WINEBERRY_EXPECT(client, user_id != 0, WINEBERRY_BAD_PARAMETER, "");
     WINEBERRY_EXPECT(client, params != NULL, WINEBERRY_BAD_PARAMETER, "");
 
-    body.size =
-        winecord_group_dm_add_recipient_to_json(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_group_dm_add_recipient, params);
 
     WINECORD_ATTR_BLANK_INIT(attr, ret, NULL);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_PUT,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_PUT,
                             "/channels/%" PRIu64 "/recipients/%" PRIu64,
                             channel_id, user_id);
 }
@@ -821,20 +800,16 @@ winecord_start_thread_with_message(
     struct winecord_ret_channel *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct ccord_szbuf body;
-    char buf[1024];
 
     WINEBERRY_EXPECT(client, channel_id != 0, WINEBERRY_BAD_PARAMETER, "");
     WINEBERRY_EXPECT(client, message_id != 0, WINEBERRY_BAD_PARAMETER, "");
     WINEBERRY_EXPECT(client, params != NULL, WINEBERRY_BAD_PARAMETER, "");
 
-    body.size =
-        winecord_start_thread_with_message_to_json(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_start_thread_with_message, params);
 
     WINECORD_ATTR_INIT(attr, winecord_channel, ret, params->reason);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_POST,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_POST,
                             "/channels/%" PRIu64 "/messages/%" PRIu64
                             "/threads",
                             channel_id, message_id);
@@ -848,19 +823,16 @@ winecord_start_thread_without_message(
     struct winecord_ret_channel *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct ccord_szbuf body;
-    char buf[1024];
 
     WINEBERRY_EXPECT(client, channel_id != 0, WINEBERRY_BAD_PARAMETER, "");
     WINEBERRY_EXPECT(client, params != NULL, WINEBERRY_BAD_PARAMETER, "");
 
-    body.size =
-        winecord_start_thread_without_message_to_json(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_start_thread_without_message,
+                            params);
 
     WINECORD_ATTR_INIT(attr, winecord_channel, ret, params->reason);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_POST,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_POST,
                             "/channels/%" PRIu64 "/threads", channel_id);
 }
 
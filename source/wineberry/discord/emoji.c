@@ -46,18 +46,15 @@ winecord_create_guild_emoji(struct winecord *client,
                            struct winecord_ret_emoji *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct wineberry_szbuf body;
-    char buf[2048];
 
     WINEBERRY_EXPECT(client, guild_id != 0, WINEBERRY_BAD_PARAMETER, "");
     WINEBERRY_EXPECT(client, params != NULL, WINEBERRY_BAD_PARAMETER, "");
 
-    body.size = winecord_create_guild_emoji_to_json(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_create_guild_emoji, params);
 
     WINECORD_ATTR_INIT(attr, winecord_emoji, ret, params->reason);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_POST,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_POST,
                             "/guilds/%" PRIu64 "/emojis", guild_id);
 }
 
@@ -69,19 +66,16 @@ winecord_modify_guild_emoji(struct winecord *client,
                            struct winecord_ret_emoji *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct wineberry_szbuf body;
-    char buf[2048];
 
     WINEBERRY_EXPECT(client, guild_id != 0, WINEBERRY_BAD_PARAMETER, "");
     WINEBERRY_EXPECT(client, emoji_id != 0, WINEBERRY_BAD_PARAMETER, "");
     WINEBERRY_EXPECT(client, params != NULL, WINEBERRY_BAD_PARAMETER, "");
 
-    body.size = winecord_modify_guild_emoji_to_json(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_modify_guild_emoji, params);
 
     WINECORD_ATTR_INIT(attr, winecord_emoji, ret, params->reason);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_PATCH,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_PATCH,
                             "/guilds/%" PRIu64 "/emojis/%" PRIu64, guild_id,
                             emoji_id);
 }
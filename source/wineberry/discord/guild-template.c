@@ -30,19 +30,16 @@ winecord_create_guild_from_guild_template(
     struct winecord_ret_guild *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct wineberry_szbuf body;
-    char buf[256] = { 0 };
 
     WINEBERRY_EXPECT(client, NOT_EMPTY_STR(template_code), WINEBERRY_BAD_PARAMETER,
                  "");
 
-    body.size = winecord_create_guild_from_guild_template_to_json(
-        buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_create_guild_from_guild_template,
+                            params);
 
     WINECORD_ATTR_INIT(attr, winecord_guild, ret, NULL);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_POST,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_POST,
                             "/guilds/templates/%s", template_code);
 }
 
@@ -68,18 +65,14 @@ winecord_create_guild_template(struct winecord *client,
                               struct winecord_ret_guild_template *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct wineberry_szbuf body;
-    char buf[256];
 
     WINEBERRY_EXPECT(client, guild_id != 0, WINEBERRY_BAD_PARAMETER, "");
 
-    body.size =
-        winecord_create_guild_template_to_json(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_create_guild_template, params);
 
     WINECORD_ATTR_INIT(attr, winecord_guild_template, ret, NULL);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_POST,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_POST,
                             "/guilds/%" PRIu64 "/templates", guild_id);
 }
 
@@ -110,20 +103,16 @@ winecord_modify_guild_template(struct winecord *client,
                               struct winecord_ret_guild_template *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct wineberry_szbuf body;
-    char buf[1024] = { 0 };
 
     WINEBERRY_EXPECT(client, guild_id != 0, WINEBERRY_BAD_PARAMETER, "");
     WINEBERRY_EXPECT(client, NOT_EMPTY_STR(template_code), WINEBERRY_BAD_PARAMETER,
                  "");
 
-    body.size =
-        winecord_modify_guild_template_from_json(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_modify_guild_template, params);
 
     WINECORD_ATTR_INIT(attr, winecord_guild_template, ret, NULL);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_PATCH,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_PATCH,
                             "/guilds/%" PRIu64 "/templates/%s", guild_id,
                             template_code);
 }
@@ -5,25 +5,27 @@
 #include "winecord.h"
 #include "winecord-internal.h"
 #include "winecord-request.h"
+#include "winecord-rest.h"
 #include "queriec.h"
 
+/* lists that are decoded as their elements are received */
+WINECORD_LIST_ACCESSOR(winecord_guild_members)
+WINECORD_LIST_ACCESSOR(winecord_bans)
+
 WINEBERRY
 winecord_create_guild(struct WINECORD *client,
                      struct winecord_create_guild *params,
                      struct winecord_ret_guild *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct ccord_szbuf body;
-    char buf[4096];
 
     CCORD_EXPECT(client, params != NULL, CCORD_BAD_PARAMETER, "");
 
-    body.size = winecord_create_guild_to_json(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_create_guild, params);
 
     WINECORD_ATTR_INIT(attr, winecord_guild, ret, NULL);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_POST, "/guilds");
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_POST, "/guilds");
 }
 
 WINEBERRY
@@ -63,18 +65,15 @@ winecord_modify_guild(struct WINECORD *client,
                      struct winecord_ret_guild *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct ccord_szbuf body;
-    char buf[4096];
 
     CCORD_EXPECT(client, guild_id != 0, CCORD_BAD_PARAMETER, "");
     CCORD_EXPECT(client, params != NULL, CCORD_BAD_PARAMETER, "");
 
-    body.size = winecord_modify_guild_to_json(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_modify_guild, params);
 
     WINECORD_ATTR_INIT(attr, winecord_guild, ret, params->reason);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_PATCH,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_PATCH,
                             "/guilds/%" PRIu64, guild_id);
 }
 
@@ -115,18 +114,15 @@ winecord_create_guild_channel(struct WINECORD *client,
                              struct winecord_ret_channel *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct ccord_szbuf body;
-    char buf[2048];
 
     CCORD_EXPECT(client, guild_id != 0, CCORD_BAD_PARAMETER, "");
     CCORD_EXPECT(client, params != NULL, CCORD_BAD_PARAMETER, "");
 
-    body.size = winecord_create_guild_channel_to_json(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_create_guild_channel, params);
 
     WINECORD_ATTR_INIT(attr, winecord_channel, ret, params->reason);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_POST,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_POST,
                             "/guilds/%" PRIu64 "/channels", guild_id);
 }
 
@@ -138,19 +134,16 @@ winecord_modify_guild_channel_positions(
     struct winecord_ret *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct ccord_szbuf body;
-    char buf[4096];
 
     CCORD_EXPECT(client, guild_id != 0, CCORD_BAD_PARAMETER, "");
     CCORD_EXPECT(client, params != NULL, CCORD_BAD_PARAMETER, "");
 
-    body.size = winecord_modify_guild_channel_positions_to_json(
-        buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_modify_guild_channel_positions,
+                            params);
 
     WINECORD_ATTR_BLANK_INIT(attr, ret, NULL);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_PATCH,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_PATCH,
                             "/guilds/%" PRIu64 "/channels", guild_id);
 }
 
@@ -203,7 +196,8 @@ winecord_list_guild_members(struct WINECORD *client,
         }
     }
 
-    WINECORD_ATTR_LIST_INIT(attr, winecord_guild_members, ret, NULL);
+    WINECORD_ATTR_STREAM_INIT(attr, winecord_guild_members,
+                              winecord_guild_member, ret, NULL);
 
     return winecord_rest_run(&client->rest, &attr, NULL, HTTP_GET,
                             "/guilds/%" PRIu64 "/members%s", guild_id,
@@ -246,7 +240,8 @@ winecord_search_guild_members(struct WINECORD *client,
         }
     }
 
-    WINECORD_ATTR_LIST_INIT(attr, winecord_guild_members, ret, NULL);
+    WINECORD_ATTR_STREAM_INIT(attr, winecord_guild_members,
+                              winecord_guild_member, ret, NULL);
 
     return winecord_rest_run(&client->rest, &attr, NULL, HTTP_GET,
                             "/guilds/%" PRIu64 "/members/search%s", guild_id,
@@ -261,8 +256,6 @@ winecord_add_guild_member(struct WINECORD *client,
                          struct winecord_ret_guild_member *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct ccord_szbuf body;
-    char buf[1024];
 
     CCORD_EXPECT(client, guild_id != 0, CCORD_BAD_PARAMETER, "");
     CCORD_EXPECT(client, user_id != 0, CCORD_BAD_PARAMETER, "");
@@ -270,12 +263,11 @@ winecord_add_guild_member(struct WINECORD *client,
     CCORD_EXPECT(client, params->access_token != NULL, CCORD_BAD_PARAMETER,
                  "");
 
-    body.size = winecord_add_guild_member_to_json(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_add_guild_member, params);
 
     WINECORD_ATTR_INIT(attr, winecord_guild_member, ret, NULL);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_PUT,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_PUT,
                             "/guilds/%" PRIu64 "/members/%" PRIu64, guild_id,
                             user_id);
 }
@@ -288,19 +280,16 @@ winecord_modify_guild_member(struct WINECORD *client,
                             struct winecord_ret_guild_member *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct ccord_szbuf body;
-    char buf[2048];
 
     CCORD_EXPECT(client, guild_id != 0, CCORD_BAD_PARAMETER, "");
     CCORD_EXPECT(client, user_id != 0, CCORD_BAD_PARAMETER, "");
     CCORD_EXPECT(client, params != NULL, CCORD_BAD_PARAMETER, "");
 
-    body.size = winecord_modify_guild_member_to_json(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_modify_guild_member, params);
 
     WINECORD_ATTR_INIT(attr, winecord_guild_member, ret, params->reason);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_PATCH,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_PATCH,
                             "/guilds/%" PRIu64 "/members/%" PRIu64, guild_id,
                             user_id);
 }
@@ -312,20 +301,16 @@ winecord_modify_current_member(struct WINECORD *client,
                               struct winecord_ret_guild_member *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct ccord_szbuf body;
-    char buf[512];
 
     CCORD_EXPECT(client, guild_id != 0, CCORD_BAD_PARAMETER, "");
     CCORD_EXPECT(client, params != NULL, CCORD_BAD_PARAMETER, "");
     CCORD_EXPECT(client, params->nick != NULL, CCORD_BAD_PARAMETER, "");
 
-    body.size =
-        winecord_modify_current_member_to_json(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_modify_current_member, params);
 
     WINECORD_ATTR_INIT(attr, winecord_guild_member, ret, params->reason);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_PATCH,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_PATCH,
                             "/guilds/%" PRIu64 "/members/@me", guild_id);
 }
 
@@ -337,8 +322,6 @@ winecord_modify_current_user_nick(
     struct winecord_ret_guild_member *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct ccord_szbuf body;
-    char buf[512];
 
     CCORD_EXPECT(client, guild_id != 0, CCORD_BAD_PARAMETER, "");
     CCORD_EXPECT(client, params != NULL, CCORD_BAD_PARAMETER, "");
@@ -348,13 +331,11 @@ winecord_modify_current_user_nick(
                  "This endpoint is now deprecated by Discord. Please use "
                  "winecord_modify_current_member instead");
 
-    body.size =
-        winecord_modify_current_user_nick_to_json(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_modify_current_user_nick, params);
 
     WINECORD_ATTR_INIT(attr, winecord_guild_member, ret, params->reason);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_PATCH,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_PATCH,
                             "/guilds/%" PRIu64 "/members/@me/nick", guild_id);
 }
 
@@ -372,6 +353,11 @@ winecord_add_guild_member_role(struct WINECORD *client,
     CCORD_EXPECT(client, user_id != 0, CCORD_BAD_PARAMETER, "");
     CCORD_EXPECT(client, role_id != 0, CCORD_BAD_PARAMETER, "");
 
+    if (winecord_role_deltas_coalesce(client, guild_id, user_id, role_id,
+                                      true, params ? params->reason : NULL,
+                                      ret))
+        return WINEBERRY_PENDING;
+
     WINECORD_ATTR_BLANK_INIT(attr, ret, params ? params->reason : NULL);
 
     return winecord_rest_run(&client->rest, &attr, NULL, HTTP_PUT,
@@ -395,6 +381,11 @@ winecord_remove_guild_member_role(
     CCORD_EXPECT(client, user_id != 0, CCORD_BAD_PARAMETER, "");
     CCORD_EXPECT(client, role_id != 0, CCORD_BAD_PARAMETER, "");
 
+    if (winecord_role_deltas_coalesce(client, guild_id, user_id, role_id,
+                                      false, params ? params->reason : NULL,
+                                      ret))
+        return WINEBERRY_PENDING;
+
     WINECORD_ATTR_BLANK_INIT(attr, ret, params ? params->reason : NULL);
 
     return winecord_rest_run(&client->rest, &attr, NULL, HTTP_DELETE,
@@ -431,7 +422,7 @@ winecord_get_guild_bans(struct WINECORD *client,
 
     CCORD_EXPECT(client, guild_id != 0, CCORD_BAD_PARAMETER, "");
 
-    WINECORD_ATTR_LIST_INIT(attr, winecord_bans, ret, NULL);
+    WINECORD_ATTR_STREAM_INIT(attr, winecord_bans, winecord_ban, ret, NULL);
 
     return winecord_rest_run(&client->rest, &attr, NULL, HTTP_GET,
                             "/guilds/%" PRIu64 "/bans", guild_id);
@@ -463,8 +454,6 @@ winecord_create_guild_ban(struct WINECORD *client,
                          struct winecord_ret *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct ccord_szbuf body;
-    char buf[256];
 
     CCORD_EXPECT(client, guild_id != 0, CCORD_BAD_PARAMETER, "");
     CCORD_EXPECT(client, user_id != 0, CCORD_BAD_PARAMETER, "");
@@ -474,16 +463,64 @@ winecord_create_guild_ban(struct WINECORD *client,
                      && params->delete_message_days <= 7,
                  CCORD_BAD_PARAMETER, "");
 
-    body.size = winecord_create_guild_ban_to_json(buf, sizeof(buf), params);
-    body.start = buf;
+    if (winecord_bans_coalesce(client, guild_id, user_id, params, ret))
+        return WINEBERRY_PENDING;
+
+    WINECORD_ATTR_BODY_INIT(attr, winecord_create_guild_ban, params);
 
     WINECORD_ATTR_BLANK_INIT(attr, ret, params->reason);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_PUT,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_PUT,
                             "/guilds/%" PRIu64 "/bans/%" PRIu64, guild_id,
                             user_id);
 }
 
+WINEBERRY
+winecord_bulk_guild_ban(struct WINECORD *client,
+                       u64snowflake guild_id,
+                       struct winecord_bulk_guild_ban *params,
+                       struct winecord_ret_bulk_ban *ret)
+{
+    struct snowflakes user_ids = { 0 };
+    struct winecord_bulk_guild_ban batch;
+    WINEBERRY code = WINEBERRY_OK;
+
+    CCORD_EXPECT(client, guild_id != 0, CCORD_BAD_PARAMETER, "");
+    CCORD_EXPECT(client, params != NULL, CCORD_BAD_PARAMETER, "");
+    CCORD_EXPECT(client, params->user_ids != NULL && params->user_ids->size > 0,
+                 CCORD_BAD_PARAMETER, "");
+    CCORD_EXPECT(client,
+                 params->delete_message_seconds >= 0
+                     && params->delete_message_seconds <= 604800,
+                 CCORD_BAD_PARAMETER, "");
+    CCORD_EXPECT(client,
+                 !ret || !ret->sync || WINECORD_SYNC_FLAG == ret->sync
+                     || params->user_ids->size <= WINECORD_BULK_BAN_MAX,
+                 CCORD_BAD_PARAMETER,
+                 "An outcome can't be written for more than 200 users");
+
+    batch = *params;
+    batch.user_ids = &user_ids;
+    for (int i = 0; i < params->user_ids->size; i += WINECORD_BULK_BAN_MAX) {
+        struct winecord_attributes attr = { 0 };
+
+        user_ids.array = params->user_ids->array + i;
+        user_ids.size = params->user_ids->size - i;
+        if (user_ids.size > WINECORD_BULK_BAN_MAX)
+            user_ids.size = WINECORD_BULK_BAN_MAX;
+
+        WINECORD_ATTR_BODY_INIT(attr, winecord_bulk_guild_ban, &batch);
+
+        WINECORD_ATTR_INIT(attr, winecord_bulk_ban, ret, params->reason);
+
+        /* the body is serialized at once, so the batch may be reused */
+        code = winecord_rest_run(&client->rest, &attr, NULL, HTTP_POST,
+                                "/guilds/%" PRIu64 "/bulk-ban", guild_id);
+        if (code != WINEBERRY_OK && code != WINEBERRY_PENDING) break;
+    }
+    return code;
+}
+
 WINEBERRY
 winecord_remove_guild_ban(struct WINECORD *client,
                          u64snowflake guild_id,
@@ -525,17 +562,14 @@ winecord_create_guild_role(struct WINECORD *client,
                           struct winecord_ret_role *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct ccord_szbuf body;
-    char buf[1024];
 
     CCORD_EXPECT(client, guild_id != 0, CCORD_BAD_PARAMETER, "");
 
-    body.size = winecord_create_guild_role_to_json(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_create_guild_role, params);
 
     WINECORD_ATTR_INIT(attr, winecord_role, ret, params ? params->reason : NULL);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_POST,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_POST,
                             "/guilds/%" PRIu64 "/roles", guild_id);
 }
 
@@ -547,19 +581,15 @@ winecord_modify_guild_role_positions(
     struct winecord_ret_roles *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct ccord_szbuf body;
-    char buf[4096];
 
     CCORD_EXPECT(client, guild_id != 0, CCORD_BAD_PARAMETER, "");
     CCORD_EXPECT(client, params != NULL, CCORD_BAD_PARAMETER, "");
 
-    body.size =
-        winecord_modify_guild_role_positions_to_json(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_modify_guild_role_positions, params);
 
     WINECORD_ATTR_LIST_INIT(attr, winecord_roles, ret, NULL);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_PATCH,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_PATCH,
                             "/guilds/%" PRIu64 "/roles", guild_id);
 }
 
@@ -571,18 +601,15 @@ winecord_modify_guild_role(struct WINECORD *client,
                           struct winecord_ret_role *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct ccord_szbuf body;
-    char buf[2048];
 
     CCORD_EXPECT(client, guild_id != 0, CCORD_BAD_PARAMETER, "");
     CCORD_EXPECT(client, role_id != 0, CCORD_BAD_PARAMETER, "");
 
-    body.size = winecord_modify_guild_role_to_json(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_modify_guild_role, params);
 
     WINECORD_ATTR_INIT(attr, winecord_role, ret, params ? params->reason : NULL);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_PATCH,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_PATCH,
                             "/guilds/%" PRIu64 "/roles/%" PRIu64, guild_id,
                             role_id);
 }
@@ -663,17 +690,14 @@ winecord_begin_guild_prune(struct WINECORD *client,
                           struct winecord_ret *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct ccord_szbuf body;
-    char buf[4096];
 
     CCORD_EXPECT(client, guild_id != 0, CCORD_BAD_PARAMETER, "");
 
-    body.size = winecord_begin_guild_prune_to_json(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_begin_guild_prune, params);
 
     WINECORD_ATTR_BLANK_INIT(attr, ret, params ? params->reason : NULL);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_POST,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_POST,
                             "/guilds/%" PRIu64 "/prune", guild_id);
 }
 
@@ -765,20 +789,16 @@ winecord_modify_guild_widget(struct WINECORD *client,
                             struct winecord_ret_guild_widget_settings *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct ccord_szbuf body;
-    char buf[512];
 
     CCORD_EXPECT(client, guild_id != 0, CCORD_BAD_PARAMETER, "");
     CCORD_EXPECT(client, params != NULL, CCORD_BAD_PARAMETER, "");
 
-    body.size =
-        winecord_guild_widget_settings_to_json(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_guild_widget_settings, params);
 
     WINECORD_ATTR_INIT(attr, winecord_guild_widget_settings, ret,
                       params->reason);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_PATCH,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_PATCH,
                             "/guilds/%" PRIu64 "/widget", guild_id);
 }
 
@@ -835,19 +855,15 @@ winecord_modify_guild_welcome_screen(
     struct winecord_ret_welcome_screen *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct ccord_szbuf body;
-    char buf[4096];
 
     CCORD_EXPECT(client, guild_id != 0, CCORD_BAD_PARAMETER, "");
 
-    body.size =
-        winecord_modify_guild_welcome_screen_to_json(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_modify_guild_welcome_screen, params);
 
     WINECORD_ATTR_INIT(attr, winecord_welcome_screen, ret,
                       params ? params->reason : NULL);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_PATCH,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_PATCH,
                             "/guilds/%" PRIu64 "/welcome-screen", guild_id);
 }
 
@@ -859,18 +875,15 @@ winecord_modify_current_user_voice_state(
     struct winecord_ret *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct ccord_szbuf body;
-    char buf[512];
 
     CCORD_EXPECT(client, guild_id != 0, CCORD_BAD_PARAMETER, "");
 
-    body.size = winecord_modify_current_user_voice_state_to_json(
-        buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_modify_current_user_voice_state,
+                            params);
 
     WINECORD_ATTR_BLANK_INIT(attr, ret, NULL);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_PATCH,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_PATCH,
                             "/guilds/%" PRIu64 "/voice-states/@me", guild_id);
 }
 
@@ -882,18 +895,14 @@ winecord_modify_user_voice_state(struct WINECORD *client,
                                 struct winecord_ret *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct ccord_szbuf body;
-    char buf[512];
 
     CCORD_EXPECT(client, guild_id != 0, CCORD_BAD_PARAMETER, "");
 
-    body.size =
-        winecord_modify_user_voice_state_to_json(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_modify_user_voice_state, params);
 
     WINECORD_ATTR_BLANK_INIT(attr, ret, NULL);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_PATCH,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_PATCH,
                             "/guilds/%" PRIu64 "/voice-states/%" PRIu64,
                             guild_id, user_id);
 }
@@ -35,8 +35,6 @@ winecord_create_guild_scheduled_event(
     struct winecord_ret_guild_scheduled_event *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct wineberry_szbuf body;
-    char buf[4096];
 
     WINEBERRY_EXPECT(client, guild_id != 0, WINEBERRY_BAD_PARAMETER, "");
     WINEBERRY_EXPECT(client, params != NULL, WINEBERRY_BAD_PARAMETER, "");
@@ -49,11 +47,10 @@ winecord_create_guild_scheduled_event(
     WINECORD_ATTR_INIT(attr, winecord_guild_scheduled_event, ret,
                       params->reason);
 
-    body.size =
-        winecord_create_guild_scheduled_event_to_json(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_create_guild_scheduled_event,
+                            params);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_POST,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_POST,
                             "/guilds/%" PRIu64 "/scheduled-events", guild_id);
 }
 
@@ -90,8 +87,6 @@ winecord_modify_guild_scheduled_event(
     struct winecord_ret_guild_scheduled_event *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct wineberry_szbuf body;
-    char buf[4096];
 
     WINEBERRY_EXPECT(client, guild_id != 0, WINEBERRY_BAD_PARAMETER, "");
     WINEBERRY_EXPECT(client, guild_scheduled_event_id != 0, WINEBERRY_BAD_PARAMETER,
@@ -100,11 +95,10 @@ winecord_modify_guild_scheduled_event(
     WINECORD_ATTR_INIT(attr, winecord_guild_scheduled_event, ret,
                       params ? params->reason : NULL);
 
-    body.size =
-        winecord_modify_guild_scheduled_event_to_json(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_modify_guild_scheduled_event,
+                            params);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_PATCH,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_PATCH,
                             "/guilds/%" PRIu64 "/scheduled-events/%" PRIu64,
                             guild_id, guild_scheduled_event_id);
 }
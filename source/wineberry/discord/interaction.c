@@ -16,9 +16,7 @@ winecord_create_interaction_response(
     struct winecord_ret_interaction_response *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct wineberry_szbuf body;
     enum http_method method;
-    char buf[16384];
 
     WINEBERRY_EXPECT(client, interaction_id != 0, WINEBERRY_BAD_PARAMETER, "");
     WINEBERRY_EXPECT(client, NOT_EMPTY_STR(interaction_token), WINEBERRY_BAD_PARAMETER,
@@ -34,12 +32,11 @@ winecord_create_interaction_response(
         method = HTTP_POST;
     }
 
-    body.size = winecord_interaction_response_to_json(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_interaction_response, params);
 
     WINECORD_ATTR_INIT(attr, winecord_interaction_response, ret, NULL);
 
-    return winecord_rest_run(&client->rest, &attr, &body, method,
+    return winecord_rest_run(&client->rest, &attr, NULL, method,
                             "/interactions/%" PRIu64 "/%s/callback",
                             interaction_id, interaction_token);
 }
@@ -73,9 +70,7 @@ winecord_edit_original_interaction_response(
     struct winecord_ret_interaction_response *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct wineberry_szbuf body;
     enum http_method method;
-    char buf[16384]; /**< @todo dynamic buffer */
 
     WINEBERRY_EXPECT(client, application_id != 0, WINEBERRY_BAD_PARAMETER, "");
     WINEBERRY_EXPECT(client, NOT_EMPTY_STR(interaction_token), WINEBERRY_BAD_PARAMETER,
@@ -91,13 +86,12 @@ winecord_edit_original_interaction_response(
         method = HTTP_PATCH;
     }
 
-    body.size = winecord_edit_original_interaction_response_to_json(
-        buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_edit_original_interaction_response,
+                            params);
 
     WINECORD_ATTR_INIT(attr, winecord_interaction_response, ret, NULL);
 
-    return winecord_rest_run(&client->rest, &attr, &body, method,
+    return winecord_rest_run(&client->rest, &attr, NULL, method,
                             "/webhooks/%" PRIu64 "/%s/messages/@original",
                             application_id, interaction_token);
 }
@@ -129,9 +123,7 @@ winecord_create_followup_message(struct winecord *client,
                                 struct winecord_ret_webhook *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct wineberry_szbuf body;
     enum http_method method;
-    char buf[16384]; /**< @todo dynamic buffer */
     char query[4096] = "";
     char qbuf[32];
 
@@ -158,13 +150,11 @@ winecord_create_followup_message(struct winecord *client,
         method = HTTP_POST;
     }
 
-    body.size =
-        winecord_create_followup_message_to_json(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_create_followup_message, params);
 
     WINECORD_ATTR_INIT(attr, winecord_webhook, ret, NULL);
 
-    return winecord_rest_run(&client->rest, &attr, &body, method,
+    return winecord_rest_run(&client->rest, &attr, NULL, method,
                             "/webhooks/%" PRIu64 "/%s%s", application_id,
                             interaction_token, query);
 }
@@ -199,9 +189,7 @@ winecord_edit_followup_message(struct winecord *client,
                               struct winecord_ret_message *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct wineberry_szbuf body;
     enum http_method method;
-    char buf[16384]; /**< @todo dynamic buffer */
 
     WINEBERRY_EXPECT(client, application_id != 0, WINEBERRY_BAD_PARAMETER, "");
     WINEBERRY_EXPECT(client, NOT_EMPTY_STR(interaction_token), WINEBERRY_BAD_PARAMETER,
@@ -218,13 +206,11 @@ winecord_edit_followup_message(struct winecord *client,
         method = HTTP_PATCH;
     }
 
-    body.size =
-        winecord_edit_followup_message_to_json(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_edit_followup_message, params);
 
     WINECORD_ATTR_INIT(attr, winecord_message, ret, NULL);
 
-    return winecord_rest_run(&client->rest, &attr, &body, method,
+    return winecord_rest_run(&client->rest, &attr, NULL, method,
                             "/webhooks/%" PRIu64 "/%s/messages/%" PRIu64,
                             application_id, interaction_token, message_id);
 }
@@ -13,18 +13,15 @@ winecord_get_invite(struct winecord *client,
                    struct winecord_ret_invite *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct wineberry_szbuf body;
-    char buf[1024];
 
     WINEBERRY_EXPECT(client, NOT_EMPTY_STR(invite_code), WINEBERRY_BAD_PARAMETER, "");
     WINEBERRY_EXPECT(client, params != NULL, WINEBERRY_BAD_PARAMETER, "");
 
-    body.size = winecord_get_invite_to_json(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_get_invite, params);
 
     WINECORD_ATTR_INIT(attr, winecord_invite, ret, NULL);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_GET,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_GET,
                             "/invites/%s", invite_code);
 }
 
@@ -16,20 +16,17 @@ winecord_create_stage_instance(struct winecord *client,
                               struct winecord_ret_stage_instance *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct wineberry_szbuf body;
-    char buf[1024];
 
     WINEBERRY_EXPECT(client, params != NULL, WINEBERRY_BAD_PARAMETER, "");
     WINEBERRY_EXPECT(client, params->channel_id != 0, WINEBERRY_BAD_PARAMETER, "");
     WINEBERRY_EXPECT(client, IS_NOT_EMPTY_STRING(params->topic),
                  WINEBERRY_BAD_PARAMETER, "");
 
-    body.size = winecord_create_stage_instance(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_create_stage_instance, params);
 
     WINECORD_ATTR_INIT(attr, winecord_stage_instance, ret, params->reason);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_POST,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_POST,
                             "/stage-instances");
 }
 
@@ -55,17 +52,14 @@ winecord_modify_stage_instance(struct winecord *client,
                               struct winecord_ret_stage_instance *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct wineberry_szbuf body;
-    char buf[1024];
 
     WINEBERRY_EXPECT(client, channel_id != 0, WINEBERRY_BAD_PARAMETER, "");
 
-    body.size = winecord_modify_stage_instance(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_modify_stage_instance, params);
 
     WINECORD_ATTR_INIT(attr, winecord_stage_instance, ret, params->reason);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_PATCH,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_PATCH,
                             "/stage-instances/%" PRIu64, channel_id);
 }
 
@@ -78,19 +78,16 @@ winecord_modify_guild_sticker(struct winecord *client,
                              struct winecord_ret_sticker *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct ccord_szbuf body;
-    char buf[1024];
 
     WINEBERRY_EXPECT(client, guild_id != 0, WINEBERRY_BAD_PARAMETER, "");
     WINEBERRY_EXPECT(client, sticker_id != 0, WINEBERRY_BAD_PARAMETER, "");
 
-    body.size = winecord_modify_guild_sticker_to_json(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_modify_guild_sticker, params);
 
     WINECORD_ATTR_INIT(attr, winecord_sticker, ret,
                       params ? params->reason : NULL);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_PATCH,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_PATCH,
                             "/guilds/%" PRIu64 "/stickers/%" PRIu64, guild_id,
                             sticker_id);
 }
@@ -38,17 +38,14 @@ winecord_modify_current_user(struct winecord *client,
                             struct winecord_ret_user *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct wineberry_szbuf body;
-    char buf[1024];
 
     WINEBERRY_EXPECT(client, params != NULL, WINEBERRY_BAD_PARAMETER, "");
 
-    body.size = winecord_modify_current_user_to_json(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_modify_current_user, params);
 
     WINECORD_ATTR_INIT(attr, winecord_user, ret, NULL);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_PATCH,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_PATCH,
                             "/users/@me");
 }
 
@@ -86,17 +83,14 @@ winecord_create_dm(struct winecord *client,
                   struct winecord_ret_channel *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct wineberry_szbuf body;
-    char buf[128];
 
     WINEBERRY_EXPECT(client, params != NULL, WINEBERRY_BAD_PARAMETER, "");
 
-    body.size = winecord_create_dm_to_json(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_create_dm, params);
 
     WINECORD_ATTR_INIT(attr, winecord_channel, ret, NULL);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_POST,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_POST,
                             "/users/@me/channels");
 }
 
@@ -106,20 +100,17 @@ winecord_create_group_dm(struct winecord *client,
                         struct winecord_ret_channel *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct wineberry_szbuf body;
-    char buf[1024];
 
     WINEBERRY_EXPECT(client, params != NULL, WINEBERRY_BAD_PARAMETER, "");
     WINEBERRY_EXPECT(client, params->access_tokens != NULL, WINEBERRY_BAD_PARAMETER,
                  "");
     WINEBERRY_EXPECT(client, params->nicks != NULL, WINEBERRY_BAD_PARAMETER, "");
 
-    body.size = winecord_create_group_dm_to_json(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_create_group_dm, params);
 
     WINECORD_ATTR_INIT(attr, winecord_channel, ret, NULL);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_POST,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_POST,
                             "/users/@me/channels");
 }
 
@@ -14,19 +14,16 @@ winecord_create_webhook(struct WINECORD *client,
                        struct winecord_ret_webhook *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct ccord_szbuf body;
-    char buf[1024];
 
     WINEBERRY_EXPECT(client, channel_id != 0, WINEBERRY_BAD_PARAMETER, "");
     WINEBERRY_EXPECT(client, params != NULL, WINEBERRY_BAD_PARAMETER, "");
     WINEBERRY_EXPECT(client, NOT_EMPTY_STR(params->name), WINEBERRY_BAD_PARAMETER, "");
 
-    body.size = winecord_create_webhook_to_json(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_create_webhook, params);
 
     WINECORD_ATTR_INIT(attr, winecord_webhook, ret, params->reason);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_POST,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_POST,
                             "/channels/%" PRIu64 "/webhooks", channel_id);
 }
 
@@ -101,18 +98,15 @@ winecord_modify_webhook(struct WINECORD *client,
                        struct winecord_ret_webhook *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct ccord_szbuf body;
-    char buf[1024];
 
     WINEBERRY_EXPECT(client, webhook_id != 0, WINEBERRY_BAD_PARAMETER, "");
 
-    body.size = winecord_modify_webhook_to_json(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_modify_webhook, params);
 
     WINECORD_ATTR_INIT(attr, winecord_webhook, ret,
                       params ? params->reason : NULL);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_PATCH,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_PATCH,
                             "/webhooks/%" PRIu64, webhook_id);
 }
 
@@ -125,20 +119,16 @@ winecord_modify_webhook_with_token(
     struct winecord_ret_webhook *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct ccord_szbuf body;
-    char buf[1024];
 
     WINEBERRY_EXPECT(client, webhook_id != 0, WINEBERRY_BAD_PARAMETER, "");
     WINEBERRY_EXPECT(client, NOT_EMPTY_STR(webhook_token), WINEBERRY_BAD_PARAMETER,
                  "");
 
-    body.size =
-        winecord_modify_webhook_with_token_to_json(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_modify_webhook_with_token, params);
 
     WINECORD_ATTR_INIT(attr, winecord_webhook, ret, NULL);
 
-    return winecord_rest_run(&client->rest, &attr, &body, HTTP_PATCH,
+    return winecord_rest_run(&client->rest, &attr, NULL, HTTP_PATCH,
                             "/webhooks/%" PRIu64 "/%s", webhook_id,
                             webhook_token);
 }
@@ -186,9 +176,7 @@ winecord_execute_webhook(struct WINECORD *client,
                         struct winecord_ret *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct ccord_szbuf body;
     enum http_method method;
-    char buf[16384]; /**< @todo dynamic buffer */
     char query[4096] = "";
     char qbuf[32];
     int res;
@@ -220,12 +208,11 @@ winecord_execute_webhook(struct WINECORD *client,
         method = HTTP_POST;
     }
 
-    body.size = winecord_execute_webhook_to_json(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_execute_webhook, params);
 
     WINECORD_ATTR_BLANK_INIT(attr, ret, NULL);
 
-    return winecord_rest_run(&client->rest, &attr, &body, method,
+    return winecord_rest_run(&client->rest, &attr, NULL, method,
                             "/webhooks/%" PRIu64 "/%s%s", webhook_id,
                             webhook_token, query);
 }
@@ -260,9 +247,7 @@ winecord_edit_webhook_message(struct WINECORD *client,
                              struct winecord_ret_message *ret)
 {
     struct winecord_attributes attr = { 0 };
-    struct ccord_szbuf body;
     enum http_method method;
-    char buf[16384]; /**< @todo dynamic buffer */
 
     WINEBERRY_EXPECT(client, webhook_id != 0, WINEBERRY_BAD_PARAMETER, "");
     WINEBERRY_EXPECT(client, NOT_EMPTY_STR(webhook_token), WINEBERRY_BAD_PARAMETER,
@@ -279,12 +264,11 @@ winecord_edit_webhook_message(struct WINECORD *client,
         method = HTTP_PATCH;
     }
 
-    body.size = winecord_edit_webhook_message_to_json(buf, sizeof(buf), params);
-    body.start = buf;
+    WINECORD_ATTR_BODY_INIT(attr, winecord_edit_webhook_message, params);
 
     WINECORD_ATTR_INIT(attr, winecord_message, ret, NULL);
 
-    return winecord_rest_run(&client->rest, &attr, &body, method,
+    return winecord_rest_run(&client->rest, &attr, NULL, method,
                             "/webhooks/%" PRIu64 "/%s/messages/%" PRIu64,
                             webhook_id, webhook_token, message_id);
 }
@@ -320,6 +320,14 @@ winecord_strerror(WINEBERRYcode code, struct winecord *client)
     case WINEBERRY_WINECORD_CONNECTION:
         return "Winecord Connection: Couldn't establish a connection to "
                "winecord";
+    case WINEBERRY_WINECORD_CANCELED:
+        return "Winecord Canceled: Request was canceled before completion";
+    case WINEBERRY_WINECORD_DEADLINE:
+        return "Winecord Deadline: Request couldn't be sent before its "
+               "deadline";
+    case WINEBERRY_WINECORD_CIRCUIT_OPEN:
+        return "Winecord Circuit Open: Request's route is failing, try again "
+               "later";
     }
 }
 
@@ -772,10 +772,11 @@ winecord_gateway_start(struct winecord_gateway *gw)
         ws_set_url(gw->ws, gw->session->base_url, NULL);
     }
 
-#ifndef CCORD_DEBUG_WEBSOCKETS
-    ws_start(gw->ws);
-#else
     CURL *ehandle = ws_start(gw->ws);
+    /* set before the transfer is performed by the next loop iteration */
+    if (winecord_global_share())
+        curl_easy_setopt(ehandle, CURLOPT_SHARE, winecord_global_share());
+#ifdef CCORD_DEBUG_WEBSOCKETS
     curl_easy_setopt(ehandle, CURLOPT_DEBUGFUNCTION, _ws_curl_debug_trace);
     curl_easy_setopt(ehandle, CURLOPT_VERBOSE, 1L);
 #endif /* CCORD_DEBUG_WEBSOCKETS */
@@ -101,12 +101,27 @@ winecord_gateway_dispatch(struct winecord_gateway *gw)
 {
     const enum winecord_gateway_events event = gw->payload.event;
     struct winecord *client = CLIENT(gw, gw);
+    /* cache may be enabled concurrently from another thread */
+    struct winecord_rest_cache *cache = __atomic_load_n(
+        &client->rest.shards->requestor.cache, __ATOMIC_ACQUIRE);
+    jsmnf_pair *f = jsmnf_find(gw->payload.data, gw->payload.json.start,
+                               "guild_id", 8);
+    u64snowflake tenant = 0;
+
+    if (cache)
+        winecord_rest_cache_on_event(cache, event, gw->payload.data,
+                                    gw->payload.json.start);
+
+    /* requests made from the event's callbacks are fairly queued by its
+     *      guild */
+    if (f) tenant = strtoull(gw->payload.json.start + f->v.pos, NULL, 10);
+    tenant = winecord_tenant_context_swap(tenant);
 
     switch (event) {
     case WINEBERRY_EV_MESSAGE_CREATE:
         if (winecord_message_commands_try_perform(&client->commands,
                                                  &gw->payload)) {
-            return;
+            break;
         }
     /* fall-through */
     default:
@@ -134,6 +149,7 @@ winecord_gateway_dispatch(struct winecord_gateway *gw)
             "Expected unimplemented GATEWAY_DISPATCH event (code: %d)", event);
         break;
     }
+    winecord_tenant_context_swap(tenant);
 }
 
 void
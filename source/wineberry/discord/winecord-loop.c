@@ -120,7 +120,8 @@ winecord_run(struct winecord *client)
 
             BREAK_ON_FAIL(code, io_poller_perform(client->io_poller));
 
-            winecord_requestor_dispatch_responses(&client->rest.requestor);
+            winecord_requestor_dispatch_responses(
+                &client->rest.shards->requestor);
         }
 
         logconf_info(&client->conf,
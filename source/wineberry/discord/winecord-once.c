@@ -18,6 +18,34 @@ static int shutdown_fds[2] = {
 
 static int init_counter = 0;
 
+/** process-wide share of DNS and TLS sessions, `NULL` unless enabled with
+ *      wineberry_global_share_enable() */
+static CURLSH *share = NULL;
+/** locks of each of the share's data */
+static pthread_mutex_t share_locks[CURL_LOCK_DATA_LAST];
+
+static void
+_wineberry_share_lock(CURL *ehandle,
+                      curl_lock_data data,
+                      curl_lock_access access,
+                      void *p_locks)
+{
+    pthread_mutex_t *locks = p_locks;
+    (void)ehandle;
+    (void)access;
+
+    pthread_mutex_lock(&locks[data]);
+}
+
+static void
+_wineberry_share_unlock(CURL *ehandle, curl_lock_data data, void *p_locks)
+{
+    pthread_mutex_t *locks = p_locks;
+    (void)ehandle;
+
+    pthread_mutex_unlock(&locks[data]);
+}
+
 void
 wineberry_shutdown_async(void)
 {
@@ -107,11 +135,58 @@ fail_curl_init:
     return WINEBERRY_GLOBAL_INIT;
 }
 
+WINEBERRY
+wineberry_global_share_enable()
+{
+    CURLSH *new_share;
+
+    pthread_mutex_lock(&lock);
+    if (!init_counter) {
+        pthread_mutex_unlock(&lock);
+        return WINEBERRY_GLOBAL_INIT;
+    }
+    if (share) {
+        pthread_mutex_unlock(&lock);
+        return WINEBERRY_OK;
+    }
+    if (!(new_share = curl_share_init())) {
+        fputs("Couldn't start libcurl's share\n", stderr);
+        pthread_mutex_unlock(&lock);
+        return WINEBERRY_GLOBAL_INIT;
+    }
+    for (int i = 0; i < CURL_LOCK_DATA_LAST; i++)
+        pthread_mutex_init(&share_locks[i], NULL);
+
+    curl_share_setopt(new_share, CURLSHOPT_LOCKFUNC, &_wineberry_share_lock);
+    curl_share_setopt(new_share, CURLSHOPT_UNLOCKFUNC,
+                      &_wineberry_share_unlock);
+    curl_share_setopt(new_share, CURLSHOPT_USERDATA, share_locks);
+    curl_share_setopt(new_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(new_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+
+    __atomic_store_n(&share, new_share, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&lock);
+
+    return WINEBERRY_OK;
+}
+
+CURLSH *
+winecord_global_share(void)
+{
+    return __atomic_load_n(&share, __ATOMIC_ACQUIRE);
+}
+
 void
 wineberry_global_cleanup()
 {
     pthread_mutex_lock(&lock);
     if (init_counter && 0 == --init_counter) {
+        if (share) {
+            curl_share_cleanup(share);
+            share = NULL;
+            for (int i = 0; i < CURL_LOCK_DATA_LAST; i++)
+                pthread_mutex_destroy(&share_locks[i]);
+        }
         curl_global_cleanup();
         winecord_worker_global_cleanup();
         for (int i = 0; i < 2; i++) {
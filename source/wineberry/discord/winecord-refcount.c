@@ -272,3 +272,29 @@ winecord_refcounter_decr(struct winecord_refcounter *rc, void *data)
     pthread_mutex_unlock(rc->g_lock);
     return code;
 }
+
+void
+winecord_refcounter_hold_ret(struct winecord_refcounter *rc,
+                            const struct winecord_ret *ret)
+{
+    if (ret->keep) {
+        WINEBERRYcode code = winecord_refcounter_incr(rc, (void *)ret->keep);
+
+        ASSERT_S(code == WINEBERRY_OK,
+                 "'.keep' data must be a Winecord resource");
+    }
+    if (ret->data
+        && WINEBERRY_RESOURCE_UNAVAILABLE
+               == winecord_refcounter_incr(rc, ret->data))
+    {
+        winecord_refcounter_add_client(rc, ret->data, ret->cleanup, false);
+    }
+}
+
+void
+winecord_refcounter_release_ret(struct winecord_refcounter *rc,
+                               const struct winecord_ret *ret)
+{
+    if (ret->keep) winecord_refcounter_decr(rc, (void *)ret->keep);
+    if (ret->data) winecord_refcounter_decr(rc, ret->data);
+}
@@ -2,59 +2,125 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
-
-#include "carray.h"
-#include "threadpool.h"
+#include <errno.h>
 
 #include "winecord.h"
 #include "winecord-internal.h"
+#include "winecord-rest.h"
+#include "winecord-worker.h"
 
 static WINEBERRY
-_winecord_rest_perform(struct winecord_rest *rest)
+_winecord_rest_perform(struct winecord_rest_shard *shard)
 {
     WINEBERRY code;
 
-    winecord_requestor_info_read(&rest->requestor);
-    code = winecord_requestor_start_pending(&rest->requestor);
-    io_poller_wakeup(CLIENT(rest, rest)->io_poller);
+    winecord_requestor_info_read(&shard->requestor);
+    code = winecord_requestor_start_pending(&shard->requestor);
+    io_poller_wakeup(CLIENT(shard->rest, rest)->io_poller);
 
     return code;
 }
 
-static void
-_winecord_rest_manager(void *p_rest)
+static void *
+_winecord_rest_manager(void *p_shard)
 {
-    struct winecord *client = CLIENT(p_rest, rest);
-    struct winecord_rest *rest = p_rest;
+    struct winecord_rest_shard *shard = p_shard;
+    struct winecord *client = CLIENT(shard->rest, rest);
 
-    struct winecord_timers *const timers[] = { &rest->timers };
+    struct winecord_timers *const timers[] = { &shard->timers };
     int64_t now, trigger;
-    int poll_result;
 
-    _winecord_rest_perform(rest);
+    winecord_requestor_cache_attach();
+    while (__atomic_load_n(&shard->is_running, __ATOMIC_ACQUIRE)) {
+        _winecord_rest_perform(shard);
 
-    now = (int64_t)winecord_timestamp_us(client);
+        now = (int64_t)winecord_timestamp_us(client);
 
-    trigger = winecord_timers_get_next_trigger(timers, 1, now, 60000000);
-    poll_result = io_poller_poll(rest->io_poller, (int)(trigger / 1000));
+        trigger = winecord_timers_get_next_trigger(timers, 1, now, 60000000);
+        trigger = winecord_requestor_get_next_trigger(&shard->requestor, now,
+                                                     trigger);
+        /* round up, so that sub-millisecond triggers aren't busy-waited for */
+        io_poller_poll(shard->io_poller, (int)((trigger + 999) / 1000));
 
-    now = (int64_t)winecord_timestamp_us(client);
-    if (0 == poll_result) {
-        trigger = winecord_timers_get_next_trigger(timers, 1, now, 1000);
-        if (trigger > 0 && trigger < 1000) cog_sleep_us((long)trigger);
+        winecord_timers_run(client, &shard->timers);
+        /* act on the sockets that are ready */
+        io_poller_perform(shard->io_poller);
     }
-    winecord_timers_run(client, &rest->timers);
-    io_poller_perform(rest->io_poller);
 
-    threadpool_add(rest->tpool, _winecord_rest_manager, rest, 0);
+    return NULL;
 }
 
+/* get `REST` thread amount */
 static int
-_winecord_on_rest_perform(struct io_poller *io, CURLM *mhandle, void *p_rest)
+_winecord_rest_get_nthreads(void)
 {
-    (void)io;
-    (void)mhandle;
-    return _winecord_rest_perform(p_rest);
+    const char *val;
+    char *p_end;
+    int nthreads = 0;
+
+    errno = 0;
+    if ((val = getenv("WINEBERRY_REST_THREADS")))
+        nthreads = (int)strtol(val, &p_end, 10);
+    if (nthreads < 1 || ERANGE == errno || p_end == val) nthreads = 1;
+
+    return nthreads;
+}
+
+/* get amount of connections kept warm by each `REST` thread */
+static int
+_winecord_rest_get_nwarm(void)
+{
+    const char *val;
+    char *p_end;
+    int nwarm = 0;
+
+    errno = 0;
+    if ((val = getenv("WINEBERRY_REST_WARM_CONNECTIONS")))
+        nwarm = (int)strtol(val, &p_end, 10);
+    if (nwarm < 0 || ERANGE == errno || (val && p_end == val)) nwarm = 0;
+
+    return nwarm;
+}
+
+static void
+_winecord_rest_warm_cb(struct winecord *client, struct winecord_timer *timer)
+{
+    struct winecord_rest_shard *shard = timer->data;
+    (void)client;
+
+    winecord_requestor_warm(
+        &shard->requestor,
+        __atomic_load_n(&shard->rest->warm_connections, __ATOMIC_RELAXED),
+        true);
+}
+
+/* connections that have been idle for too long are closed by curl or by
+ *      the server, so they are warmed up again in between idle gaps */
+static void
+_winecord_rest_keep_warm_cb(struct winecord *client,
+                            struct winecord_timer *timer)
+{
+    struct winecord_rest_shard *shard = timer->data;
+    (void)client;
+
+    winecord_requestor_warm(
+        &shard->requestor,
+        __atomic_load_n(&shard->rest->warm_connections, __ATOMIC_RELAXED),
+        false);
+}
+
+/* warm up connections of every `REST` thread at once */
+static void
+_winecord_rest_warm(struct winecord_rest *rest)
+{
+    for (int i = 0; i < rest->n_shards; ++i)
+        _winecord_timer_ctl(CLIENT(rest, rest), &rest->shards[i].timers,
+                           &(struct winecord_timer){
+                               .on_tick = &_winecord_rest_warm_cb,
+                               .data = rest->shards + i,
+                               .delay = 0,
+                               .flags = WINECORD_TIMER_DELETE_AUTO,
+                           });
 }
 
 void
@@ -67,35 +133,178 @@ winecord_rest_init(struct winecord_rest *rest,
     else
         logconf_branch(&rest->conf, conf, "WINECORD_HTTP");
 
-    rest->io_poller = io_poller_create();
-    winecord_timers_init(&rest->timers, rest->io_poller);
+    rest->executor = WINECORD_EXECUTOR_MAIN;
+    rest->metrics_fd = -1;
+    rest->metrics_path = NULL;
+    QUEUE_INIT(&rest->metrics_scrapes);
+    rest->warm_connections = _winecord_rest_get_nwarm();
+    winecord_tenants_init(&rest->tenants);
+    winecord_webhooks_init(&rest->webhooks, &rest->conf);
+    winecord_bans_init(&rest->bans, &rest->conf);
+    winecord_role_deltas_init(&rest->role_deltas, &rest->conf);
+    rest->n_shards = _winecord_rest_get_nthreads();
+    rest->shards = calloc((size_t)rest->n_shards, sizeof *rest->shards);
+
+    /* the first shard owns the state that is shared by every other, so it
+     *      must be initialized first */
+    for (int i = 0; i < rest->n_shards; ++i) {
+        struct winecord_rest_shard *shard = rest->shards + i;
 
-    winecord_requestor_init(&rest->requestor, &rest->conf, token);
-    io_poller_curlm_add(rest->io_poller, rest->requestor.mhandle,
-                        &_winecord_on_rest_perform, rest);
+        shard->rest = rest;
+        shard->io_poller = io_poller_create();
+        winecord_timers_init(&shard->timers, shard->io_poller);
+        winecord_requestor_init(&shard->requestor, &rest->conf, token);
+        _winecord_timer_ctl(CLIENT(rest, rest), &shard->timers,
+                           &(struct winecord_timer){
+                               .on_tick = &_winecord_rest_keep_warm_cb,
+                               .data = shard,
+                               .delay = WINECORD_WARM_INTERVAL_MS,
+                               .interval = WINECORD_WARM_INTERVAL_MS,
+                               .repeat = -1,
+                               .flags = WINECORD_TIMER_DELETE_AUTO,
+                           });
+    }
+
+    for (int i = 0; i < rest->n_shards; ++i) {
+        struct winecord_rest_shard *shard = rest->shards + i;
+
+        shard->is_running = true;
+        ASSERT_S(!pthread_create(&shard->thread, NULL, &_winecord_rest_manager,
+                                 shard),
+                 "Couldn't initialize REST managagement thread");
+    }
 
-    rest->tpool = threadpool_create(1, 1024, 0);
-    ASSERT_S(!threadpool_add(rest->tpool, &_winecord_rest_manager, rest, 0),
-             "Couldn't initialize REST managagement thread");
+    if (rest->warm_connections) _winecord_rest_warm(rest);
 }
 
 void
 winecord_rest_cleanup(struct winecord_rest *rest)
 {
-    /* wake up every ms until thread shutdown */
-    _winecord_timer_ctl(CLIENT(rest, rest), &rest->timers,
-                       &(struct winecord_timer){
-                           .interval = 1,
-                           .repeat = -1,
-                       });
-    /* cleanup REST managing thread */
-    threadpool_destroy(rest->tpool, threadpool_graceful);
+    /* stop serving metrics */
+    winecord_metrics_cleanup(rest);
+    /* cleanup REST managing threads */
+    for (int i = 0; i < rest->n_shards; ++i) {
+        __atomic_store_n(&rest->shards[i].is_running, false, __ATOMIC_RELEASE);
+        io_poller_wakeup(rest->shards[i].io_poller);
+    }
+    for (int i = 0; i < rest->n_shards; ++i)
+        pthread_join(rest->shards[i].thread, NULL);
+    /* wait on callbacks handed over to the worker threadpool, whether they
+     *      have been started or are still queued */
+    winecord_worker_join(CLIENT(rest, rest));
     /* cleanup discovered buckets */
-    winecord_timers_cleanup(CLIENT(rest, rest), &rest->timers);
-    /* cleanup requests */
-    winecord_requestor_cleanup(&rest->requestor);
-    /* cleanup REST poller */
-    io_poller_destroy(rest->io_poller);
+    for (int i = 0; i < rest->n_shards; ++i)
+        winecord_timers_cleanup(CLIENT(rest, rest), &rest->shards[i].timers);
+    /* persist routes discovered by every REST thread */
+    winecord_ratelimiter_save(&rest->shards->requestor.ratelimiter);
+    /* cleanup requests, the first shard's shared state is cleaned up last */
+    for (int i = rest->n_shards - 1; i >= 0; --i)
+        winecord_requestor_cleanup(&rest->shards[i].requestor);
+    /* cleanup REST pollers */
+    for (int i = 0; i < rest->n_shards; ++i)
+        io_poller_destroy(rest->shards[i].io_poller);
+    free(rest->shards);
+    /* drop embeds that haven't been sent */
+    winecord_webhooks_cleanup(&rest->webhooks);
+    /* drop bans that haven't been sent */
+    winecord_bans_cleanup(&rest->bans);
+    /* drop role changes that haven't been sent */
+    winecord_role_deltas_cleanup(&rest->role_deltas);
+    winecord_tenants_cleanup(&rest->tenants);
+}
+
+struct winecord_rest_shard *
+winecord_rest_get_shard(struct winecord_rest *rest, const char key[])
+{
+    if (1 == rest->n_shards) return rest->shards;
+
+    /* all of a major parameter's buckets are handled by the same thread */
+    return rest->shards
+           + winecord_ratelimiter_hash_major(key)
+                 % (unsigned long)rest->n_shards;
+}
+
+void
+winecord_rest_set_executor(struct winecord *client,
+                           enum winecord_executor executor)
+{
+    if (WINECORD_EXECUTOR_DEFAULT == executor)
+        executor = WINECORD_EXECUTOR_MAIN;
+    __atomic_store_n(&client->rest.executor, executor, __ATOMIC_RELAXED);
+}
+
+void
+winecord_rest_set_warm_connections(struct winecord *client, int amount)
+{
+    if (amount < 0) amount = 0;
+    if (amount > WINECORD_WARM_MAX) amount = WINECORD_WARM_MAX;
+
+    __atomic_store_n(&client->rest.warm_connections, amount,
+                     __ATOMIC_RELAXED);
+    if (amount) _winecord_rest_warm(&client->rest);
+}
+
+void
+winecord_rest_set_hedging(struct winecord *client, bool enable)
+{
+    __atomic_store_n(&client->rest.is_hedging, enable, __ATOMIC_RELAXED);
+}
+
+void
+winecord_rest_get_connection_stats(struct winecord *client,
+                                   struct winecord_connection_stats *stats)
+{
+    struct winecord_rest *rest = &client->rest;
+
+    memset(stats, 0, sizeof *stats);
+    for (int i = 0; i < rest->n_shards; ++i) {
+        struct winecord_requestor *rqtor = &rest->shards[i].requestor;
+
+        stats->transfers +=
+            __atomic_load_n(&rqtor->conns.transfers, __ATOMIC_RELAXED);
+        stats->reused +=
+            __atomic_load_n(&rqtor->conns.reused, __ATOMIC_RELAXED);
+        stats->handshakes +=
+            __atomic_load_n(&rqtor->conns.handshakes, __ATOMIC_RELAXED);
+        stats->warm_handshakes +=
+            __atomic_load_n(&rqtor->conns.warm_handshakes, __ATOMIC_RELAXED);
+    }
+    stats->reuse_ratio = stats->transfers
+                             ? (double)stats->reused / (double)stats->transfers
+                             : 0.0;
+}
+
+int
+winecord_rest_get_inflight_limit(struct winecord *client)
+{
+    struct winecord_rest *rest = &client->rest;
+    int limit = 0;
+
+    for (int i = 0; i < rest->n_shards; ++i)
+        limit += __atomic_load_n(&rest->shards[i].requestor.aimd.limit,
+                                 __ATOMIC_RELAXED);
+    return limit;
+}
+
+/* hand back a completed future for a request that couldn't be started, so
+ *      that it can be joined on like any other */
+static WINEBERRY
+_winecord_rest_settle_future(struct winecord_rest *rest,
+                            struct winecord_attributes *attr,
+                            WINEBERRY code)
+{
+    if (WINEBERRY_PENDING != code && attr->dispatch.future
+        && !*attr->dispatch.future)
+    {
+        struct winecord_future *future =
+            winecord_future_create(CLIENT(rest, rest));
+
+        winecord_future_complete(future, code, NULL);
+        /* drops the reference that would be held by the request */
+        winecord_future_dispatch(future);
+        *attr->dispatch.future = future;
+    }
+    return code;
 }
 
 /* template function for performing requests */
@@ -120,10 +329,14 @@ winecord_rest_run(struct winecord_rest *rest,
         static struct ccord_szbuf blank = { 0 };
         body = &blank;
     }
-    else if (body->start && !body->size) {
+    /* written before anything may fail, see _winecord_rest_settle_future() */
+    if (attr->dispatch.future) *attr->dispatch.future = NULL;
+
+    if (body->start && !body->size) {
         logconf_error(&rest->conf, "(Internal error) Request body couldn't "
                                    "be formed, please report it.");
-        return WINEBERRY_MALFORMED_PAYLOAD;
+        return _winecord_rest_settle_future(rest, attr,
+                                           WINEBERRY_MALFORMED_PAYLOAD);
     }
 
     /* build the endpoint string */
@@ -137,6 +350,9 @@ winecord_rest_run(struct winecord_rest *rest,
     winecord_ratelimiter_build_key(method, key, endpoint_fmt, args);
     va_end(args);
 
-    return winecord_request_begin(&rest->requestor, attr, body, method,
-                                 endpoint, key);
+    return _winecord_rest_settle_future(
+        rest, attr,
+        winecord_request_begin(&winecord_rest_get_shard(rest, key)->requestor,
+                               attr, body, method, endpoint, key,
+                               endpoint_fmt));
 }
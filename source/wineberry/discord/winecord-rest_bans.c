@@ -0,0 +1,483 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "winecord.h"
+#include "winecord-internal.h"
+#include "winecord-request.h"
+#include "winecord-rest.h"
+
+#define CHASH_BUCKETS_FIELD buckets
+#include "chash.h"
+
+/* chash heap-mode (auto-increase hashtable) */
+#define BANS_TABLE_HEAP   1
+#define BANS_TABLE_BUCKET struct _winecord_bans_entry
+#define BANS_TABLE_FREE_KEY(_key)
+#define BANS_TABLE_HASH(_key, _hash) ((intptr_t)(_key))
+#define BANS_TABLE_FREE_VALUE(_value) _winecord_ban_batch_free(_value)
+#define BANS_TABLE_COMPARE(_cmp_a, _cmp_b) (_cmp_a == _cmp_b)
+#define BANS_TABLE_INIT(entry, _key, _value)                                  \
+    chash_default_init(entry, _key, _value)
+
+/** tokens of a bulk ban response, two lists of up to 200 users each */
+#define WINECORD_BULK_BAN_TOKENS (2 * WINECORD_BULK_BAN_MAX + 8)
+
+/** @brief A ban waiting for its bulk ban */
+struct _winecord_ban {
+    /** the user to be banned */
+    u64snowflake user_id;
+    /** the ban's return handle */
+    struct winecord_ret ret;
+};
+
+/** @brief Bans of a guild that share their parameters */
+struct _winecord_ban_batch {
+    /** the client the bans have been issued from */
+    struct winecord *client;
+    /** the guild the users belong to */
+    u64snowflake guild_id;
+    /** seconds of messages to be deleted */
+    int delete_message_seconds;
+    /** the audit log reason */
+    char *reason;
+    /** timestamp after which the batch is sent */
+    u64unix_ms deadline;
+    /** the bans */
+    struct _winecord_ban array[WINECORD_BULK_BAN_MAX];
+    /** amount of bans */
+    int size;
+    /** entry for collecting the batches that are due */
+    QUEUE entry;
+};
+
+struct _winecord_bans_entry {
+    /** the guild's id */
+    u64snowflake key;
+    /** the guild's batch being collected */
+    struct _winecord_ban_batch *value;
+    /** the entry state in the hashtable (see chash.h 'State enums') */
+    int state;
+};
+
+/* @note batches detached from the hashtable leave a `NULL` behind */
+static void
+_winecord_ban_batch_free(struct _winecord_ban_batch *batch)
+{
+    if (!batch) return;
+
+    for (int i = 0; i < batch->size; ++i)
+        winecord_refcounter_release_ret(&batch->client->refcounter,
+                                        &batch->array[i].ret);
+    free(batch->reason);
+    free(batch);
+}
+
+static void
+_winecord_ban_batch_cleanup(struct winecord *client, void *p_batch)
+{
+    (void)client;
+    _winecord_ban_batch_free(p_batch);
+}
+
+void
+winecord_bans_init(struct winecord_bans *bans, struct logconf *conf)
+{
+    logconf_branch(&bans->conf, conf, "WINECORD_BANS");
+
+    __chash_init(&bans->batches, BANS_TABLE);
+
+    ASSERT_S(!pthread_mutex_init(&bans->lock, NULL),
+             "Couldn't initialize bans batches mutex");
+}
+
+void
+winecord_bans_cleanup(struct winecord_bans *bans)
+{
+    __chash_free(&bans->batches, BANS_TABLE);
+    pthread_mutex_destroy(&bans->lock);
+}
+
+void
+winecord_rest_set_ban_coalescing(struct winecord *client,
+                                 u64unix_ms window_ms)
+{
+    __atomic_store_n(&client->rest.bans.window, window_ms, __ATOMIC_RELAXED);
+}
+
+size_t
+winecord_bulk_guild_ban_to_json(char buf[],
+                                size_t size,
+                                const struct winecord_bulk_guild_ban *this)
+{
+    size_t len = 0;
+    int ret;
+
+    ret = snprintf(buf, size, "{\"user_ids\":[");
+    if (ret < 0 || (size_t)ret >= size) return 0;
+    len += (size_t)ret;
+
+    for (int i = 0; i < this->user_ids->size; ++i) {
+        ret = snprintf(buf + len, size - len, "%s\"%" PRIu64 "\"",
+                       i ? "," : "", this->user_ids->array[i]);
+        if (ret < 0 || (size_t)ret >= size - len) return 0;
+        len += (size_t)ret;
+    }
+
+    ret = snprintf(buf + len, size - len, "],\"delete_message_seconds\":%d}",
+                   this->delete_message_seconds);
+    if (ret < 0 || (size_t)ret >= size - len) return 0;
+
+    return len + (size_t)ret;
+}
+
+void
+winecord_bulk_ban_init(struct winecord_bulk_ban *this)
+{
+    memset(this, 0, sizeof *this);
+}
+
+static struct snowflakes *
+_winecord_snowflakes_from_pair(const jsmnf_pair *f, const char json[])
+{
+    struct snowflakes *list = calloc(1, sizeof *list);
+
+    if (f->size > 0) {
+        list->array = calloc((size_t)f->size, sizeof *list->array);
+        ASSERT_S(list->array != NULL, "Out of memory");
+        list->realsize = f->size;
+    }
+    for (int i = 0; i < f->size; ++i)
+        list->array[list->size++] =
+            strtoull(json + f->fields[i].v.pos, NULL, 10);
+
+    return list;
+}
+
+size_t
+winecord_bulk_ban_from_json(const char buf[],
+                            size_t size,
+                            struct winecord_bulk_ban *this)
+{
+    jsmnf_pair pairs[WINECORD_BULK_BAN_TOKENS];
+    jsmntok_t tokens[WINECORD_BULK_BAN_TOKENS];
+    jsmnf_loader loader;
+    jsmn_parser parser;
+    jsmnf_pair *f;
+
+    jsmn_init(&parser);
+    if (0 >= jsmn_parse(&parser, buf, size, tokens,
+                        sizeof(tokens) / sizeof *tokens))
+        return 0;
+
+    jsmnf_init(&loader);
+    if (0 >= jsmnf_load(&loader, buf, tokens, parser.toknext, pairs,
+                        sizeof(pairs) / sizeof *pairs))
+        return 0;
+
+    if ((f = jsmnf_find(pairs, buf, "banned_users", 12)))
+        this->banned_users = _winecord_snowflakes_from_pair(f, buf);
+    if ((f = jsmnf_find(pairs, buf, "failed_users", 12)))
+        this->failed_users = _winecord_snowflakes_from_pair(f, buf);
+
+    return size;
+}
+
+void
+winecord_bulk_ban_cleanup(struct winecord_bulk_ban *this)
+{
+    if (this->banned_users) {
+        free(this->banned_users->array);
+        free(this->banned_users);
+    }
+    if (this->failed_users) {
+        free(this->failed_users->array);
+        free(this->failed_users);
+    }
+}
+
+/* execute a coalesced ban's callback */
+static void
+_winecord_ban_dispatch(struct winecord *client,
+                       const struct _winecord_ban *ban,
+                       WINEBERRYcode code)
+{
+    struct winecord_response resp = { .data = ban->ret.data,
+                                      .keep = ban->ret.keep,
+                                      .code = code };
+
+    if (code != WINEBERRY_OK) {
+        if (ban->ret.fail) ban->ret.fail(client, &resp);
+    }
+    else if (ban->ret.done) {
+        ban->ret.done(client, &resp);
+    }
+}
+
+/* have a coalesced ban's callback executed from the client's executor, for
+ *      a batch that couldn't be sent */
+static void
+_winecord_ban_dispatch_code(struct winecord *client,
+                            struct _winecord_ban *ban,
+                            WINEBERRYcode code)
+{
+    struct winecord_attributes attr = { 0 };
+
+    WINECORD_ATTR_BLANK_INIT(attr, &ban->ret, NULL);
+
+    winecord_request_dispatch_code(&client->rest.shards->requestor, &attr,
+                                   code);
+}
+
+static bool
+_winecord_snowflakes_contains(const struct snowflakes *list, u64snowflake id)
+{
+    if (list)
+        for (int i = 0; i < list->size; ++i)
+            if (list->array[i] == id) return true;
+    return false;
+}
+
+/* ban a user the bulk ban has failed for on its own, so that the outcome is
+ *      the same as if the ban had never been coalesced (e.g. banning an
+ *      already banned user succeeds) */
+static void
+_winecord_ban_retry(struct winecord *client,
+                    const struct _winecord_ban_batch *batch,
+                    struct _winecord_ban *ban)
+{
+    struct winecord_create_guild_ban params = {
+        .delete_message_days = batch->delete_message_seconds / 86400,
+        .reason = batch->reason,
+    };
+    struct winecord_attributes attr = { 0 };
+    WINEBERRY code;
+
+    WINECORD_ATTR_BODY_INIT(attr, winecord_create_guild_ban, &params);
+
+    WINECORD_ATTR_BLANK_INIT(attr, &ban->ret, batch->reason);
+
+    code = winecord_rest_run(&client->rest, &attr, NULL, HTTP_PUT,
+                            "/guilds/%" PRIu64 "/bans/%" PRIu64,
+                            batch->guild_id, ban->user_id);
+    if (code != WINEBERRY_PENDING) _winecord_ban_dispatch(client, ban, code);
+}
+
+static void
+_winecord_ban_batch_on_done(struct winecord *client,
+                            struct winecord_response *resp,
+                            const struct winecord_bulk_ban *ret)
+{
+    struct _winecord_ban_batch *batch = resp->data;
+
+    for (int i = 0; i < batch->size; ++i) {
+        struct _winecord_ban *ban = batch->array + i;
+
+        if (_winecord_snowflakes_contains(ret->failed_users, ban->user_id))
+            _winecord_ban_retry(client, batch, ban);
+        else
+            _winecord_ban_dispatch(client, ban, WINEBERRY_OK);
+    }
+}
+
+static void
+_winecord_ban_batch_on_fail(struct winecord *client,
+                            struct winecord_response *resp)
+{
+    struct _winecord_ban_batch *batch = resp->data;
+
+    logconf_error(&client->rest.bans.conf,
+                  "Couldn't ban %d user(s) from guild %" PRIu64 ": %s",
+                  batch->size, batch->guild_id,
+                  winecord_strerror(resp->code, client));
+
+    for (int i = 0; i < batch->size; ++i)
+        _winecord_ban_dispatch(client, batch->array + i, resp->code);
+}
+
+static void
+_winecord_ban_batch_send(struct _winecord_ban_batch *batch)
+{
+    struct winecord *client = batch->client;
+    u64snowflake ids[WINECORD_BULK_BAN_MAX];
+    struct snowflakes user_ids = { .size = batch->size, .array = ids };
+    struct winecord_bulk_guild_ban params = {
+        .user_ids = &user_ids,
+        .delete_message_seconds = batch->delete_message_seconds,
+        .reason = batch->reason,
+    };
+    struct winecord_ret_bulk_ban ret = {
+        .data = batch,
+        .cleanup = &_winecord_ban_batch_cleanup,
+        .done = &_winecord_ban_batch_on_done,
+        .fail = &_winecord_ban_batch_on_fail,
+    };
+    WINEBERRY code;
+
+    for (int i = 0; i < batch->size; ++i)
+        ids[i] = batch->array[i].user_id;
+
+    logconf_info(&client->rest.bans.conf,
+                 "Banning %d user(s) from guild %" PRIu64, batch->size,
+                 batch->guild_id);
+
+    code = winecord_bulk_guild_ban(client, batch->guild_id, &params, &ret);
+    if (code != WINEBERRY_PENDING) {
+        /* the batch has been refused before being referenced by a request */
+        logconf_error(&client->rest.bans.conf,
+                      "Couldn't ban %d user(s) from guild %" PRIu64 ": %s",
+                      batch->size, batch->guild_id,
+                      winecord_strerror(code, client));
+        for (int i = 0; i < batch->size; ++i)
+            _winecord_ban_dispatch_code(client, batch->array + i, code);
+        _winecord_ban_batch_free(batch);
+    }
+}
+
+/* remove the guild's batch, handing it over to the caller */
+static struct _winecord_ban_batch *
+_winecord_bans_detach(struct winecord_bans *bans, u64snowflake guild_id)
+{
+    struct _winecord_bans_entry *entry =
+        chash_lookup_bucket(&bans->batches, guild_id, entry, BANS_TABLE);
+    struct _winecord_ban_batch *batch = entry->value;
+
+    entry->value = NULL;
+    chash_delete(&bans->batches, guild_id, BANS_TABLE);
+
+    return batch;
+}
+
+static void _winecord_bans_schedule(struct winecord *client,
+                                    u64unix_ms delay_ms);
+
+/* send the batches whose window has elapsed */
+static void
+_winecord_bans_sweep_cb(struct winecord *client, struct winecord_timer *timer)
+{
+    (void)timer;
+    struct winecord_bans *bans = &client->rest.bans;
+    const u64unix_ms now = winecord_timestamp(client);
+    QUEUE(struct _winecord_ban_batch) due, queue, *qelem;
+    u64unix_ms next = 0;
+
+    QUEUE_INIT(&due);
+    QUEUE_INIT(&queue);
+
+    pthread_mutex_lock(&bans->lock);
+    bans->is_scheduled = false;
+    for (int i = 0; i < bans->batches.capacity; ++i) {
+        struct _winecord_bans_entry *entry = bans->batches.buckets + i;
+
+        if (CHASH_FILLED != entry->state) continue;
+        if (entry->value->deadline <= now)
+            QUEUE_INSERT_TAIL(&due, &entry->value->entry);
+        else if (!next || entry->value->deadline < next)
+            next = entry->value->deadline;
+    }
+    /* batches are detached once the hashtable is no longer iterated */
+    while (!QUEUE_EMPTY(&due)) {
+        qelem = QUEUE_HEAD(&due);
+        QUEUE_REMOVE(qelem);
+        _winecord_bans_detach(
+            bans, QUEUE_DATA(qelem, struct _winecord_ban_batch, entry)
+                      ->guild_id);
+        QUEUE_INSERT_TAIL(&queue, qelem);
+    }
+    if (next) _winecord_bans_schedule(client, next - now);
+    pthread_mutex_unlock(&bans->lock);
+
+    while (!QUEUE_EMPTY(&queue)) {
+        qelem = QUEUE_HEAD(&queue);
+        QUEUE_REMOVE(qelem);
+        _winecord_ban_batch_send(
+            QUEUE_DATA(qelem, struct _winecord_ban_batch, entry));
+    }
+}
+
+/* @note must be called with the bans lock held */
+static void
+_winecord_bans_schedule(struct winecord *client, u64unix_ms delay_ms)
+{
+    struct winecord_bans *bans = &client->rest.bans;
+
+    if (bans->is_scheduled) return;
+
+    bans->is_scheduled = true;
+    /* batches are sent from the first `REST` thread, so that bans are
+     *      coalesced whether or not the Gateway is running */
+    _winecord_timer_ctl(client, &client->rest.shards->timers,
+                       &(struct winecord_timer){
+                           .on_tick = &_winecord_bans_sweep_cb,
+                           .delay = (int64_t)delay_ms,
+                           .flags = WINECORD_TIMER_DELETE_AUTO,
+                       });
+}
+
+static bool
+_winecord_bans_is_same_reason(const char a[], const char b[])
+{
+    if (!a || !b) return a == b;
+    return 0 == strcmp(a, b);
+}
+
+bool
+winecord_bans_coalesce(struct winecord *client,
+                       u64snowflake guild_id,
+                       u64snowflake user_id,
+                       struct winecord_create_guild_ban *params,
+                       struct winecord_ret *ret)
+{
+    struct winecord_bans *bans = &client->rest.bans;
+    const u64unix_ms window = __atomic_load_n(&bans->window, __ATOMIC_RELAXED);
+    const int delete_message_seconds = params->delete_message_days * 86400;
+    struct _winecord_ban_batch *batch = NULL, *due = NULL;
+    struct _winecord_ban *ban;
+    int found;
+
+    /* the caller is expecting the ban to be performed on its own */
+    if (!window || (ret && (ret->sync || ret->future))) return false;
+
+    pthread_mutex_lock(&bans->lock);
+    found = chash_contains(&bans->batches, guild_id, found, BANS_TABLE);
+    if (found) {
+        batch = chash_lookup(&bans->batches, guild_id, batch, BANS_TABLE);
+        /* bans of a batch share their parameters, so a ban that differs
+         *      sends the batch and starts a new one */
+        if (batch->delete_message_seconds != delete_message_seconds
+            || !_winecord_bans_is_same_reason(batch->reason, params->reason))
+        {
+            due = _winecord_bans_detach(bans, guild_id);
+            batch = NULL;
+        }
+    }
+    if (!batch) {
+        batch = calloc(1, sizeof *batch);
+        batch->client = client;
+        batch->guild_id = guild_id;
+        batch->delete_message_seconds = delete_message_seconds;
+        if (params->reason) batch->reason = strdup(params->reason);
+        batch->deadline = winecord_timestamp(client) + window;
+        QUEUE_INIT(&batch->entry);
+        chash_assign(&bans->batches, guild_id, batch, BANS_TABLE);
+    }
+
+    ban = batch->array + batch->size++;
+    ban->user_id = user_id;
+    if (ret) {
+        ban->ret = *ret;
+        /* kept alive until the bulk ban completes */
+        winecord_refcounter_hold_ret(&client->refcounter, &ban->ret);
+    }
+
+    /* a full batch is sent at once, rather than once its window elapses */
+    if (WINECORD_BULK_BAN_MAX == batch->size)
+        due = _winecord_bans_detach(bans, guild_id);
+    else
+        _winecord_bans_schedule(client, window);
+    pthread_mutex_unlock(&bans->lock);
+
+    if (due) _winecord_ban_batch_send(due);
+
+    return true;
+}
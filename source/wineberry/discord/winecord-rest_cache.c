@@ -0,0 +1,586 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "winecord.h"
+#include "winecord-internal.h"
+#include "winecord-rest.h"
+
+#include "cog-utils.h"
+
+#define CHASH_BUCKETS_FIELD buckets
+#include "chash.h"
+
+/* chash heap-mode (auto-increase hashtable) */
+#define RESPONSES_TABLE_HEAP   1
+#define RESPONSES_TABLE_BUCKET struct _winecord_cached_response
+#define RESPONSES_TABLE_FREE_KEY(_key) free(_key)
+#define RESPONSES_TABLE_HASH(_key, _hash) chash_string_hash(_key, _hash)
+#define RESPONSES_TABLE_FREE_VALUE(_value) free((_value).body.start)
+#define RESPONSES_TABLE_COMPARE(_cmp_a, _cmp_b)                               \
+    chash_string_compare(_cmp_a, _cmp_b)
+#define RESPONSES_TABLE_INIT(response, _key, _value)                          \
+    chash_default_init(response, _key, _value)
+
+/* chash heap-mode (auto-increase hashtable) */
+#define ROUTES_TABLE_HEAP   1
+#define ROUTES_TABLE_BUCKET struct _winecord_cached_route
+#define ROUTES_TABLE_FREE_KEY(_key) free(_key)
+#define ROUTES_TABLE_HASH(_key, _hash) chash_string_hash(_key, _hash)
+#define ROUTES_TABLE_FREE_VALUE(_value)
+#define ROUTES_TABLE_COMPARE(_cmp_a, _cmp_b)                                  \
+    chash_string_compare(_cmp_a, _cmp_b)
+#define ROUTES_TABLE_INIT(route, _key, _value)                                \
+    chash_default_init(route, _key, _value)
+
+/** max amount of responses kept at once */
+#define WINECORD_REST_CACHE_MAX 4096
+/** max length of a response entity tag */
+#define WINECORD_REST_CACHE_ETAG_LEN 128
+
+struct _winecord_cached_value {
+    /** the response body */
+    struct ccord_szbuf body;
+    /** the response entity tag, empty if not provided by the server */
+    char etag[WINECORD_REST_CACHE_ETAG_LEN];
+    /** timestamp of when response expires */
+    u64unix_ms expire_tstamp;
+};
+
+struct _winecord_cached_response {
+    /** the response's endpoint */
+    char *key;
+    /** the cached response */
+    struct _winecord_cached_value value;
+    /** the response state in the hashtable (see chash.h 'State enums') */
+    int state;
+};
+
+struct _winecord_cached_route {
+    /** the route's endpoint format string */
+    char *key;
+    /** the route's time-to-live */
+    u64unix_ms value;
+    /** the route state in the hashtable (see chash.h 'State enums') */
+    int state;
+};
+
+void
+winecord_rest_cache_init(struct winecord_rest_cache *cache,
+                        struct logconf *conf,
+                        u64unix_ms default_ttl)
+{
+    logconf_branch(&cache->conf, conf, "WINECORD_REST_CACHE");
+
+    cache->default_ttl = default_ttl;
+    __chash_init(&cache->responses, RESPONSES_TABLE);
+    __chash_init(&cache->routes, ROUTES_TABLE);
+
+    ASSERT_S(!pthread_mutex_init(&cache->lock, NULL),
+             "Couldn't initialize REST cache mutex");
+}
+
+void
+winecord_rest_cache_cleanup(struct winecord_rest_cache *cache)
+{
+    __chash_free(&cache->responses, RESPONSES_TABLE);
+    __chash_free(&cache->routes, ROUTES_TABLE);
+    pthread_mutex_destroy(&cache->lock);
+}
+
+static u64unix_ms
+_winecord_rest_cache_get_ttl(struct winecord_rest_cache *cache,
+                            const char route[])
+{
+    u64unix_ms ttl = cache->default_ttl;
+    int ret = chash_contains(&cache->routes, (char *)route, ret, ROUTES_TABLE);
+
+    if (ret)
+        ttl = chash_lookup(&cache->routes, (char *)route, ttl, ROUTES_TABLE);
+
+    return ttl;
+}
+
+u64unix_ms
+winecord_rest_cache_get_ttl(struct winecord_rest_cache *cache,
+                           const char route[])
+{
+    u64unix_ms ttl;
+
+    pthread_mutex_lock(&cache->lock);
+    ttl = _winecord_rest_cache_get_ttl(cache, route);
+    pthread_mutex_unlock(&cache->lock);
+
+    return ttl;
+}
+
+static struct _winecord_cached_value *
+_winecord_rest_cache_find(struct winecord_rest_cache *cache,
+                         const char endpoint[])
+{
+    struct _winecord_cached_response *response;
+    int ret = chash_contains(&cache->responses, (char *)endpoint, ret,
+                             RESPONSES_TABLE);
+
+    if (!ret) return NULL;
+
+    response = chash_lookup_bucket(&cache->responses, (char *)endpoint,
+                                   response, RESPONSES_TABLE);
+    return &response->value;
+}
+
+static void
+_winecord_rest_cache_copy(const struct _winecord_cached_value *value,
+                         struct ccord_szbuf *body)
+{
+    body->start = malloc(value->body.size);
+    memcpy(body->start, value->body.start, value->body.size);
+    body->size = value->body.size;
+}
+
+bool
+winecord_rest_cache_find(struct winecord_rest_cache *cache,
+                        const char endpoint[],
+                        struct ccord_szbuf *body)
+{
+    struct _winecord_cached_value *value;
+    bool found = false;
+
+    pthread_mutex_lock(&cache->lock);
+    if ((value = _winecord_rest_cache_find(cache, endpoint))
+        && value->expire_tstamp > cog_timestamp_ms())
+    {
+        _winecord_rest_cache_copy(value, body);
+        found = true;
+    }
+    pthread_mutex_unlock(&cache->lock);
+
+    return found;
+}
+
+bool
+winecord_rest_cache_get_etag(struct winecord_rest_cache *cache,
+                            const char endpoint[],
+                            char etag[],
+                            size_t size)
+{
+    struct _winecord_cached_value *value;
+    bool found = false;
+
+    pthread_mutex_lock(&cache->lock);
+    if ((value = _winecord_rest_cache_find(cache, endpoint))
+        && *value->etag)
+    {
+        found = (size_t)snprintf(etag, size, "%s", value->etag) < size;
+    }
+    pthread_mutex_unlock(&cache->lock);
+
+    return found;
+}
+
+bool
+winecord_rest_cache_revalidate(struct winecord_rest_cache *cache,
+                              const char route[],
+                              const char endpoint[],
+                              struct ccord_szbuf *body)
+{
+    struct _winecord_cached_value *value;
+    bool found = false;
+
+    pthread_mutex_lock(&cache->lock);
+    if ((value = _winecord_rest_cache_find(cache, endpoint))) {
+        value->expire_tstamp =
+            cog_timestamp_ms() + _winecord_rest_cache_get_ttl(cache, route);
+        _winecord_rest_cache_copy(value, body);
+        found = true;
+    }
+    pthread_mutex_unlock(&cache->lock);
+
+    return found;
+}
+
+/* drop expired responses that can't be revalidated */
+static void
+_winecord_rest_cache_purge(struct winecord_rest_cache *cache)
+{
+    const u64unix_ms now = cog_timestamp_ms();
+
+    for (int i = 0; i < cache->responses.capacity; ++i) {
+        struct _winecord_cached_response *r = cache->responses.buckets + i;
+
+        if (CHASH_FILLED == r->state && !*r->value.etag
+            && r->value.expire_tstamp <= now)
+        {
+            chash_delete(&cache->responses, r->key, RESPONSES_TABLE);
+        }
+    }
+}
+
+void
+winecord_rest_cache_store(struct winecord_rest_cache *cache,
+                         const char route[],
+                         const char endpoint[],
+                         const struct ua_szbuf_readonly *body,
+                         const struct ua_szbuf_readonly *etag)
+{
+    struct _winecord_cached_value *value;
+    u64unix_ms ttl;
+
+    pthread_mutex_lock(&cache->lock);
+
+    if (!(ttl = _winecord_rest_cache_get_ttl(cache, route))) {
+        pthread_mutex_unlock(&cache->lock);
+        return;
+    }
+
+    if (!(value = _winecord_rest_cache_find(cache, endpoint))) {
+        struct _winecord_cached_value blank = { 0 };
+
+        if (cache->responses.length >= WINECORD_REST_CACHE_MAX)
+            _winecord_rest_cache_purge(cache);
+        if (cache->responses.length >= WINECORD_REST_CACHE_MAX) {
+            logconf_debug(&cache->conf,
+                          "Cache is full, skip caching response of [%s]",
+                          endpoint);
+            pthread_mutex_unlock(&cache->lock);
+            return;
+        }
+
+        chash_assign(&cache->responses, strdup(endpoint), blank,
+                     RESPONSES_TABLE);
+        value = _winecord_rest_cache_find(cache, endpoint);
+    }
+
+    if (body->size > value->body.size) {
+        void *tmp = realloc(value->body.start, body->size);
+        ASSERT_S(tmp != NULL, "Out of memory");
+
+        value->body.start = tmp;
+    }
+    memcpy(value->body.start, body->start, body->size);
+    value->body.size = body->size;
+
+    if (etag->size < sizeof(value->etag))
+        snprintf(value->etag, sizeof(value->etag), "%.*s", (int)etag->size,
+                 etag->start);
+    else
+        *value->etag = '\0';
+
+    value->expire_tstamp = cog_timestamp_ms() + ttl;
+
+    pthread_mutex_unlock(&cache->lock);
+}
+
+static bool
+_winecord_rest_cache_match(const char endpoint[],
+                          const char prefix[],
+                          size_t prefix_len,
+                          bool allow_subroutes)
+{
+    if (strncmp(endpoint, prefix, prefix_len) != 0) return false;
+
+    switch (endpoint[prefix_len]) {
+    case '\0':
+    case '?':
+        return true;
+    case '/':
+        return allow_subroutes;
+    default:
+        return false;
+    }
+}
+
+void
+winecord_rest_cache_drop(struct winecord_rest_cache *cache,
+                        const char prefix[])
+{
+    size_t prefix_len = strlen(prefix);
+    bool allow_subroutes = true;
+
+    if (prefix_len && '$' == prefix[prefix_len - 1]) {
+        allow_subroutes = false;
+        --prefix_len;
+    }
+
+    pthread_mutex_lock(&cache->lock);
+    for (int i = 0; i < cache->responses.capacity; ++i) {
+        struct _winecord_cached_response *r = cache->responses.buckets + i;
+
+        if (CHASH_FILLED == r->state
+            && _winecord_rest_cache_match(r->key, prefix, prefix_len,
+                                         allow_subroutes))
+        {
+            logconf_trace(&cache->conf, "Dropped cached response of [%s]",
+                          r->key);
+            chash_delete(&cache->responses, r->key, RESPONSES_TABLE);
+        }
+    }
+    pthread_mutex_unlock(&cache->lock);
+}
+
+/* whether a cached response is outdated by a write to `endpoint`, for being
+ *      the response of its resource (or one of its subroutes), or of one of
+ *      its parents (e.g. a list it belongs to) */
+static bool
+_winecord_rest_cache_is_written(const char key[],
+                               const char endpoint[],
+                               size_t endpoint_len)
+{
+    const size_t key_len = strcspn(key, "?");
+
+    if (_winecord_rest_cache_match(key, endpoint, endpoint_len, true))
+        return true;
+    return key_len < endpoint_len && '/' == endpoint[key_len]
+           && 0 == strncmp(key, endpoint, key_len);
+}
+
+void
+winecord_rest_cache_on_write(struct winecord_rest_cache *cache,
+                            const char endpoint[])
+{
+    const size_t endpoint_len = strcspn(endpoint, "?");
+
+    pthread_mutex_lock(&cache->lock);
+    for (int i = 0; i < cache->responses.capacity; ++i) {
+        struct _winecord_cached_response *r = cache->responses.buckets + i;
+
+        if (CHASH_FILLED == r->state
+            && _winecord_rest_cache_is_written(r->key, endpoint, endpoint_len))
+        {
+            logconf_trace(&cache->conf, "Dropped cached response of [%s]",
+                          r->key);
+            chash_delete(&cache->responses, r->key, RESPONSES_TABLE);
+        }
+    }
+    pthread_mutex_unlock(&cache->lock);
+}
+
+/** @brief Endpoints outdated by a Gateway event */
+static const struct {
+    /** the Gateway event */
+    enum winecord_gateway_events event;
+    /**
+     * endpoint prefix to be dropped, `{field}` is replaced by the event's
+     *      field (`{a.b}` for nested fields)
+     * @see winecord_rest_cache_drop()
+     */
+    const char *prefix;
+} g_outdated_by[] = {
+    { WINEBERRY_EV_APPLICATION_COMMAND_PERMISSIONS_UPDATE,
+      "/applications/{application_id}/guilds/{guild_id}/commands" },
+    { WINEBERRY_EV_AUTO_MODERATION_RULE_CREATE,
+      "/guilds/{guild_id}/auto-moderation" },
+    { WINEBERRY_EV_AUTO_MODERATION_RULE_UPDATE,
+      "/guilds/{guild_id}/auto-moderation" },
+    { WINEBERRY_EV_AUTO_MODERATION_RULE_DELETE,
+      "/guilds/{guild_id}/auto-moderation" },
+    { WINEBERRY_EV_CHANNEL_CREATE, "/guilds/{guild_id}/channels$" },
+    { WINEBERRY_EV_CHANNEL_UPDATE, "/channels/{id}$" },
+    { WINEBERRY_EV_CHANNEL_UPDATE, "/guilds/{guild_id}/channels$" },
+    { WINEBERRY_EV_CHANNEL_DELETE, "/channels/{id}" },
+    { WINEBERRY_EV_CHANNEL_DELETE, "/guilds/{guild_id}/channels$" },
+    { WINEBERRY_EV_CHANNEL_PINS_UPDATE, "/channels/{channel_id}/pins" },
+    { WINEBERRY_EV_THREAD_CREATE, "/guilds/{guild_id}/threads" },
+    { WINEBERRY_EV_THREAD_CREATE, "/channels/{parent_id}/threads" },
+    { WINEBERRY_EV_THREAD_UPDATE, "/channels/{id}$" },
+    { WINEBERRY_EV_THREAD_UPDATE, "/guilds/{guild_id}/threads" },
+    { WINEBERRY_EV_THREAD_UPDATE, "/channels/{parent_id}/threads" },
+    { WINEBERRY_EV_THREAD_DELETE, "/channels/{id}" },
+    { WINEBERRY_EV_THREAD_DELETE, "/guilds/{guild_id}/threads" },
+    { WINEBERRY_EV_THREAD_DELETE, "/channels/{parent_id}/threads" },
+    { WINEBERRY_EV_THREAD_MEMBERS_UPDATE, "/channels/{id}/thread-members" },
+    { WINEBERRY_EV_GUILD_UPDATE, "/guilds/{id}$" },
+    { WINEBERRY_EV_GUILD_DELETE, "/guilds/{id}" },
+    { WINEBERRY_EV_GUILD_BAN_ADD, "/guilds/{guild_id}/bans" },
+    { WINEBERRY_EV_GUILD_BAN_REMOVE, "/guilds/{guild_id}/bans" },
+    { WINEBERRY_EV_GUILD_EMOJIS_UPDATE, "/guilds/{guild_id}/emojis" },
+    { WINEBERRY_EV_GUILD_STICKERS_UPDATE, "/guilds/{guild_id}/stickers" },
+    { WINEBERRY_EV_GUILD_INTEGRATIONS_UPDATE,
+      "/guilds/{guild_id}/integrations" },
+    { WINEBERRY_EV_GUILD_MEMBER_ADD, "/guilds/{guild_id}/members" },
+    { WINEBERRY_EV_GUILD_MEMBER_UPDATE, "/guilds/{guild_id}/members" },
+    { WINEBERRY_EV_GUILD_MEMBER_UPDATE, "/users/{user.id}$" },
+    { WINEBERRY_EV_GUILD_MEMBER_REMOVE, "/guilds/{guild_id}/members" },
+    { WINEBERRY_EV_GUILD_ROLE_CREATE, "/guilds/{guild_id}/roles" },
+    { WINEBERRY_EV_GUILD_ROLE_CREATE, "/guilds/{guild_id}$" },
+    { WINEBERRY_EV_GUILD_ROLE_UPDATE, "/guilds/{guild_id}/roles" },
+    { WINEBERRY_EV_GUILD_ROLE_UPDATE, "/guilds/{guild_id}$" },
+    { WINEBERRY_EV_GUILD_ROLE_DELETE, "/guilds/{guild_id}/roles" },
+    { WINEBERRY_EV_GUILD_ROLE_DELETE, "/guilds/{guild_id}$" },
+    { WINEBERRY_EV_GUILD_SCHEDULED_EVENT_CREATE,
+      "/guilds/{guild_id}/scheduled-events$" },
+    { WINEBERRY_EV_GUILD_SCHEDULED_EVENT_UPDATE,
+      "/guilds/{guild_id}/scheduled-events" },
+    { WINEBERRY_EV_GUILD_SCHEDULED_EVENT_DELETE,
+      "/guilds/{guild_id}/scheduled-events" },
+    { WINEBERRY_EV_GUILD_SCHEDULED_EVENT_USER_ADD,
+      "/guilds/{guild_id}/scheduled-events/{guild_scheduled_event_id}" },
+    { WINEBERRY_EV_GUILD_SCHEDULED_EVENT_USER_REMOVE,
+      "/guilds/{guild_id}/scheduled-events/{guild_scheduled_event_id}" },
+    { WINEBERRY_EV_INTEGRATION_CREATE, "/guilds/{guild_id}/integrations" },
+    { WINEBERRY_EV_INTEGRATION_UPDATE, "/guilds/{guild_id}/integrations" },
+    { WINEBERRY_EV_INTEGRATION_DELETE, "/guilds/{guild_id}/integrations" },
+    { WINEBERRY_EV_INVITE_CREATE, "/channels/{channel_id}/invites" },
+    { WINEBERRY_EV_INVITE_CREATE, "/guilds/{guild_id}/invites" },
+    { WINEBERRY_EV_INVITE_DELETE, "/channels/{channel_id}/invites" },
+    { WINEBERRY_EV_INVITE_DELETE, "/guilds/{guild_id}/invites" },
+    { WINEBERRY_EV_MESSAGE_CREATE, "/channels/{channel_id}/messages$" },
+    { WINEBERRY_EV_MESSAGE_UPDATE, "/channels/{channel_id}/messages$" },
+    { WINEBERRY_EV_MESSAGE_UPDATE, "/channels/{channel_id}/messages/{id}" },
+    { WINEBERRY_EV_MESSAGE_DELETE, "/channels/{channel_id}/messages$" },
+    { WINEBERRY_EV_MESSAGE_DELETE, "/channels/{channel_id}/messages/{id}" },
+    { WINEBERRY_EV_MESSAGE_DELETE_BULK, "/channels/{channel_id}/messages" },
+    { WINEBERRY_EV_MESSAGE_REACTION_ADD,
+      "/channels/{channel_id}/messages/{message_id}" },
+    { WINEBERRY_EV_MESSAGE_REACTION_REMOVE,
+      "/channels/{channel_id}/messages/{message_id}" },
+    { WINEBERRY_EV_MESSAGE_REACTION_REMOVE_ALL,
+      "/channels/{channel_id}/messages/{message_id}" },
+    { WINEBERRY_EV_MESSAGE_REACTION_REMOVE_EMOJI,
+      "/channels/{channel_id}/messages/{message_id}" },
+    { WINEBERRY_EV_STAGE_INSTANCE_CREATE, "/stage-instances/{channel_id}" },
+    { WINEBERRY_EV_STAGE_INSTANCE_UPDATE, "/stage-instances/{channel_id}" },
+    { WINEBERRY_EV_STAGE_INSTANCE_DELETE, "/stage-instances/{channel_id}" },
+    { WINEBERRY_EV_USER_UPDATE, "/users/@me$" },
+    { WINEBERRY_EV_USER_UPDATE, "/users/{id}$" },
+    { WINEBERRY_EV_WEBHOOKS_UPDATE, "/channels/{channel_id}/webhooks" },
+    { WINEBERRY_EV_WEBHOOKS_UPDATE, "/guilds/{guild_id}/webhooks" },
+};
+
+/* replace `{field}` placeholders with the event's fields, returns `false`
+ *      if a field is missing */
+static bool
+_winecord_rest_cache_expand(char buf[],
+                           size_t size,
+                           const char fmt[],
+                           const jsmnf_pair *data,
+                           const char json[])
+{
+    size_t len = 0;
+
+    while (*fmt) {
+        const jsmnf_pair *f = data;
+        const char *name, *end;
+        int ret;
+
+        if (*fmt != '{') {
+            if (len + 1 >= size) return false;
+            buf[len++] = *fmt++;
+            continue;
+        }
+
+        /* resolve (possibly nested) field */
+        name = fmt + 1;
+        fmt = strchr(name, '}');
+        do {
+            end = memchr(name, '.', (size_t)(fmt - name));
+            if (!end) end = fmt;
+            if (!(f = jsmnf_find(f, json, name, (size_t)(end - name))))
+                return false;
+            name = end + 1;
+        } while (end != fmt);
+        ++fmt;
+
+        ret = snprintf(buf + len, size - len, "%.*s", (int)f->v.len,
+                       json + f->v.pos);
+        if (ret < 0 || (size_t)ret >= size - len || 0 == f->v.len)
+            return false;
+        len += (size_t)ret;
+    }
+    buf[len] = '\0';
+
+    return true;
+}
+
+void
+winecord_rest_cache_on_event(struct winecord_rest_cache *cache,
+                            enum winecord_gateway_events event,
+                            const jsmnf_pair *data,
+                            const char json[])
+{
+    char prefix[WINECORD_ENDPT_LEN];
+
+    if (!data) return;
+
+    for (size_t i = 0; i < sizeof(g_outdated_by) / sizeof *g_outdated_by; ++i)
+    {
+        if (g_outdated_by[i].event == event
+            && _winecord_rest_cache_expand(prefix, sizeof(prefix),
+                                          g_outdated_by[i].prefix, data, json))
+        {
+            winecord_rest_cache_drop(cache, prefix);
+        }
+    }
+}
+
+void
+winecord_rest_cache_enable(struct winecord *client, u64unix_ms default_ttl_ms)
+{
+    struct winecord_requestor *rqtor = &client->rest.shards->requestor;
+    struct winecord_rest_cache *cache =
+        __atomic_load_n(&rqtor->cache, __ATOMIC_ACQUIRE);
+    struct winecord_rest_cache *expected = NULL;
+
+    if (!cache) {
+        cache = calloc(1, sizeof *cache);
+        winecord_rest_cache_init(cache, &rqtor->conf, default_ttl_ms);
+        /* the cache may be enabled concurrently, only one of them is kept */
+        if (__atomic_compare_exchange_n(&rqtor->cache, &expected, cache,
+                                        false, __ATOMIC_ACQ_REL,
+                                        __ATOMIC_ACQUIRE))
+        {
+            /* cache may be read concurrently from every `REST` thread */
+            for (int i = 1; i < client->rest.n_shards; ++i)
+                __atomic_store_n(&client->rest.shards[i].requestor.cache,
+                                 cache, __ATOMIC_RELEASE);
+            return;
+        }
+        winecord_rest_cache_cleanup(cache);
+        free(cache);
+        cache = expected;
+    }
+
+    pthread_mutex_lock(&cache->lock);
+    cache->default_ttl = default_ttl_ms;
+    pthread_mutex_unlock(&cache->lock);
+}
+
+void
+winecord_rest_cache_set_ttl(struct winecord *client,
+                           const char route[],
+                           u64unix_ms ttl_ms)
+{
+    struct winecord_rest_cache *cache =
+        __atomic_load_n(&client->rest.shards->requestor.cache,
+                        __ATOMIC_ACQUIRE);
+    int ret;
+
+    if (!cache) {
+        logconf_warn(&client->rest.shards->requestor.conf,
+                     "REST cache must be enabled with "
+                     "winecord_rest_cache_enable() first");
+        return;
+    }
+
+    pthread_mutex_lock(&cache->lock);
+    ret = chash_contains(&cache->routes, (char *)route, ret, ROUTES_TABLE);
+    if (ret) {
+        struct _winecord_cached_route *r = chash_lookup_bucket(
+            &cache->routes, (char *)route, r, ROUTES_TABLE);
+        r->value = ttl_ms;
+    }
+    else {
+        chash_assign(&cache->routes, strdup(route), ttl_ms, ROUTES_TABLE);
+    }
+    pthread_mutex_unlock(&cache->lock);
+}
+
+void
+winecord_rest_cache_invalidate(struct winecord *client, const char prefix[])
+{
+    struct winecord_rest_cache *cache =
+        __atomic_load_n(&client->rest.shards->requestor.cache,
+                        __ATOMIC_ACQUIRE);
+
+    if (cache) winecord_rest_cache_drop(cache, prefix);
+}
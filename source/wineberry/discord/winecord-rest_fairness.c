@@ -0,0 +1,285 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "winecord.h"
+#include "winecord-internal.h"
+#include "winecord-rest.h"
+
+#define CHASH_BUCKETS_FIELD buckets
+#include "chash.h"
+
+/* chash heap-mode (auto-increase hashtable) */
+#define TENANTS_TABLE_HEAP   1
+#define TENANTS_TABLE_BUCKET struct _winecord_tenant
+#define TENANTS_TABLE_FREE_KEY(_key)
+#define TENANTS_TABLE_HASH(_key, _hash) ((intptr_t)(_key))
+#define TENANTS_TABLE_FREE_VALUE(_value)
+#define TENANTS_TABLE_COMPARE(_cmp_a, _cmp_b) (_cmp_a == _cmp_b)
+#define TENANTS_TABLE_INIT(tenant, _key, _value)                              \
+    chash_default_init(tenant, _key, _value)
+
+#define FLOWS_TABLE_HEAP   1
+#define FLOWS_TABLE_BUCKET struct _winecord_flows_entry
+#define FLOWS_TABLE_FREE_KEY(_key)
+#define FLOWS_TABLE_HASH(_key, _hash)  ((intptr_t)(_key))
+#define FLOWS_TABLE_FREE_VALUE(_value) free(_value)
+#define FLOWS_TABLE_COMPARE(_cmp_a, _cmp_b) (_cmp_a == _cmp_b)
+#define FLOWS_TABLE_INIT(entry, _key, _value)                                 \
+    chash_default_init(entry, _key, _value)
+
+/** max weight of a tenant */
+#define WINECORD_FAIR_WEIGHT_MAX 1024
+
+struct _winecord_tenant {
+    /** the tenant's key */
+    u64snowflake key;
+    /** the tenant's weight */
+    int value;
+    /** the tenant state in the hashtable (see chash.h 'State enums') */
+    int state;
+};
+
+/** @brief A tenant's requests queued at a bucket */
+struct _winecord_flow {
+    /** the tenant's queued requests, in order */
+    QUEUE(struct winecord_request) requests;
+    /** finish tag of the tenant's last queued request */
+    uint64_t finish;
+    /** entry for @ref winecord_flows queue */
+    QUEUE entry;
+};
+
+struct _winecord_flows_entry {
+    /** the tenant's key */
+    u64snowflake key;
+    /** the tenant's queue */
+    struct _winecord_flow *value;
+    /** the tenant state in the hashtable (see chash.h 'State enums') */
+    int state;
+};
+
+static pthread_key_t g_tenant_context_key;
+static pthread_once_t g_tenant_context_once = PTHREAD_ONCE_INIT;
+
+static void
+_winecord_tenant_context_key_init(void)
+{
+    ASSERT_S(!pthread_key_create(&g_tenant_context_key, &free),
+             "Couldn't create tenant context key");
+}
+
+/* get the calling thread's tenant context */
+static u64snowflake *
+_winecord_tenant_context_get(void)
+{
+    u64snowflake *context;
+
+    pthread_once(&g_tenant_context_once, &_winecord_tenant_context_key_init);
+    if (NULL == (context = pthread_getspecific(g_tenant_context_key))) {
+        context = calloc(1, sizeof *context);
+        pthread_setspecific(g_tenant_context_key, context);
+    }
+    return context;
+}
+
+u64snowflake
+winecord_tenant_context_get(void)
+{
+    return *_winecord_tenant_context_get();
+}
+
+u64snowflake
+winecord_tenant_context_swap(u64snowflake tenant)
+{
+    u64snowflake *context = _winecord_tenant_context_get(), prev = *context;
+
+    *context = tenant;
+    return prev;
+}
+
+void
+winecord_tenants_init(struct winecord_tenants *tenants)
+{
+    __chash_init(&tenants->weights, TENANTS_TABLE);
+
+    ASSERT_S(!pthread_mutex_init(&tenants->lock, NULL),
+             "Couldn't initialize tenants weights mutex");
+}
+
+void
+winecord_tenants_cleanup(struct winecord_tenants *tenants)
+{
+    __chash_free(&tenants->weights, TENANTS_TABLE);
+    pthread_mutex_destroy(&tenants->lock);
+}
+
+int
+winecord_tenants_get_weight(struct winecord_tenants *tenants,
+                            u64snowflake tenant)
+{
+    int weight = 1, ret;
+
+    /* skip locking for the common case of no weights assigned */
+    if (!__atomic_load_n(&tenants->weights.length, __ATOMIC_RELAXED))
+        return 1;
+
+    pthread_mutex_lock(&tenants->lock);
+    ret = chash_contains(&tenants->weights, tenant, ret, TENANTS_TABLE);
+    if (ret)
+        weight = chash_lookup(&tenants->weights, tenant, weight,
+                              TENANTS_TABLE);
+    pthread_mutex_unlock(&tenants->lock);
+
+    return weight;
+}
+
+void
+winecord_rest_set_tenant_weight(struct winecord *client,
+                                u64snowflake tenant,
+                                int weight)
+{
+    struct winecord_tenants *tenants = &client->rest.tenants;
+    int ret;
+
+    if (weight > WINECORD_FAIR_WEIGHT_MAX) weight = WINECORD_FAIR_WEIGHT_MAX;
+
+    pthread_mutex_lock(&tenants->lock);
+    ret = chash_contains(&tenants->weights, tenant, ret, TENANTS_TABLE);
+    if (weight <= 1) {
+        if (ret) chash_delete(&tenants->weights, tenant, TENANTS_TABLE);
+    }
+    else if (ret) {
+        struct _winecord_tenant *t = chash_lookup_bucket(
+            &tenants->weights, tenant, t, TENANTS_TABLE);
+        t->value = weight;
+    }
+    else {
+        chash_assign(&tenants->weights, tenant, weight, TENANTS_TABLE);
+    }
+    pthread_mutex_unlock(&tenants->lock);
+}
+
+void
+winecord_flows_init(struct winecord_flows *flows)
+{
+    __chash_init(&flows->tenants, FLOWS_TABLE);
+    QUEUE_INIT(&flows->queue);
+}
+
+void
+winecord_flows_cleanup(struct winecord_flows *flows)
+{
+    __chash_free(&flows->tenants, FLOWS_TABLE);
+}
+
+/* get the tenant's queue, NULL if it has no requests queued */
+static struct _winecord_flow *
+_winecord_flows_find(struct winecord_flows *flows, u64snowflake tenant)
+{
+    struct _winecord_flow *flow = NULL;
+    int ret = chash_contains(&flows->tenants, tenant, ret, FLOWS_TABLE);
+
+    if (ret) flow = chash_lookup(&flows->tenants, tenant, flow, FLOWS_TABLE);
+    return flow;
+}
+
+static struct winecord_request *
+_winecord_flow_peek(struct _winecord_flow *flow)
+{
+    return QUEUE_DATA(QUEUE_HEAD(&flow->requests), struct winecord_request,
+                      entry);
+}
+
+/* position the tenant's queue again, once its next request has changed */
+static void
+_winecord_flows_position(struct winecord_flows *flows,
+                         struct _winecord_flow *flow)
+{
+    struct winecord_request *head = _winecord_flow_peek(flow);
+    QUEUE(struct _winecord_flow) *qelem;
+
+    QUEUE_REMOVE(&flow->entry);
+    /* walk from the tail, as most requests share the same class and don't
+     *      have a deadline */
+    for (qelem = QUEUE_PREV(&flows->queue); qelem != &flows->queue;
+         qelem = QUEUE_PREV(qelem))
+        if (!winecord_request_precedes(
+                head, _winecord_flow_peek(
+                          QUEUE_DATA(qelem, struct _winecord_flow, entry))))
+            break;
+    QUEUE_INSERT_HEAD(qelem, &flow->entry);
+}
+
+uint64_t
+winecord_flows_get_finish(struct winecord_flows *flows, u64snowflake tenant)
+{
+    struct _winecord_flow *flow = _winecord_flows_find(flows, tenant);
+
+    return flow ? flow->finish : 0;
+}
+
+void
+winecord_flows_insert(struct winecord_flows *flows,
+                      struct winecord_request *req,
+                      bool high_priority)
+{
+    struct _winecord_flow *flow =
+        _winecord_flows_find(flows, req->fair.tenant);
+
+    if (!flow) {
+        flow = calloc(1, sizeof *flow);
+        QUEUE_INIT(&flow->requests);
+        QUEUE_INIT(&flow->entry);
+        chash_assign(&flows->tenants, req->fair.tenant, flow, FLOWS_TABLE);
+    }
+    if (req->fair.finish > flow->finish) flow->finish = req->fair.finish;
+
+    if (high_priority) {
+        QUEUE_INSERT_HEAD(&flow->requests, &req->entry);
+        QUEUE_REMOVE(&flow->entry);
+        QUEUE_INSERT_HEAD(&flows->queue, &flow->entry);
+    }
+    else {
+        QUEUE(struct winecord_request) *qelem = QUEUE_PREV(&flow->requests);
+
+        /* a tenant's requests are tagged in order, so only a request of a
+         *      higher class or with a deadline is walked past the others */
+        while (qelem != &flow->requests
+               && winecord_request_precedes(
+                   req, QUEUE_DATA(qelem, struct winecord_request, entry)))
+            qelem = QUEUE_PREV(qelem);
+        QUEUE_INSERT_HEAD(qelem, &req->entry);
+
+        if (_winecord_flow_peek(flow) == req)
+            _winecord_flows_position(flows, flow);
+    }
+}
+
+void
+winecord_flows_remove(struct winecord_flows *flows,
+                      struct winecord_request *req)
+{
+    struct _winecord_flow *flow =
+        _winecord_flows_find(flows, req->fair.tenant);
+    const bool was_head = (_winecord_flow_peek(flow) == req);
+
+    QUEUE_REMOVE(&req->entry);
+    QUEUE_INIT(&req->entry);
+
+    if (QUEUE_EMPTY(&flow->requests)) {
+        QUEUE_REMOVE(&flow->entry);
+        chash_delete(&flows->tenants, req->fair.tenant, FLOWS_TABLE);
+    }
+    else if (was_head) {
+        _winecord_flows_position(flows, flow);
+    }
+}
+
+struct winecord_request *
+winecord_flows_peek(struct winecord_flows *flows)
+{
+    if (QUEUE_EMPTY(&flows->queue)) return NULL;
+    return _winecord_flow_peek(
+        QUEUE_DATA(QUEUE_HEAD(&flows->queue), struct _winecord_flow, entry));
+}
@@ -0,0 +1,310 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+
+#include "winecord.h"
+#include "winecord-internal.h"
+
+/** @brief Callback chained to a future with winecord_future_then() */
+struct _winecord_future_then {
+    /** the user callback, `NULL` if only forwarding outcome to `chained` */
+    winecord_future_cb cb;
+    /** user arbitrary data */
+    void *data;
+    /** the future that completes once `cb` is done */
+    struct winecord_future *chained;
+    /** next chained callback */
+    struct _winecord_future_then *next;
+};
+
+struct winecord_future {
+    /** the client that owns the request */
+    struct winecord *client;
+    /** amount of references held to this future */
+    int refs;
+    /** whether the request has been completed */
+    bool is_ready;
+    /** whether the chained callbacks have been executed */
+    bool is_dispatched;
+    /** the request's completion code */
+    WINEBERRYcode code;
+    /** the response datatype */
+    void *result;
+    /** whether `result` has been referenced at the client's refcounter */
+    bool owns_result;
+    /** callbacks to be executed at winecord_future_dispatch() */
+    struct _winecord_future_then *thens;
+};
+
+/* futures are rarely waited on by many threads at once, so a single lock is
+ *      shared by all of them, making it possible to wait on futures from
+ *      different requests (or clients) at winecord_future_wait_any() */
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_cond = PTHREAD_COND_INITIALIZER;
+
+/** completion code of a `NULL` future, left by a request that failed its
+ *      parameters validation before it could be started */
+#define WINECORD_FUTURE_NULL_CODE WINEBERRY_BAD_PARAMETER
+
+struct winecord_future *
+winecord_future_create(struct winecord *client)
+{
+    struct winecord_future *future = calloc(1, sizeof *future);
+
+    future->client = client;
+    future->refs = 2;
+    future->code = WINEBERRY_PENDING;
+
+    return future;
+}
+
+void
+winecord_future_complete(struct winecord_future *future,
+                         WINEBERRYcode code,
+                         void *result)
+{
+    pthread_mutex_lock(&g_lock);
+    if (!future->is_ready) {
+        future->code = code;
+        if (result) {
+            future->result = result;
+            future->owns_result =
+                (WINEBERRY_OK
+                 == winecord_refcounter_incr(&future->client->refcounter,
+                                            result));
+        }
+        future->is_ready = true;
+        pthread_cond_broadcast(&g_cond);
+    }
+    pthread_mutex_unlock(&g_lock);
+}
+
+static void _winecord_future_then_add(struct winecord_future *future,
+                                     struct _winecord_future_then *then);
+
+static void
+_winecord_future_run_then(struct winecord_future *future,
+                          struct _winecord_future_then *then)
+{
+    struct winecord_future *inner = NULL;
+
+    if (then->cb) inner = then->cb(future->client, future, then->data);
+
+    if (!inner) {
+        /* forward outcome of the original future */
+        winecord_future_complete(then->chained, future->code, future->result);
+        winecord_future_dispatch(then->chained);
+        free(then);
+    }
+    else {
+        /* forward outcome of the future returned by the callback, the
+         *      chained future's reference is handed over to the new node */
+        then->cb = NULL;
+        then->data = NULL;
+        then->next = NULL;
+        _winecord_future_then_add(inner, then);
+        winecord_future_release(inner);
+    }
+}
+
+static void
+_winecord_future_then_add(struct winecord_future *future,
+                          struct _winecord_future_then *then)
+{
+    bool is_dispatched;
+
+    pthread_mutex_lock(&g_lock);
+    is_dispatched = future->is_dispatched;
+    if (!is_dispatched) {
+        then->next = future->thens;
+        future->thens = then;
+    }
+    pthread_mutex_unlock(&g_lock);
+
+    if (is_dispatched) _winecord_future_run_then(future, then);
+}
+
+void
+winecord_future_dispatch(struct winecord_future *future)
+{
+    struct _winecord_future_then *then, *next;
+
+    pthread_mutex_lock(&g_lock);
+    then = future->thens;
+    future->thens = NULL;
+    future->is_dispatched = true;
+    pthread_mutex_unlock(&g_lock);
+
+    for (; then != NULL; then = next) {
+        next = then->next;
+        _winecord_future_run_then(future, then);
+    }
+    /* drop request's reference */
+    winecord_future_release(future);
+}
+
+struct winecord_future *
+winecord_future_then(struct winecord_future *future,
+                     winecord_future_cb callback,
+                     void *data)
+{
+    struct _winecord_future_then *then;
+    struct winecord_future *chained;
+
+    /* there's no client to execute the callback from */
+    if (!future) return NULL;
+
+    then = calloc(1, sizeof *then);
+    chained = winecord_future_create(future->client);
+    then->cb = callback;
+    then->data = data;
+    then->chained = chained;
+
+    _winecord_future_then_add(future, then);
+
+    return chained;
+}
+
+static void
+_winecord_future_deadline(struct timespec *ts, int64_t timeout_ms)
+{
+    clock_gettime(CLOCK_REALTIME, ts);
+    ts->tv_sec += (time_t)(timeout_ms / 1000);
+    ts->tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_nsec -= 1000000000L;
+        ++ts->tv_sec;
+    }
+}
+
+/* wait on global condition, return `false` if the deadline has been met */
+static bool
+_winecord_future_cond_wait(const struct timespec *deadline)
+{
+    if (!deadline) return 0 == pthread_cond_wait(&g_cond, &g_lock);
+    return ETIMEDOUT != pthread_cond_timedwait(&g_cond, &g_lock, deadline);
+}
+
+WINEBERRYcode
+winecord_future_wait(struct winecord_future *future, int64_t timeout_ms)
+{
+    return winecord_future_wait_all(&future, 1, timeout_ms);
+}
+
+WINEBERRYcode
+winecord_future_wait_all(struct winecord_future *futures[],
+                         int amount,
+                         int64_t timeout_ms)
+{
+    struct timespec ts, *deadline = NULL;
+    WINEBERRYcode code = WINEBERRY_OK;
+    int i = 0;
+
+    if (timeout_ms >= 0) _winecord_future_deadline(deadline = &ts, timeout_ms);
+
+    pthread_mutex_lock(&g_lock);
+    while (i < amount) {
+        if (!futures[i]) {
+            if (WINEBERRY_OK == code) code = WINECORD_FUTURE_NULL_CODE;
+            ++i;
+        }
+        else if (futures[i]->is_ready) {
+            if (WINEBERRY_OK == code) code = futures[i]->code;
+            ++i;
+        }
+        else if (!_winecord_future_cond_wait(deadline)) {
+            code = WINEBERRY_PENDING;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_lock);
+
+    return code;
+}
+
+int
+winecord_future_wait_any(struct winecord_future *futures[],
+                         int amount,
+                         int64_t timeout_ms)
+{
+    struct timespec ts, *deadline = NULL;
+    int index = -1;
+
+    if (timeout_ms >= 0) _winecord_future_deadline(deadline = &ts, timeout_ms);
+
+    pthread_mutex_lock(&g_lock);
+    while (1) {
+        for (int i = 0; i < amount; ++i) {
+            if (!futures[i] || futures[i]->is_ready) {
+                index = i;
+                break;
+            }
+        }
+        if (index != -1 || !_winecord_future_cond_wait(deadline)) break;
+    }
+    pthread_mutex_unlock(&g_lock);
+
+    return index;
+}
+
+bool
+winecord_future_is_ready(struct winecord_future *future)
+{
+    bool is_ready;
+
+    if (!future) return true;
+
+    pthread_mutex_lock(&g_lock);
+    is_ready = future->is_ready;
+    pthread_mutex_unlock(&g_lock);
+
+    return is_ready;
+}
+
+WINEBERRYcode
+winecord_future_get_code(struct winecord_future *future)
+{
+    WINEBERRYcode code;
+
+    if (!future) return WINECORD_FUTURE_NULL_CODE;
+
+    pthread_mutex_lock(&g_lock);
+    code = future->code;
+    pthread_mutex_unlock(&g_lock);
+
+    return code;
+}
+
+const void *
+winecord_future_get_result(struct winecord_future *future)
+{
+    void *result;
+
+    if (!future) return NULL;
+
+    pthread_mutex_lock(&g_lock);
+    result = future->is_ready ? future->result : NULL;
+    pthread_mutex_unlock(&g_lock);
+
+    return result;
+}
+
+void
+winecord_future_release(struct winecord_future *future)
+{
+    bool is_last;
+
+    if (!future) return;
+
+    pthread_mutex_lock(&g_lock);
+    is_last = (0 == --future->refs);
+    pthread_mutex_unlock(&g_lock);
+
+    if (!is_last) return;
+
+    if (future->owns_result)
+        winecord_refcounter_decr(&future->client->refcounter, future->result);
+    free(future);
+}
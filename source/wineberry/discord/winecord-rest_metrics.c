@@ -0,0 +1,437 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "winecord.h"
+#include "winecord-internal.h"
+#include "winecord-rest.h"
+
+/** upper bounds (in microseconds) of the latency histograms */
+static const int64_t g_bounds[WINECORD_HISTOGRAM_LEN] = {
+    1000,   5000,   10000,   25000,   50000,   100000,
+    250000, 500000, 1000000, 2500000, 5000000, 10000000,
+};
+
+#define LOAD(_field) __atomic_load_n(&(_field), __ATOMIC_RELAXED)
+
+void
+winecord_metrics_observe(struct winecord_histogram *hist, int64_t elapsed_us)
+{
+    int i = 0;
+
+    if (elapsed_us < 0) elapsed_us = 0;
+    while (i < WINECORD_HISTOGRAM_LEN && elapsed_us > g_bounds[i])
+        ++i;
+
+    __atomic_fetch_add(&hist->counts[i], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&hist->sum, (uint64_t)elapsed_us, __ATOMIC_RELAXED);
+}
+
+int64_t
+winecord_metrics_quantile(const struct winecord_histogram *hist,
+                          double q,
+                          uint64_t min_count)
+{
+    uint64_t total = 0, rank, seen = 0;
+
+    for (int i = 0; i <= WINECORD_HISTOGRAM_LEN; ++i)
+        total += LOAD(hist->counts[i]);
+    if (!total || total < min_count) return -1;
+
+    rank = (uint64_t)(q * (double)total);
+    if (rank >= total) rank = total - 1;
+    for (int i = 0; i < WINECORD_HISTOGRAM_LEN; ++i) {
+        seen += LOAD(hist->counts[i]);
+        if (seen > rank) return g_bounds[i];
+    }
+    /* the quantile lies past every bound */
+    return -1;
+}
+
+/** @brief A route collected for being written */
+struct _winecord_metrics_route {
+    /** `route="<key>",bucket="<hash>"` */
+    char labels[WINECORD_ROUTE_LEN + 96];
+    /** the route's bucket @note buckets are only freed at cleanup */
+    const struct winecord_bucket *b;
+};
+
+/** @brief Routes collected from every `REST` thread */
+struct _winecord_metrics_routes {
+    struct _winecord_metrics_route *array;
+    int size;
+    int realsize;
+};
+
+static void
+_winecord_metrics_collect(void *p_routes,
+                          const char key[],
+                          const char hash[],
+                          struct winecord_bucket *b)
+{
+    struct _winecord_metrics_routes *routes = p_routes;
+    struct _winecord_metrics_route *route;
+
+    if (routes->size == routes->realsize) {
+        int realsize = routes->realsize ? routes->realsize * 2 : 64;
+        void *tmp =
+            realloc(routes->array, (size_t)realsize * sizeof *routes->array);
+        ASSERT_S(tmp != NULL, "Out of memory");
+
+        routes->array = tmp;
+        routes->realsize = realsize;
+    }
+    route = routes->array + routes->size++;
+    snprintf(route->labels, sizeof(route->labels),
+             "route=\"%s\",bucket=\"%s\"", key, hash);
+    route->b = b;
+}
+
+static int
+_winecord_metrics_route_cmp(const void *p_a, const void *p_b)
+{
+    const struct _winecord_metrics_route *a = p_a, *b = p_b;
+
+    if (a->b == b->b) return strcmp(a->labels, b->labels);
+    return (uintptr_t)a->b < (uintptr_t)b->b ? -1 : 1;
+}
+
+/* metrics are counted per bucket, so a bucket shared by many routes is
+ *      only written once (under its first route's labels), rather than
+ *      having its samples summed once per route */
+static void
+_winecord_metrics_dedup(struct _winecord_metrics_routes *routes)
+{
+    int size = 0;
+
+    qsort(routes->array, (size_t)routes->size, sizeof *routes->array,
+          &_winecord_metrics_route_cmp);
+    for (int i = 0; i < routes->size; ++i)
+        if (!size || routes->array[size - 1].b != routes->array[i].b)
+            routes->array[size++] = routes->array[i];
+    routes->size = size;
+}
+
+/* every sample of a metric family must be written together, so each
+ *      family iterates over the collected routes */
+static void
+_winecord_metrics_write_histogram(FILE *fp,
+                                  const struct _winecord_metrics_routes *routes,
+                                  const char name[],
+                                  const char help[],
+                                  size_t offset)
+{
+    fprintf(fp, "# HELP %s %s\n# TYPE %s histogram\n", name, help, name);
+    for (int i = 0; i < routes->size; ++i) {
+        const struct _winecord_metrics_route *route = routes->array + i;
+        const struct winecord_histogram *hist =
+            (const void *)((const char *)&route->b->metrics + offset);
+        uint64_t count = 0;
+
+        for (int j = 0; j < WINECORD_HISTOGRAM_LEN; ++j) {
+            count += LOAD(hist->counts[j]);
+            fprintf(fp, "%s_bucket{%s,le=\"%g\"} %" PRIu64 "\n", name,
+                    route->labels, (double)g_bounds[j] / 1e6, count);
+        }
+        count += LOAD(hist->counts[WINECORD_HISTOGRAM_LEN]);
+        fprintf(fp, "%s_bucket{%s,le=\"+Inf\"} %" PRIu64 "\n", name,
+                route->labels, count);
+        fprintf(fp, "%s_sum{%s} %g\n", name, route->labels,
+                (double)LOAD(hist->sum) / 1e6);
+        fprintf(fp, "%s_count{%s} %" PRIu64 "\n", name, route->labels,
+                count);
+    }
+}
+
+void
+winecord_metrics_write(struct winecord_rest *rest, FILE *fp)
+{
+    struct _winecord_metrics_routes routes = { 0 };
+    const struct _winecord_metrics_route *route;
+    struct winecord_connection_stats conns;
+    int i;
+
+    for (i = 0; i < rest->n_shards; ++i)
+        winecord_ratelimiter_foreach(&rest->shards[i].requestor.ratelimiter,
+                                    &_winecord_metrics_collect, &routes);
+    _winecord_metrics_dedup(&routes);
+
+    fputs("# HELP winecord_rest_requests_total Completed requests\n"
+          "# TYPE winecord_rest_requests_total counter\n",
+          fp);
+    for (i = 0, route = routes.array; i < routes.size; ++i, ++route)
+        fprintf(fp, "winecord_rest_requests_total{%s} %" PRIu64 "\n",
+                route->labels, LOAD(route->b->metrics.requests));
+
+    fputs("# HELP winecord_rest_retries_total Retried requests\n"
+          "# TYPE winecord_rest_retries_total counter\n",
+          fp);
+    for (i = 0, route = routes.array; i < routes.size; ++i, ++route)
+        fprintf(fp, "winecord_rest_retries_total{%s} %" PRIu64 "\n",
+                route->labels, LOAD(route->b->metrics.retries));
+
+    fputs("# HELP winecord_rest_hedges_total Duplicated slow GET requests\n"
+          "# TYPE winecord_rest_hedges_total counter\n",
+          fp);
+    for (i = 0, route = routes.array; i < routes.size; ++i, ++route)
+        fprintf(fp, "winecord_rest_hedges_total{%s} %" PRIu64 "\n",
+                route->labels, LOAD(route->b->metrics.hedges));
+
+    fputs("# HELP winecord_rest_ratelimited_total 429 responses by scope\n"
+          "# TYPE winecord_rest_ratelimited_total counter\n",
+          fp);
+    for (i = 0, route = routes.array; i < routes.size; ++i, ++route)
+        fprintf(fp,
+                "winecord_rest_ratelimited_total{%s,scope=\"global\"} "
+                "%" PRIu64 "\n"
+                "winecord_rest_ratelimited_total{%s,scope=\"bucket\"} "
+                "%" PRIu64 "\n"
+                "winecord_rest_ratelimited_total{%s,scope=\"shared\"} "
+                "%" PRIu64 "\n",
+                route->labels, LOAD(route->b->metrics.ratelimited.global),
+                route->labels, LOAD(route->b->metrics.ratelimited.bucket),
+                route->labels, LOAD(route->b->metrics.ratelimited.shared));
+
+    _winecord_metrics_write_histogram(
+        fp, &routes, "winecord_rest_queue_wait_seconds",
+        "Time waited before being assigned to the bucket",
+        offsetof(struct winecord_metrics, queue_wait));
+    _winecord_metrics_write_histogram(
+        fp, &routes, "winecord_rest_ratelimit_wait_seconds",
+        "Time waited at the bucket before being sent",
+        offsetof(struct winecord_metrics, ratelimit_wait));
+    _winecord_metrics_write_histogram(
+        fp, &routes, "winecord_rest_http_seconds",
+        "Time taken by the HTTP transfer",
+        offsetof(struct winecord_metrics, http));
+
+    fputs("# HELP winecord_rest_bucket_limit Requests per ratelimit window\n"
+          "# TYPE winecord_rest_bucket_limit gauge\n",
+          fp);
+    for (i = 0, route = routes.array; i < routes.size; ++i, ++route)
+        fprintf(fp, "winecord_rest_bucket_limit{%s} %ld\n", route->labels,
+                LOAD(route->b->limit));
+
+    fputs("# HELP winecord_rest_bucket_remaining Requests left until reset\n"
+          "# TYPE winecord_rest_bucket_remaining gauge\n",
+          fp);
+    for (i = 0, route = routes.array; i < routes.size; ++i, ++route)
+        fprintf(fp, "winecord_rest_bucket_remaining{%s} %ld\n",
+                route->labels, LOAD(route->b->remaining));
+
+    fputs("# HELP winecord_rest_bucket_reset_timestamp_seconds When the "
+          "ratelimit resets\n"
+          "# TYPE winecord_rest_bucket_reset_timestamp_seconds gauge\n",
+          fp);
+    for (i = 0, route = routes.array; i < routes.size; ++i, ++route)
+        fprintf(fp, "winecord_rest_bucket_reset_timestamp_seconds{%s} %.3f\n",
+                route->labels, (double)LOAD(route->b->reset_tstamp) / 1000);
+
+    fprintf(fp,
+            "# HELP winecord_rest_inflight_limit Adaptive limit of in-flight "
+            "transfers\n"
+            "# TYPE winecord_rest_inflight_limit gauge\n"
+            "winecord_rest_inflight_limit %d\n",
+            winecord_rest_get_inflight_limit(CLIENT(rest, rest)));
+
+    winecord_rest_get_connection_stats(CLIENT(rest, rest), &conns);
+    fprintf(fp,
+            "# HELP winecord_rest_transfers_total Requests transferred\n"
+            "# TYPE winecord_rest_transfers_total counter\n"
+            "winecord_rest_transfers_total %" PRIu64 "\n"
+            "# HELP winecord_rest_connection_reuses_total Requests that "
+            "reused an open connection\n"
+            "# TYPE winecord_rest_connection_reuses_total counter\n"
+            "winecord_rest_connection_reuses_total %" PRIu64 "\n"
+            "# HELP winecord_rest_handshakes_total Connections opened\n"
+            "# TYPE winecord_rest_handshakes_total counter\n"
+            "winecord_rest_handshakes_total{origin=\"request\"} %" PRIu64
+            "\n"
+            "winecord_rest_handshakes_total{origin=\"warmup\"} %" PRIu64
+            "\n",
+            conns.transfers, conns.reused, conns.handshakes,
+            conns.warm_handshakes);
+
+    free(routes.array);
+}
+
+WINEBERRYcode
+winecord_rest_metrics_export(struct winecord *client, const char path[])
+{
+    char tmp_path[4096];
+    FILE *fp;
+    int len;
+
+    if (!path || !*path) return WINEBERRY_BAD_PARAMETER;
+
+    len = snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    if (len < 0 || (size_t)len >= sizeof(tmp_path))
+        return WINEBERRY_BAD_PARAMETER;
+
+    if (!(fp = fopen(tmp_path, "w"))) {
+        logconf_error(&client->rest.conf, "Couldn't export metrics to '%s'",
+                      tmp_path);
+        return WINEBERRY_RESOURCE_UNAVAILABLE;
+    }
+    winecord_metrics_write(&client->rest, fp);
+    fclose(fp);
+
+    if (rename(tmp_path, path)) {
+        logconf_error(&client->rest.conf, "Couldn't export metrics to '%s'",
+                      path);
+        remove(tmp_path);
+        return WINEBERRY_RESOURCE_UNAVAILABLE;
+    }
+    return WINEBERRY_OK;
+}
+
+/** @brief Metrics being sent to a connection */
+struct _winecord_metrics_scrape {
+    /** the connection's socket */
+    int fd;
+    /** the metrics, written at once when the connection is accepted */
+    char *buf;
+    /** length of `buf` */
+    size_t len;
+    /** amount of `buf` sent so far */
+    size_t sent;
+    /** entry for @ref winecord_rest metrics scrapes queue */
+    QUEUE entry;
+};
+
+static void
+_winecord_metrics_scrape_close(struct io_poller *io,
+                               struct _winecord_metrics_scrape *scrape)
+{
+    io_poller_socket_del(io, scrape->fd);
+    close(scrape->fd);
+    QUEUE_REMOVE(&scrape->entry);
+    free(scrape->buf);
+    free(scrape);
+}
+
+/* send as much of the metrics as the connection takes without blocking,
+ *      and close it once they've been sent or it fails */
+static void
+_winecord_metrics_on_writable(struct io_poller *io,
+                              enum io_poller_events events,
+                              void *p_scrape)
+{
+    struct _winecord_metrics_scrape *scrape = p_scrape;
+    ssize_t ret;
+    (void)events;
+
+    while (scrape->sent < scrape->len) {
+        /* a peer that hung up mustn't raise SIGPIPE */
+        ret = send(scrape->fd, scrape->buf + scrape->sent,
+                   scrape->len - scrape->sent, MSG_NOSIGNAL);
+        if (ret > 0)
+            scrape->sent += (size_t)ret;
+        else if (EINTR != errno) {
+            /* resumed once the connection is writable again */
+            if (EAGAIN == errno || EWOULDBLOCK == errno) return;
+            break;
+        }
+    }
+    _winecord_metrics_scrape_close(io, scrape);
+}
+
+/* write the metrics for every pending connection, and send them without
+ *      blocking the main thread on a slow reader */
+static void
+_winecord_metrics_on_accept(struct io_poller *io,
+                            enum io_poller_events events,
+                            void *p_rest)
+{
+    struct winecord_rest *rest = p_rest;
+    struct _winecord_metrics_scrape *scrape;
+    FILE *fp;
+    int fd;
+    (void)events;
+
+    while (-1 != (fd = accept(rest->metrics_fd, NULL, NULL))) {
+        if (-1 == fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK)) {
+            close(fd);
+            continue;
+        }
+
+        scrape = calloc(1, sizeof *scrape);
+        scrape->fd = fd;
+        if (!(fp = open_memstream(&scrape->buf, &scrape->len))) {
+            close(fd);
+            free(scrape);
+            continue;
+        }
+        winecord_metrics_write(rest, fp);
+        fclose(fp);
+
+        QUEUE_INSERT_TAIL(&rest->metrics_scrapes, &scrape->entry);
+        io_poller_socket_add(io, fd, IO_POLLER_OUT,
+                             &_winecord_metrics_on_writable, scrape);
+    }
+}
+
+WINEBERRYcode
+winecord_rest_metrics_serve(struct winecord *client, const char path[])
+{
+    struct winecord_rest *rest = &client->rest;
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    int fd;
+
+    if (!path || !*path || strlen(path) >= sizeof(addr.sun_path))
+        return WINEBERRY_BAD_PARAMETER;
+
+    /* stop serving from the previous socket */
+    winecord_metrics_cleanup(rest);
+
+    memcpy(addr.sun_path, path, strlen(path) + 1);
+    if (-1 == (fd = socket(AF_UNIX, SOCK_STREAM, 0)))
+        return WINEBERRY_RESOURCE_UNAVAILABLE;
+
+    unlink(path);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) || listen(fd, 8)
+        || -1 == fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK))
+    {
+        logconf_error(&rest->conf, "Couldn't serve metrics from '%s': %s",
+                      path, strerror(errno));
+        close(fd);
+        return WINEBERRY_RESOURCE_UNAVAILABLE;
+    }
+
+    rest->metrics_fd = fd;
+    rest->metrics_path = strdup(path);
+    io_poller_socket_add(client->io_poller, fd, IO_POLLER_IN,
+                         &_winecord_metrics_on_accept, rest);
+
+    logconf_info(&rest->conf, "Serving metrics from '%s'", path);
+
+    return WINEBERRY_OK;
+}
+
+void
+winecord_metrics_cleanup(struct winecord_rest *rest)
+{
+    struct io_poller *io = CLIENT(rest, rest)->io_poller;
+
+    /* drop the connections whose metrics haven't been sent yet */
+    while (!QUEUE_EMPTY(&rest->metrics_scrapes))
+        _winecord_metrics_scrape_close(
+            io, QUEUE_DATA(QUEUE_HEAD(&rest->metrics_scrapes),
+                           struct _winecord_metrics_scrape, entry));
+
+    if (-1 == rest->metrics_fd) return;
+
+    io_poller_socket_del(io, rest->metrics_fd);
+    close(rest->metrics_fd);
+    rest->metrics_fd = -1;
+
+    unlink(rest->metrics_path);
+    free(rest->metrics_path);
+    rest->metrics_path = NULL;
+}
@@ -0,0 +1,583 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "winecord.h"
+#include "winecord-internal.h"
+
+/** @brief Listings that can be walked through by a paginator */
+enum _winecord_listing {
+    WINECORD_LISTING_MESSAGES,
+    WINECORD_LISTING_GUILD_MEMBERS,
+    WINECORD_LISTING_REACTIONS,
+    WINECORD_LISTING_AUDIT_LOG,
+    WINECORD_LISTING_PUBLIC_ARCHIVED_THREADS,
+    WINECORD_LISTING_PRIVATE_ARCHIVED_THREADS,
+    WINECORD_LISTING_JOINED_PRIVATE_ARCHIVED_THREADS,
+};
+
+/* helper typedef for casting paginator callbacks */
+typedef bool (*cast_paginate)(struct winecord *, void *, const void *);
+
+/* max amount of elements per page accepted by each listing's route, `0` for
+ *      routes that don't document one */
+static const int g_max_page_size[] = {
+    [WINECORD_LISTING_MESSAGES] = 100,
+    [WINECORD_LISTING_GUILD_MEMBERS] = 1000,
+    [WINECORD_LISTING_REACTIONS] = 100,
+    [WINECORD_LISTING_AUDIT_LOG] = 100,
+    [WINECORD_LISTING_PUBLIC_ARCHIVED_THREADS] = 0,
+    [WINECORD_LISTING_PRIVATE_ARCHIVED_THREADS] = 0,
+    [WINECORD_LISTING_JOINED_PRIVATE_ARCHIVED_THREADS] = 0,
+};
+
+struct _winecord_paginator {
+    /** the client that owns the paginator */
+    struct winecord *client;
+    /** the listing being walked through */
+    enum _winecord_listing listing;
+    /** the channel or guild that the listing belongs to */
+    u64snowflake parent_id;
+    /** the reacted message (reactions only) */
+    u64snowflake message_id;
+    /** the reacted emoji id (reactions only) */
+    u64snowflake emoji_id;
+    /** the reacted emoji name (reactions only) */
+    char *emoji_name;
+    /** the audit log filters (audit log only) */
+    struct winecord_get_guild_audit_log audit_log;
+    /** where the next page starts from */
+    u64snowflake cursor;
+    /** the page size requested for the page in-flight */
+    int limit;
+    /** amount of elements per page, `0` for the route's default */
+    int page_size;
+    /** elements left to be walked through, `-1` for all */
+    int remaining;
+    /** whether the next page has been requested */
+    bool has_next;
+    /** whether pagination has been stopped by the user or a failure */
+    bool is_stopped;
+    /** pagination completion code */
+    WINEBERRYcode code;
+    /** user arbitrary data */
+    void *data;
+    /** user cleanup method for `data` */
+    void (*cleanup)(struct winecord *client, void *data);
+    /** user page callback */
+    cast_paginate page;
+    /** user element callback */
+    cast_paginate item;
+    /** user completion callback */
+    void (*done)(struct winecord *client, void *data, WINEBERRYcode code);
+};
+
+#define _PAGINATOR_COPY(dest, src)                                            \
+    do {                                                                      \
+        (dest)->data = (src)->data;                                           \
+        (dest)->cleanup = (src)->cleanup;                                     \
+        (dest)->remaining = (src)->limit > 0 ? (src)->limit : -1;             \
+        (dest)->page_size = (src)->page_size;                                 \
+        (dest)->page = (cast_paginate)(src)->page;                            \
+        (dest)->item = (cast_paginate)(src)->item;                            \
+        (dest)->done = (src)->done;                                           \
+    } while (0)
+
+static struct _winecord_paginator *
+_winecord_paginator_init(struct winecord *client,
+                         enum _winecord_listing listing,
+                         u64snowflake parent_id,
+                         u64snowflake cursor)
+{
+    struct _winecord_paginator *p = calloc(1, sizeof *p);
+
+    p->client = client;
+    p->listing = listing;
+    p->parent_id = parent_id;
+    p->cursor = cursor;
+    p->code = WINEBERRY_OK;
+
+    return p;
+}
+
+/* executed once the last request referencing the paginator is done with it */
+static void
+_winecord_paginator_cleanup(struct winecord *client, void *data)
+{
+    struct _winecord_paginator *p = data;
+
+    if (p->cleanup) p->cleanup(client, p->data);
+    if (p->emoji_name) free(p->emoji_name);
+    free(p);
+}
+
+static void
+_winecord_paginator_fail(struct winecord *client,
+                         struct winecord_response *resp)
+{
+    struct _winecord_paginator *p = resp->data;
+
+    if (!p->is_stopped) p->code = resp->code;
+    p->is_stopped = true;
+    if (p->done) p->done(client, p->data, p->code);
+}
+
+static void _winecord_paginator_on_messages(
+    struct winecord *client,
+    struct winecord_response *resp,
+    const struct winecord_messages *ret);
+static void _winecord_paginator_on_guild_members(
+    struct winecord *client,
+    struct winecord_response *resp,
+    const struct winecord_guild_members *ret);
+static void _winecord_paginator_on_users(struct winecord *client,
+                                         struct winecord_response *resp,
+                                         const struct winecord_users *ret);
+static void _winecord_paginator_on_audit_log(
+    struct winecord *client,
+    struct winecord_response *resp,
+    const struct winecord_audit_log *ret);
+static void _winecord_paginator_on_threads(
+    struct winecord *client,
+    struct winecord_response *resp,
+    const struct winecord_thread_response_body *ret);
+
+/* get the executor of a paginator's pages, the next page is requested
+ *      before the current page's callbacks are executed, so these must not
+ *      be executed concurrently by the worker threadpool */
+static enum winecord_executor
+_winecord_paginator_get_executor(struct winecord *client)
+{
+    if (WINECORD_EXECUTOR_WORKER
+        == __atomic_load_n(&client->rest.executor, __ATOMIC_RELAXED))
+        return WINECORD_EXECUTOR_LANES;
+    return WINECORD_EXECUTOR_DEFAULT;
+}
+
+/* request the page that starts at the paginator's current cursor */
+static WINEBERRYcode
+_winecord_paginator_fetch(struct _winecord_paginator *p)
+{
+    struct winecord *client = p->client;
+    const enum winecord_executor executor =
+        _winecord_paginator_get_executor(client);
+    int limit = p->page_size;
+
+    if (p->remaining >= 0 && (!limit || p->remaining < limit))
+        limit = p->remaining;
+    p->limit = limit;
+
+    switch (p->listing) {
+    case WINECORD_LISTING_MESSAGES:
+        return winecord_get_channel_messages(
+            client, p->parent_id,
+            &(struct winecord_get_channel_messages){
+                .before = p->cursor,
+                .limit = limit,
+            },
+            &(struct winecord_ret_messages){
+                .data = p,
+                .cleanup = &_winecord_paginator_cleanup,
+                .executor = executor,
+                .lane = p->parent_id,
+                .done = &_winecord_paginator_on_messages,
+                .fail = &_winecord_paginator_fail,
+            });
+    case WINECORD_LISTING_GUILD_MEMBERS:
+        return winecord_list_guild_members(
+            client, p->parent_id,
+            &(struct winecord_list_guild_members){
+                .after = p->cursor,
+                .limit = limit,
+            },
+            &(struct winecord_ret_guild_members){
+                .data = p,
+                .cleanup = &_winecord_paginator_cleanup,
+                .executor = executor,
+                .lane = p->parent_id,
+                .done = &_winecord_paginator_on_guild_members,
+                .fail = &_winecord_paginator_fail,
+            });
+    case WINECORD_LISTING_REACTIONS:
+        return winecord_get_reactions(
+            client, p->parent_id, p->message_id, p->emoji_id, p->emoji_name,
+            &(struct winecord_get_reactions){
+                .after = p->cursor,
+                .limit = limit,
+            },
+            &(struct winecord_ret_users){
+                .data = p,
+                .cleanup = &_winecord_paginator_cleanup,
+                .executor = executor,
+                .lane = p->parent_id,
+                .done = &_winecord_paginator_on_users,
+                .fail = &_winecord_paginator_fail,
+            });
+    case WINECORD_LISTING_AUDIT_LOG:
+        p->audit_log.before = p->cursor;
+        p->audit_log.limit = limit;
+        return winecord_get_guild_audit_log(
+            client, p->parent_id, &p->audit_log,
+            &(struct winecord_ret_audit_log){
+                .data = p,
+                .cleanup = &_winecord_paginator_cleanup,
+                .executor = executor,
+                .lane = p->parent_id,
+                .done = &_winecord_paginator_on_audit_log,
+                .fail = &_winecord_paginator_fail,
+            });
+    case WINECORD_LISTING_PUBLIC_ARCHIVED_THREADS:
+        return winecord_list_public_archived_threads(
+            client, p->parent_id, p->cursor, limit,
+            &(struct winecord_ret_thread_response_body){
+                .data = p,
+                .cleanup = &_winecord_paginator_cleanup,
+                .executor = executor,
+                .lane = p->parent_id,
+                .done = &_winecord_paginator_on_threads,
+                .fail = &_winecord_paginator_fail,
+            });
+    case WINECORD_LISTING_PRIVATE_ARCHIVED_THREADS:
+        return winecord_list_private_archived_threads(
+            client, p->parent_id, p->cursor, limit,
+            &(struct winecord_ret_thread_response_body){
+                .data = p,
+                .cleanup = &_winecord_paginator_cleanup,
+                .executor = executor,
+                .lane = p->parent_id,
+                .done = &_winecord_paginator_on_threads,
+                .fail = &_winecord_paginator_fail,
+            });
+    case WINECORD_LISTING_JOINED_PRIVATE_ARCHIVED_THREADS:
+        return winecord_list_joined_private_archived_threads(
+            client, p->parent_id, p->cursor, limit,
+            &(struct winecord_ret_thread_response_body){
+                .data = p,
+                .cleanup = &_winecord_paginator_cleanup,
+                .executor = executor,
+                .lane = p->parent_id,
+                .done = &_winecord_paginator_on_threads,
+                .fail = &_winecord_paginator_fail,
+            });
+    default:
+        return WINEBERRY_BAD_PARAMETER;
+    }
+}
+
+/**
+ * Account for a received page, and request the next one right away so that
+ *      it is fetched while the current page's callbacks are being executed
+ * @return `false` if the page should be skipped
+ */
+static bool
+_winecord_paginator_advance(struct _winecord_paginator *p,
+                            int amount,
+                            bool has_more)
+{
+    WINEBERRYcode code;
+
+    /* pagination has been stopped while this page was in-flight */
+    if (p->is_stopped) {
+        if (p->done) p->done(p->client, p->data, p->code);
+        return false;
+    }
+
+    if (p->remaining > 0) {
+        p->remaining = amount < p->remaining ? p->remaining - amount : 0;
+    }
+    p->has_next = (has_more && amount > 0 && p->remaining != 0);
+    if (p->has_next) {
+        code = _winecord_paginator_fetch(p);
+        if (code != WINEBERRY_PENDING) {
+            p->code = code;
+            p->has_next = false;
+        }
+    }
+    return true;
+}
+
+static bool
+_winecord_paginator_run_page(struct _winecord_paginator *p, const void *page)
+{
+    if (!p->is_stopped && p->page && !p->page(p->client, p->data, page))
+        p->is_stopped = true;
+    return !p->is_stopped;
+}
+
+static bool
+_winecord_paginator_run_item(struct _winecord_paginator *p, const void *item)
+{
+    if (!p->is_stopped && p->item && !p->item(p->client, p->data, item))
+        p->is_stopped = true;
+    return !p->is_stopped;
+}
+
+/* once the callbacks are done, check if this has been the last page */
+static void
+_winecord_paginator_done(struct _winecord_paginator *p)
+{
+    /* the next page in-flight will complete the pagination */
+    if (p->has_next) return;
+
+    p->is_stopped = true;
+    if (p->done) p->done(p->client, p->data, p->code);
+}
+
+static void
+_winecord_paginator_on_messages(struct winecord *client,
+                                struct winecord_response *resp,
+                                const struct winecord_messages *ret)
+{
+    struct _winecord_paginator *p = resp->data;
+    (void)client;
+
+    if (ret->size) p->cursor = ret->array[ret->size - 1].id;
+    if (!_winecord_paginator_advance(p, ret->size, ret->size == p->limit))
+        return;
+
+    if (_winecord_paginator_run_page(p, ret))
+        for (int i = 0; i < ret->size; ++i)
+            if (!_winecord_paginator_run_item(p, ret->array + i)) break;
+
+    _winecord_paginator_done(p);
+}
+
+static void
+_winecord_paginator_on_guild_members(struct winecord *client,
+                                     struct winecord_response *resp,
+                                     const struct winecord_guild_members *ret)
+{
+    struct _winecord_paginator *p = resp->data;
+    (void)client;
+
+    if (ret->size && ret->array[ret->size - 1].user)
+        p->cursor = ret->array[ret->size - 1].user->id;
+    if (!_winecord_paginator_advance(p, ret->size, ret->size == p->limit))
+        return;
+
+    if (_winecord_paginator_run_page(p, ret))
+        for (int i = 0; i < ret->size; ++i)
+            if (!_winecord_paginator_run_item(p, ret->array + i)) break;
+
+    _winecord_paginator_done(p);
+}
+
+static void
+_winecord_paginator_on_users(struct winecord *client,
+                             struct winecord_response *resp,
+                             const struct winecord_users *ret)
+{
+    struct _winecord_paginator *p = resp->data;
+    (void)client;
+
+    if (ret->size) p->cursor = ret->array[ret->size - 1].id;
+    if (!_winecord_paginator_advance(p, ret->size, ret->size == p->limit))
+        return;
+
+    if (_winecord_paginator_run_page(p, ret))
+        for (int i = 0; i < ret->size; ++i)
+            if (!_winecord_paginator_run_item(p, ret->array + i)) break;
+
+    _winecord_paginator_done(p);
+}
+
+static void
+_winecord_paginator_on_audit_log(struct winecord *client,
+                                 struct winecord_response *resp,
+                                 const struct winecord_audit_log *ret)
+{
+    struct _winecord_paginator *p = resp->data;
+    int size = (int)ret->entries_size;
+    (void)client;
+
+    if (size) p->cursor = ret->entries[size - 1]->id;
+    if (!_winecord_paginator_advance(p, size, size == p->limit)) return;
+
+    if (_winecord_paginator_run_page(p, ret))
+        for (int i = 0; i < size; ++i)
+            if (!_winecord_paginator_run_item(p, ret->entries[i])) break;
+
+    _winecord_paginator_done(p);
+}
+
+static void
+_winecord_paginator_on_threads(struct winecord *client,
+                               struct winecord_response *resp,
+                               const struct winecord_thread_response_body *ret)
+{
+    struct _winecord_paginator *p = resp->data;
+    int size = ret->threads ? ret->threads->size : 0;
+    (void)client;
+
+    /* archived threads are ordered by their archive timestamp */
+    if (size && ret->threads->array[size - 1].thread_metadata)
+        p->cursor =
+            ret->threads->array[size - 1].thread_metadata->archive_timestamp;
+    if (!_winecord_paginator_advance(p, size, ret->has_more)) return;
+
+    if (_winecord_paginator_run_page(p, ret))
+        for (int i = 0; i < size; ++i)
+            if (!_winecord_paginator_run_item(p, ret->threads->array + i))
+                break;
+
+    _winecord_paginator_done(p);
+}
+
+/* request the first page, the paginator is owned by the requests from then
+ *      on and free'd by the client's refcounter */
+static WINEBERRYcode
+_winecord_paginator_start(struct _winecord_paginator *p)
+{
+    WINEBERRYcode code;
+
+    const int max = g_max_page_size[p->listing];
+
+    if (max && (!p->page_size || p->page_size > max)) p->page_size = max;
+
+    code = _winecord_paginator_fetch(p);
+    if (code != WINEBERRY_PENDING) {
+        if (p->done) p->done(p->client, p->data, code);
+        _winecord_paginator_cleanup(p->client, p);
+    }
+    return code;
+}
+
+WINEBERRYcode
+winecord_paginate_channel_messages(struct winecord *client,
+                                   u64snowflake channel_id,
+                                   u64snowflake before,
+                                   struct winecord_paginate_messages *attr)
+{
+    struct _winecord_paginator *p;
+
+    WINEBERRY_EXPECT(client, channel_id != 0, WINEBERRY_BAD_PARAMETER, "");
+    WINEBERRY_EXPECT(client, attr != NULL, WINEBERRY_BAD_PARAMETER, "");
+
+    p = _winecord_paginator_init(client, WINECORD_LISTING_MESSAGES,
+                                 channel_id, before);
+    _PAGINATOR_COPY(p, attr);
+
+    return _winecord_paginator_start(p);
+}
+
+WINEBERRYcode
+winecord_paginate_guild_members(struct winecord *client,
+                                u64snowflake guild_id,
+                                u64snowflake after,
+                                struct winecord_paginate_guild_members *attr)
+{
+    struct _winecord_paginator *p;
+
+    WINEBERRY_EXPECT(client, guild_id != 0, WINEBERRY_BAD_PARAMETER, "");
+    WINEBERRY_EXPECT(client, attr != NULL, WINEBERRY_BAD_PARAMETER, "");
+
+    p = _winecord_paginator_init(client, WINECORD_LISTING_GUILD_MEMBERS,
+                                 guild_id, after);
+    _PAGINATOR_COPY(p, attr);
+
+    return _winecord_paginator_start(p);
+}
+
+WINEBERRYcode
+winecord_paginate_reactions(struct winecord *client,
+                            u64snowflake channel_id,
+                            u64snowflake message_id,
+                            u64snowflake emoji_id,
+                            const char emoji_name[],
+                            u64snowflake after,
+                            struct winecord_paginate_users *attr)
+{
+    struct _winecord_paginator *p;
+
+    WINEBERRY_EXPECT(client, channel_id != 0, WINEBERRY_BAD_PARAMETER, "");
+    WINEBERRY_EXPECT(client, message_id != 0, WINEBERRY_BAD_PARAMETER, "");
+    WINEBERRY_EXPECT(client, attr != NULL, WINEBERRY_BAD_PARAMETER, "");
+
+    p = _winecord_paginator_init(client, WINECORD_LISTING_REACTIONS,
+                                 channel_id, after);
+    p->message_id = message_id;
+    p->emoji_id = emoji_id;
+    if (emoji_name) p->emoji_name = strdup(emoji_name);
+    _PAGINATOR_COPY(p, attr);
+
+    return _winecord_paginator_start(p);
+}
+
+WINEBERRYcode
+winecord_paginate_guild_audit_log(struct winecord *client,
+                                  u64snowflake guild_id,
+                                  struct winecord_get_guild_audit_log *params,
+                                  struct winecord_paginate_audit_log *attr)
+{
+    struct _winecord_paginator *p;
+
+    WINEBERRY_EXPECT(client, guild_id != 0, WINEBERRY_BAD_PARAMETER, "");
+    WINEBERRY_EXPECT(client, attr != NULL, WINEBERRY_BAD_PARAMETER, "");
+
+    p = _winecord_paginator_init(client, WINECORD_LISTING_AUDIT_LOG, guild_id,
+                                 params ? params->before : 0);
+    if (params) p->audit_log = *params;
+    _PAGINATOR_COPY(p, attr);
+
+    return _winecord_paginator_start(p);
+}
+
+WINEBERRYcode
+winecord_paginate_public_archived_threads(
+    struct winecord *client,
+    u64snowflake channel_id,
+    u64unix_ms before,
+    struct winecord_paginate_thread_response_body *attr)
+{
+    struct _winecord_paginator *p;
+
+    WINEBERRY_EXPECT(client, channel_id != 0, WINEBERRY_BAD_PARAMETER, "");
+    WINEBERRY_EXPECT(client, attr != NULL, WINEBERRY_BAD_PARAMETER, "");
+
+    p = _winecord_paginator_init(client,
+                                 WINECORD_LISTING_PUBLIC_ARCHIVED_THREADS,
+                                 channel_id, before);
+    _PAGINATOR_COPY(p, attr);
+
+    return _winecord_paginator_start(p);
+}
+
+WINEBERRYcode
+winecord_paginate_private_archived_threads(
+    struct winecord *client,
+    u64snowflake channel_id,
+    u64unix_ms before,
+    struct winecord_paginate_thread_response_body *attr)
+{
+    struct _winecord_paginator *p;
+
+    WINEBERRY_EXPECT(client, channel_id != 0, WINEBERRY_BAD_PARAMETER, "");
+    WINEBERRY_EXPECT(client, attr != NULL, WINEBERRY_BAD_PARAMETER, "");
+
+    p = _winecord_paginator_init(client,
+                                 WINECORD_LISTING_PRIVATE_ARCHIVED_THREADS,
+                                 channel_id, before);
+    _PAGINATOR_COPY(p, attr);
+
+    return _winecord_paginator_start(p);
+}
+
+WINEBERRYcode
+winecord_paginate_joined_private_archived_threads(
+    struct winecord *client,
+    u64snowflake channel_id,
+    u64unix_ms before,
+    struct winecord_paginate_thread_response_body *attr)
+{
+    struct _winecord_paginator *p;
+
+    WINEBERRY_EXPECT(client, channel_id != 0, WINEBERRY_BAD_PARAMETER, "");
+    WINEBERRY_EXPECT(client, attr != NULL, WINEBERRY_BAD_PARAMETER, "");
+
+    p = _winecord_paginator_init(
+        client, WINECORD_LISTING_JOINED_PRIVATE_ARCHIVED_THREADS, channel_id,
+        before);
+    _PAGINATOR_COPY(p, attr);
+
+    return _winecord_paginator_start(p);
+}
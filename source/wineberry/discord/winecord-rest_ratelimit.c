@@ -37,6 +37,9 @@ struct _winecord_route {
     int state;
 };
 
+/** default amount of requests per second allowed by the global ratelimit */
+#define WINECORD_GLOBAL_RATE 50L
+
 #define KEY_PUSH(key, len, ...)                                               \
     do {                                                                      \
         *len += snprintf(key + *len, WINECORD_ROUTE_LEN - (size_t)*len,        \
@@ -95,7 +98,8 @@ winecord_ratelimiter_build_key(enum http_method method,
          * literal ID will be pushed */
         if (0 == strncmp(curr, "%" PRIu64, currlen)
             && (0 == strncmp(prev, "channels", 8)
-                || 0 == strncmp(prev, "guilds", 6)))
+                || 0 == strncmp(prev, "guilds", 6)
+                || 0 == strncmp(prev, "webhooks", 8)))
             KEY_PUSH(key, &keylen, "%" PRIu64, id_arg);
         else
             KEY_PUSH(key, &keylen, "%.*s", (int)currlen, curr);
@@ -105,12 +109,54 @@ winecord_ratelimiter_build_key(enum http_method method,
     } while (curr[currlen] != '\0');
 }
 
+unsigned long
+winecord_ratelimiter_hash_major(const char key[])
+{
+    static const char *const majors[] = { ":channels:", ":guilds:",
+                                          ":webhooks:" };
+    const char *start = key;
+    size_t len = strlen(key);
+    unsigned long hash = 5381;
+
+    for (size_t i = 0; i < sizeof(majors) / sizeof *majors; ++i) {
+        const char *found = strstr(key, majors[i]);
+
+        if (found) {
+            start = found + strlen(majors[i]);
+            len = strcspn(start, ":");
+            break;
+        }
+    }
+    /* djb2 */
+    while (len--)
+        hash = ((hash << 5) + hash) + (unsigned char)*start++;
+
+    return hash;
+}
+
+u64snowflake
+winecord_ratelimiter_get_major(const char key[])
+{
+    static const char *const majors[] = { ":channels:", ":guilds:",
+                                          ":webhooks:" };
+
+    for (size_t i = 0; i < sizeof(majors) / sizeof *majors; ++i) {
+        const char *found = strstr(key, majors[i]);
+
+        if (found)
+            return (u64snowflake)strtoull(found + strlen(majors[i]), NULL, 10);
+    }
+    return 0;
+}
+
 void
 winecord_ratelimiter_set_global_timeout(struct winecord_ratelimiter *rl,
                                        struct winecord_bucket *b,
                                        u64unix_ms wait_ms)
 {
-    *rl->global_wait_tstamp = cog_timestamp_ms() + wait_ms;
+    /* shared by every `REST` thread */
+    __atomic_store_n(rl->global_wait_tstamp, cog_timestamp_ms() + wait_ms,
+                     __ATOMIC_RELAXED);
     winecord_bucket_set_timeout(b, wait_ms);
 }
 
@@ -131,32 +177,159 @@ _winecord_bucket_init(struct winecord_ratelimiter *rl,
     b->remaining = 1;
     b->limit = limit;
 
-    QUEUE_INIT(&b->queues.next);
+    winecord_flows_init(&b->queues.next);
     QUEUE_INIT(&b->entry);
 
+    /* routes may be inspected from other threads */
+    pthread_mutex_lock(&rl->lock);
     chash_assign(rl, key, b, RATELIMITER_TABLE);
+    pthread_mutex_unlock(&rl->lock);
 
     return b;
 }
 
+/* get the `REST` thread that the ratelimiter belongs to */
+static struct winecord_rest_shard *
+_winecord_ratelimiter_get_shard(struct winecord_ratelimiter *rl)
+{
+    return REST_SHARD(CONTAINEROF(rl, struct winecord_requestor, ratelimiter));
+}
+
+/* load routes persisted by a previous run, each line is formatted as
+ *      `<key> <bucket hash> <bucket limit>` */
+static void
+_winecord_ratelimiter_load(struct winecord_ratelimiter *rl)
+{
+    struct winecord_rest_shard *shard = _winecord_ratelimiter_get_shard(rl);
+    char key[WINECORD_ROUTE_LEN], hash[64];
+    int count = 0;
+    long limit;
+    FILE *fp;
+
+    if (!(fp = fopen(rl->persist_path, "r"))) return;
+
+    /* widths must match WINECORD_ROUTE_LEN and winecord_bucket's hash */
+    while (3 == fscanf(fp, "%255s %63s %ld", key, hash, &limit)) {
+        int ret;
+
+        /* route is performed by another `REST` thread */
+        if (winecord_rest_get_shard(shard->rest, key) != shard) continue;
+
+        ret = chash_contains(rl, key, ret, RATELIMITER_TABLE);
+
+        if (!ret) {
+            _winecord_bucket_init(
+                rl, key, &(struct ua_szbuf_readonly){ hash, strlen(hash) },
+                limit);
+            ++count;
+        }
+    }
+    fclose(fp);
+
+    logconf_info(&rl->conf, "Preloaded %d routes from '%s'", count,
+                 rl->persist_path);
+}
+
+/* persist discovered routes, so they are known from startup next run */
+void
+winecord_ratelimiter_save(struct winecord_ratelimiter *rl)
+{
+    struct winecord_rest *rest = _winecord_ratelimiter_get_shard(rl)->rest;
+    char tmp_path[4096];
+    FILE *fp;
+    int len;
+
+    if (!rl->persist_path) return;
+
+    len = snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", rl->persist_path);
+    ASSERT_NOT_OOB(len, sizeof(tmp_path));
+
+    if (!(fp = fopen(tmp_path, "w"))) {
+        logconf_error(&rl->conf, "Couldn't persist routes to '%s'", tmp_path);
+        return;
+    }
+    for (int n = 0; n < rest->n_shards; ++n) {
+        struct winecord_ratelimiter *shard_rl =
+            &rest->shards[n].requestor.ratelimiter;
+
+        for (int i = 0; i < shard_rl->capacity; ++i) {
+            struct _winecord_route *r = shard_rl->routes + i;
+
+            if (CHASH_FILLED == r->state && !r->bucket->is_provisional)
+                fprintf(fp, "%s %s %ld\n", r->key, r->bucket->hash,
+                        r->bucket->limit);
+        }
+    }
+    fclose(fp);
+
+    /* replace the previous file at once, so it's never left half-written */
+    if (rename(tmp_path, rl->persist_path) != 0)
+        logconf_error(&rl->conf, "Couldn't persist routes to '%s'",
+                      rl->persist_path);
+}
+
+static void
+_winecord_ratelimiter_load_cb(struct WINECORD *client,
+                             struct winecord_timer *timer)
+{
+    (void)client;
+    _winecord_ratelimiter_load(timer->data);
+}
+
+void
+winecord_ratelimiter_persist(struct winecord_ratelimiter *rl,
+                            const char path[])
+{
+    struct winecord_rest_shard *shard = _winecord_ratelimiter_get_shard(rl);
+
+    if (rl->persist_path) free(rl->persist_path);
+    cog_strndup(path, strlen(path), &rl->persist_path);
+    /* routes are only inserted from the ratelimiter's `REST` thread, so that
+     *      a route isn't preloaded over a bucket that it has created */
+    _winecord_timer_ctl(CLIENT(shard->rest, rest), &shard->timers,
+                       &(struct winecord_timer){
+                           .on_tick = &_winecord_ratelimiter_load_cb,
+                           .data = rl,
+                           .delay = 0,
+                           .flags = WINECORD_TIMER_DELETE_AUTO,
+                       });
+}
+
 void
 winecord_ratelimiter_init(struct winecord_ratelimiter *rl, struct logconf *conf)
 {
-    struct ua_szbuf_readonly keynull = { "null", 4 }, keymiss = { "miss", 4 };
+    struct winecord_ratelimiter *first =
+        &_winecord_ratelimiter_get_shard(rl)->rest->shards->requestor
+             .ratelimiter;
+    struct logconf_field field;
 
     __chash_init(rl, RATELIMITER_TABLE);
+    ASSERT_S(!pthread_mutex_init(&rl->lock, NULL),
+             "Couldn't initialize ratelimiter's routes mutex");
 
     logconf_branch(&rl->conf, conf, "WINECORD_RATELIMIT");
 
-    /* global ratelimiting */
-    rl->global_wait_tstamp = calloc(1, sizeof *rl->global_wait_tstamp);
-
-    /* initialize 'singleton' buckets */
-    rl->null = _winecord_bucket_init(rl, "null", &keynull, 1L);
-    rl->miss = _winecord_bucket_init(rl, "miss", &keymiss, LONG_MAX);
+    /* global ratelimiting is shared by every `REST` thread */
+    if (rl == first) {
+        rl->global_wait_tstamp = calloc(1, sizeof *rl->global_wait_tstamp);
+        rl->global = calloc(1, sizeof *rl->global);
+        rl->global->rate = WINECORD_GLOBAL_RATE;
+    }
+    else {
+        rl->global_wait_tstamp = first->global_wait_tstamp;
+        rl->global = first->global;
+    }
 
     /* initialize bucket queues */
     QUEUE_INIT(&rl->queues.pending);
+
+    /* preload routes discovered by a previous run */
+    field = logconf_get_field(&rl->conf,
+                              (char *[2]){ "winecord", "ratelimit_file" }, 2);
+    if (field.size) {
+        cog_strndup(field.start, field.size, &rl->persist_path);
+        _winecord_ratelimiter_load(rl);
+    }
 }
 
 /* cancel all pending and busy requests from a bucket */
@@ -166,28 +339,63 @@ _winecord_bucket_cancel_all(struct winecord_ratelimiter *rl,
 {
     struct winecord_requestor *rqtor =
         CONTAINEROF(rl, struct winecord_requestor, ratelimiter);
+    struct winecord_request *req;
 
     /* cancel busy transfer */
     if (b->busy_req) winecord_request_cancel(rqtor, b->busy_req);
 
-    /* move pending tranfers to recycling */
-    pthread_mutex_lock(&rqtor->qlocks->recycling);
-    QUEUE_ADD(&rqtor->queues->recycling, &b->queues.next);
-    pthread_mutex_unlock(&rqtor->qlocks->recycling);
-    QUEUE_INIT(&b->queues.next);
+    /* cancel pending transfers, along with the requests coalesced into
+     *      them */
+    while ((req = winecord_flows_peek(&b->queues.next)) != NULL)
+        winecord_request_cancel(rqtor, req);
 }
 
 void
 winecord_ratelimiter_cleanup(struct winecord_ratelimiter *rl)
 {
+    if (rl->persist_path) free(rl->persist_path);
     /* iterate and cleanup known buckets */
     for (int i = 0; i < rl->capacity; ++i) {
         struct _winecord_route *r = rl->routes + i;
-        if (CHASH_FILLED == r->state)
+        if (CHASH_FILLED == r->state) {
             _winecord_bucket_cancel_all(rl, r->bucket);
+            winecord_flows_cleanup(&r->bucket->queues.next);
+            free(r->bucket->deadlines.array);
+        }
+    }
+    /* global ratelimiting is owned by the first `REST` thread */
+    if (rl == &_winecord_ratelimiter_get_shard(rl)->rest->shards->requestor
+                   .ratelimiter)
+    {
+        free(rl->global_wait_tstamp);
+        free(rl->global);
     }
-    free(rl->global_wait_tstamp);
     __chash_free(rl, RATELIMITER_TABLE);
+    pthread_mutex_destroy(&rl->lock);
+}
+
+void
+winecord_ratelimiter_foreach(struct winecord_ratelimiter *rl,
+                            void (*iter)(void *data,
+                                         const char key[],
+                                         const char hash[],
+                                         struct winecord_bucket *b),
+                            void *data)
+{
+    pthread_mutex_lock(&rl->lock);
+    for (int i = 0; i < rl->capacity; ++i) {
+        struct _winecord_route *r = rl->routes + i;
+
+        if (CHASH_FILLED != r->state) continue;
+
+        /* hash is only modified while the bucket is provisional */
+        (*iter)(data, r->key,
+                __atomic_load_n(&r->bucket->is_provisional, __ATOMIC_ACQUIRE)
+                    ? "null"
+                    : r->bucket->hash,
+                r->bucket);
+    }
+    pthread_mutex_unlock(&rl->lock);
 }
 
 static struct winecord_bucket *
@@ -212,20 +420,148 @@ _winecord_bucket_wake_cb(struct WINECORD *client, struct winecord_timer *timer)
     b->remaining = 1;
 }
 
+/* fail the requests of a bucket whose circuit is open, so that they don't
+ *      hold back the queue until the route recovers */
+static void
+_winecord_bucket_trip(struct winecord_ratelimiter *rl,
+                     struct winecord_bucket *b)
+{
+    struct winecord_requestor *rqtor =
+        CONTAINEROF(rl, struct winecord_requestor, ratelimiter);
+    struct winecord_request *req;
+
+    logconf_warn(&rl->conf, "[%.4s] Circuit is open, failing its requests",
+                 b->hash);
+    while ((req = winecord_flows_peek(&b->queues.next)) != NULL)
+        winecord_request_fail(rqtor, req, WINEBERRY_WINECORD_CIRCUIT_OPEN);
+}
+
+/* place request at the `i` index of the bucket's deadlines heap */
+static void
+_winecord_deadlines_set(struct winecord_bucket *b,
+                        int i,
+                        struct winecord_request *req)
+{
+    b->deadlines.array[i] = req;
+    req->deadline_pos = i + 1;
+}
+
+/* move the request at the `i` index up, past the later deadlines */
+static void
+_winecord_deadlines_up(struct winecord_bucket *b, int i)
+{
+    struct winecord_request *req = b->deadlines.array[i];
+    int parent;
+
+    for (; i > 0; i = parent) {
+        parent = (i - 1) / 2;
+        if (b->deadlines.array[parent]->deadline <= req->deadline) break;
+        _winecord_deadlines_set(b, i, b->deadlines.array[parent]);
+    }
+    _winecord_deadlines_set(b, i, req);
+}
+
+/* move the request at the `i` index down, past the earlier deadlines */
+static void
+_winecord_deadlines_down(struct winecord_bucket *b, int i)
+{
+    struct winecord_request *req = b->deadlines.array[i];
+    int child;
+
+    for (; (child = 2 * i + 1) < b->deadlines.size; i = child) {
+        if (child + 1 < b->deadlines.size
+            && b->deadlines.array[child + 1]->deadline
+                   < b->deadlines.array[child]->deadline)
+            ++child;
+        if (req->deadline <= b->deadlines.array[child]->deadline) break;
+        _winecord_deadlines_set(b, i, b->deadlines.array[child]);
+    }
+    _winecord_deadlines_set(b, i, req);
+}
+
+static void
+_winecord_deadlines_push(struct winecord_bucket *b,
+                         struct winecord_request *req)
+{
+    if (b->deadlines.size == b->deadlines.realsize) {
+        int realsize = b->deadlines.realsize ? b->deadlines.realsize * 2 : 8;
+        void *tmp = realloc(b->deadlines.array,
+                            (size_t)realsize * sizeof *b->deadlines.array);
+        ASSERT_S(tmp != NULL, "Out of memory");
+
+        b->deadlines.array = tmp;
+        b->deadlines.realsize = realsize;
+    }
+    b->deadlines.array[b->deadlines.size] = req;
+    _winecord_deadlines_up(b, b->deadlines.size++);
+}
+
+void
+winecord_bucket_remove(struct winecord_bucket *b, struct winecord_request *req)
+{
+    winecord_flows_remove(&b->queues.next, req);
+    req->is_queued = false;
+
+    if (req->deadline_pos) {
+        const int i = req->deadline_pos - 1;
+        struct winecord_request *last =
+            b->deadlines.array[--b->deadlines.size];
+
+        req->deadline_pos = 0;
+        /* fill the gap with the heap's last request */
+        if (last != req) {
+            _winecord_deadlines_set(b, i, last);
+            _winecord_deadlines_up(b, i);
+            _winecord_deadlines_down(b, last->deadline_pos - 1);
+        }
+    }
+}
+
+/* fail the requests that can't be sent before their deadline, given that
+ *      the bucket won't send anything until `send_tstamp`
+ * @note only the heap's top has to be checked, as it has the earliest
+ *      deadline */
+static void
+_winecord_bucket_expire(struct winecord_ratelimiter *rl,
+                       struct winecord_bucket *b,
+                       u64unix_ms send_tstamp)
+{
+    struct winecord_requestor *rqtor =
+        CONTAINEROF(rl, struct winecord_requestor, ratelimiter);
+    struct winecord_request *req;
+
+    while (b->deadlines.size
+           && (req = b->deadlines.array[0])->deadline < send_tstamp)
+    {
+        logconf_warn(&rl->conf,
+                     "[%.4s] Request to '%s' can't be sent before its "
+                     "deadline",
+                     b->hash, req->endpoint);
+        /* removes the request from the heap */
+        winecord_request_fail(rqtor, req, WINEBERRY_WINECORD_DEADLINE);
+    }
+}
+
 static void
 _winecord_bucket_try_timeout(struct winecord_ratelimiter *rl,
                             struct winecord_bucket *b)
 {
-    struct WINECORD *client = CLIENT(rl, rest.requestor.ratelimiter);
-    const u64unix_ms reset_tstamp = (*rl->global_wait_tstamp > b->reset_tstamp)
-                                        ? *rl->global_wait_tstamp
+    struct winecord_rest_shard *shard = _winecord_ratelimiter_get_shard(rl);
+    struct WINECORD *client = CLIENT(shard->rest, rest);
+    const u64unix_ms global_tstamp =
+        __atomic_load_n(rl->global_wait_tstamp, __ATOMIC_RELAXED);
+    const u64unix_ms reset_tstamp = (global_tstamp > b->reset_tstamp)
+                                        ? global_tstamp
                                         : b->reset_tstamp;
     int64_t wait_ms = (int64_t)(reset_tstamp - cog_timestamp_ms());
 
+    /* no point in waiting on behalf of requests that won't make it */
+    _winecord_bucket_expire(rl, b, reset_tstamp);
+
     if (wait_ms < 0) wait_ms = 0;
     b->busy_req = WINECORD_BUCKET_TIMEOUT;
 
-    _winecord_timer_ctl(client, &client->rest.timers,
+    _winecord_timer_ctl(client, &shard->timers,
                        &(struct winecord_timer){
                            .on_tick = &_winecord_bucket_wake_cb,
                            .data = b,
@@ -237,7 +573,7 @@ _winecord_bucket_try_timeout(struct winecord_ratelimiter *rl,
                  b->hash, wait_ms);
 }
 
-/* attempt to find a bucket associated key */
+/* attempt to find a bucket associated key, or create a provisional one */
 struct winecord_bucket *
 winecord_bucket_get(struct winecord_ratelimiter *rl, const char key[])
 {
@@ -248,61 +584,48 @@ winecord_bucket_get(struct winecord_ratelimiter *rl, const char key[])
                       b->hash, key);
     }
     else {
-        b = rl->null;
-        logconf_trace(&rl->conf, "[null] Couldn't match known buckets to '%s'",
+        /* until the route's first response arrives its requests are sent
+         *      one at a time, without holding back other new routes */
+        b = _winecord_bucket_init(
+            rl, key, &(struct ua_szbuf_readonly){ "null", 4 }, 1L);
+        b->is_provisional = true;
+        logconf_trace(&rl->conf,
+                      "[null] Couldn't match known buckets to '%s', "
+                      "created a provisional bucket",
                       key);
     }
     return b;
 }
 
-/* check if successive requests made from a `null` singleton bucket can be
- *      matched to another bucket */
+/* promote a provisional bucket into the route's actual bucket, once its
+ *      ratelimiting group is revealed by a response */
 static void
-_winecord_ratelimiter_null_filter(struct winecord_ratelimiter *rl,
-                                 struct winecord_bucket *b,
-                                 const char key[])
+_winecord_bucket_promote(struct winecord_ratelimiter *rl,
+                        struct winecord_bucket *b,
+                        const char key[],
+                        struct ua_info *info)
 {
-    QUEUE(struct winecord_request) queue, *qelem;
-    struct winecord_request *req;
+    struct ua_szbuf_readonly hash =
+        ua_info_get_header(info, "x-ratelimit-bucket");
+    int len;
 
-    QUEUE_MOVE(&rl->null->queues.next, &queue);
-    while (!QUEUE_EMPTY(&queue)) {
-        qelem = QUEUE_HEAD(&queue);
-        req = QUEUE_DATA(qelem, struct winecord_request, entry);
-        if (strcmp(req->key, key) != 0) b = rl->null;
-        winecord_bucket_insert(rl, b, req, false);
+    if (!hash.size) { /* bucket is not part of a ratelimiting group */
+        hash = (struct ua_szbuf_readonly){ "miss", 4 };
+        b->limit = LONG_MAX;
     }
-}
-
-static struct winecord_bucket *
-_winecord_ratelimiter_get_match(struct winecord_ratelimiter *rl,
-                               const char key[],
-                               struct ua_info *info)
-{
-    struct winecord_bucket *b;
-
-    if (NULL == (b = _winecord_bucket_find(rl, key))) {
-        struct ua_szbuf_readonly hash =
-            ua_info_get_header(info, "x-ratelimit-bucket");
-
-        if (!hash.size) { /* bucket is not part of a ratelimiting group */
-            b = rl->miss;
-        }
-        else { /* create bucket if it doesn't exist yet */
-            struct ua_szbuf_readonly limit =
-                ua_info_get_header(info, "x-ratelimit-limit");
-            long _limit =
-                limit.size ? strtol(limit.start, NULL, 10) : LONG_MAX;
+    else {
+        struct ua_szbuf_readonly limit =
+            ua_info_get_header(info, "x-ratelimit-limit");
 
-            b = _winecord_bucket_init(rl, key, &hash, _limit);
-        }
+        b->limit = limit.size ? strtol(limit.start, NULL, 10) : LONG_MAX;
     }
+    len = snprintf(b->hash, sizeof(b->hash), "%.*s", (int)hash.size,
+                   hash.start);
+    ASSERT_NOT_OOB(len, sizeof(b->hash));
+    /* hash may be read by other threads once the bucket isn't provisional */
+    __atomic_store_n(&b->is_provisional, false, __ATOMIC_RELEASE);
 
     logconf_debug(&rl->conf, "[%.4s] Match '%s' to bucket", b->hash, key);
-
-    _winecord_ratelimiter_null_filter(rl, b, key);
-
-    return b;
 }
 
 /* attempt to fill bucket's values with response header fields */
@@ -329,7 +652,8 @@ _winecord_bucket_populate(struct winecord_ratelimiter *rl,
             now + (u64unix_ms)(1000 * strtod(reset_after.start, NULL));
 
         if (global.size) /* lock all buckets */
-            *rl->global_wait_tstamp = reset_tstamp;
+            __atomic_store_n(rl->global_wait_tstamp, reset_tstamp,
+                             __ATOMIC_RELAXED);
         else /* lock single bucket, timeout at winecord_rest_run() */
             b->reset_tstamp = reset_tstamp;
     }
@@ -365,12 +689,68 @@ winecord_ratelimiter_build(struct winecord_ratelimiter *rl,
                           const char key[],
                           struct ua_info *info)
 {
-    /* try to match to existing, or create new bucket */
-    if (b == rl->null) b = _winecord_ratelimiter_get_match(rl, key, info);
+    /* match provisional bucket to its ratelimiting group */
+    if (b->is_provisional) _winecord_bucket_promote(rl, b, key, info);
     /* populate bucket with response header values */
     _winecord_bucket_populate(rl, b, info);
 }
 
+int
+winecord_request_get_class(const struct winecord_request *req)
+{
+    if (req->dispatch.high_priority
+        && req->dispatch.priority < WINECORD_PRIORITY_HIGH)
+        return WINECORD_PRIORITY_HIGH;
+    return req->dispatch.priority;
+}
+
+/* check if `a` should be sent before `b`: higher classes go first, then the
+ *      earliest deadlines, then the requests without one, and then in order
+ *      of their fair queuing finish tags */
+bool
+winecord_request_precedes(const struct winecord_request *a,
+                          const struct winecord_request *b)
+{
+    const int class_a = winecord_request_get_class(a),
+              class_b = winecord_request_get_class(b);
+
+    if (class_a != class_b) return class_a > class_b;
+    if (a->deadline != b->deadline) {
+        if (!a->deadline) return false;
+        return !b->deadline || a->deadline < b->deadline;
+    }
+    return a->fair.finish < b->fair.finish;
+}
+
+/* weighted fair queuing: a request starts no earlier than the virtual time,
+ *      nor before its tenant's last request queued at the bucket finishes,
+ *      and takes up virtual time inversely to its tenant's weight. So a
+ *      tenant's backlog only pushes back its own requests
+ * @note tags are comparable across buckets, as the virtual time is shared
+ *      by every bucket of the `REST` thread */
+static void
+_winecord_bucket_tag(struct winecord_ratelimiter *rl,
+                     struct winecord_bucket *b,
+                     struct winecord_request *req)
+{
+    struct winecord_rest *rest = _winecord_ratelimiter_get_shard(rl)->rest;
+    uint64_t start = rl->vtime, finish;
+
+    req->fair.tenant = req->dispatch.tenant
+                           ? req->dispatch.tenant
+                           : winecord_ratelimiter_get_major(req->key);
+
+    finish = winecord_flows_get_finish(&b->queues.next, req->fair.tenant);
+    if (finish > start) start = finish;
+
+    req->fair.start = start;
+    req->fair.finish =
+        start
+        + WINECORD_FAIR_QUANTUM
+              / (uint64_t)winecord_tenants_get_weight(&rest->tenants,
+                                                      req->fair.tenant);
+}
+
 void
 winecord_bucket_insert(struct winecord_ratelimiter *rl,
                       struct winecord_bucket *b,
@@ -378,63 +758,223 @@ winecord_bucket_insert(struct winecord_ratelimiter *rl,
                       bool high_priority)
 {
     QUEUE_REMOVE(&req->entry);
-    if (high_priority)
-        QUEUE_INSERT_HEAD(&b->queues.next, &req->entry);
-    else
-        QUEUE_INSERT_TAIL(&b->queues.next, &req->entry);
-
-    /* add bucket to ratelimiter pending buckets queue (if not already in) */
+    if (!high_priority) _winecord_bucket_tag(rl, b, req);
+    /* a quiet tenant's request isn't queued behind the backlog of noisy
+     *      ones */
+    winecord_flows_insert(&b->queues.next, req, high_priority);
+    if (req->deadline) _winecord_deadlines_push(b, req);
+
+    /* add bucket to ratelimiter pending buckets queue (if not already in),
+     *      it is positioned by its next request at the selector */
     if (QUEUE_EMPTY(&b->entry))
         QUEUE_INSERT_HEAD(&rl->queues.pending, &b->entry);
+    if (winecord_flows_peek(&b->queues.next) == req) b->has_new_head = true;
 
+    req->is_queued = true;
     req->b = b;
+    req->tstamps.bucketed = (int64_t)cog_timestamp_us();
+}
+
+static void
+_winecord_bucket_request_select(struct winecord_ratelimiter *rl,
+                                struct winecord_bucket *b)
+{
+    b->busy_req = winecord_flows_peek(&b->queues.next);
+    winecord_bucket_remove(b, b->busy_req);
+    /* advance the virtual time to the request in service */
+    if (b->busy_req->fair.start > rl->vtime)
+        rl->vtime = b->busy_req->fair.start;
+}
+
+static void
+_winecord_ratelimiter_global_wake_cb(struct WINECORD *client,
+                                    struct winecord_timer *timer)
+{
+    (void)client;
+    struct winecord_ratelimiter *rl = timer->data;
+
+    /* selector runs again once REST timers are done */
+    rl->is_global_waiting = false;
+}
+
+/* take a slot from the client-side global ratelimit, `false` if there's
+ *      none left and a timer has been set to wait for the next one
+ * @note the global ratelimit is shared by every `REST` thread, so its
+ *      arrival timestamp is only advanced by a successful compare-and-swap */
+static bool
+_winecord_ratelimiter_global_take(struct winecord_ratelimiter *rl,
+                                 const struct winecord_request *req,
+                                 u64unix_ms now)
+{
+    struct winecord_rest_shard *shard = _winecord_ratelimiter_get_shard(rl);
+    struct WINECORD *client = CLIENT(shard->rest, rest);
+    const long rate = __atomic_load_n(&rl->global->rate, __ATOMIC_RELAXED);
+    u64unix_ms interval, tolerance, arrival, next, now_us = now * 1000;
+    int64_t wait_ms;
+
+    /* interaction endpoints are not bound to the global ratelimit */
+    if (rate <= 0 || 0 == strncmp(req->route, "/interactions/", 14))
+        return true;
+
+    /* requests are spaced by `interval`, bursts of `rate` are tolerated */
+    interval = 1000000 / (u64unix_ms)rate;
+    tolerance = interval * (u64unix_ms)(rate - 1);
+
+    arrival = __atomic_load_n(&rl->global->arrival_tstamp, __ATOMIC_RELAXED);
+    while (arrival <= now_us + tolerance) {
+        next = (arrival > now_us ? arrival : now_us) + interval;
+        /* on failure `arrival` is updated to the other thread's value */
+        if (__atomic_compare_exchange_n(&rl->global->arrival_tstamp, &arrival,
+                                        next, true, __ATOMIC_RELAXED,
+                                        __ATOMIC_RELAXED))
+            return true;
+    }
+    if (rl->is_global_waiting) return false;
+
+    wait_ms = (int64_t)((arrival - tolerance - now_us + 999) / 1000);
+    rl->is_global_waiting = true;
+    _winecord_timer_ctl(client, &shard->timers,
+                       &(struct winecord_timer){
+                           .on_tick = &_winecord_ratelimiter_global_wake_cb,
+                           .data = rl,
+                           .delay = wait_ms,
+                           .flags = WINECORD_TIMER_DELETE_AUTO,
+                       });
+
+    logconf_debug(&rl->conf, "[global] Out of requests (wait %" PRId64 " ms)",
+                  wait_ms);
+
+    return false;
+}
+
+/* get the bucket's next request, NULL if it has none */
+static struct winecord_request *
+_winecord_bucket_peek(struct winecord_bucket *b)
+{
+    return winecord_flows_peek(&b->queues.next);
+}
+
+/* check if bucket `a` should be visited before `b`, buckets without a
+ *      next request go last */
+static bool
+_winecord_bucket_precedes(struct winecord_bucket *a, struct winecord_bucket *b)
+{
+    struct winecord_request *req_a = _winecord_bucket_peek(a),
+                            *req_b = _winecord_bucket_peek(b);
+
+    if (!req_a) return false;
+    return !req_b || winecord_request_precedes(req_a, req_b);
 }
 
+/* keep pending buckets ordered by their next request, so that requests are
+ *      sent in order of class and deadline across buckets
+ * @note the buckets whose next request hasn't changed are still in order,
+ *      so only the others are positioned again */
 static void
-_winecord_bucket_request_select(struct winecord_bucket *b)
+_winecord_ratelimiter_sort_pending(QUEUE(struct winecord_bucket) * queue)
 {
-    QUEUE(struct winecord_request) *qelem = QUEUE_HEAD(&b->queues.next);
-    QUEUE_REMOVE(qelem);
-    QUEUE_INIT(qelem);
+    QUEUE(struct winecord_bucket) moved, *qelem, *next, *pos;
+    struct winecord_bucket *b;
+
+    QUEUE_INIT(&moved);
+    for (qelem = QUEUE_NEXT(queue); qelem != queue; qelem = next) {
+        next = QUEUE_NEXT(qelem);
+        b = QUEUE_DATA(qelem, struct winecord_bucket, entry);
+        if (b->has_new_head) {
+            QUEUE_REMOVE(qelem);
+            QUEUE_INSERT_TAIL(&moved, qelem);
+        }
+    }
+    while (!QUEUE_EMPTY(&moved)) {
+        qelem = QUEUE_HEAD(&moved);
+        QUEUE_REMOVE(qelem);
+
+        b = QUEUE_DATA(qelem, struct winecord_bucket, entry);
+        b->has_new_head = false;
+        /* walk from the tail, as buckets of the same class are visited in
+         *      order of arrival */
+        for (pos = QUEUE_PREV(queue); pos != queue; pos = QUEUE_PREV(pos))
+            if (!_winecord_bucket_precedes(
+                    b, QUEUE_DATA(pos, struct winecord_bucket, entry)))
+                break;
+        QUEUE_INSERT_HEAD(pos, qelem);
+    }
+}
 
-    b->busy_req = QUEUE_DATA(qelem, struct winecord_request, entry);
+/* move bucket back to the pending buckets queue, to be positioned again if
+ *      its next request isn't `head` anymore */
+static void
+_winecord_ratelimiter_keep_pending(struct winecord_ratelimiter *rl,
+                                   struct winecord_bucket *b,
+                                   const struct winecord_request *head)
+{
+    if (_winecord_bucket_peek(b) != head) b->has_new_head = true;
+    QUEUE_INSERT_TAIL(&rl->queues.pending, &b->entry);
 }
 
 void
 winecord_bucket_request_selector(struct winecord_ratelimiter *rl,
+                                int budget,
                                 void *data,
                                 void (*iter)(void *data,
                                              struct winecord_request *req))
 {
     QUEUE(struct winecord_bucket) queue, *qelem;
+    struct winecord_request *head;
     struct winecord_bucket *b;
+    const u64unix_ms now = cog_timestamp_ms();
+    const u64unix_ms global_tstamp =
+        __atomic_load_n(rl->global_wait_tstamp, __ATOMIC_RELAXED);
 
     /* loop through each pending buckets and enqueue next requests */
     QUEUE_MOVE(&rl->queues.pending, &queue);
+    _winecord_ratelimiter_sort_pending(&queue);
     while (!QUEUE_EMPTY(&queue)) {
         qelem = QUEUE_HEAD(&queue);
         b = QUEUE_DATA(qelem, struct winecord_bucket, entry);
+        head = _winecord_bucket_peek(b);
 
         QUEUE_REMOVE(qelem);
-        if (b->busy_req) {
-            QUEUE_INSERT_TAIL(&rl->queues.pending, qelem);
+        _winecord_bucket_expire(rl, b,
+                               global_tstamp > now ? global_tstamp : now);
+        if (winecord_retry_is_open(b, now)) _winecord_bucket_trip(rl, b);
+        if (!_winecord_bucket_peek(b) && !b->busy_req) {
+            QUEUE_INIT(qelem);
+            continue;
+        }
+        /* a half-open circuit holds requests back while its probe is in
+         *      flight */
+        if (b->busy_req || winecord_retry_is_probing(b)) {
+            _winecord_ratelimiter_keep_pending(rl, b, head);
             continue;
         }
         if (!b->remaining) {
             _winecord_bucket_try_timeout(rl, b);
-            QUEUE_INSERT_TAIL(&rl->queues.pending, qelem);
+            _winecord_ratelimiter_keep_pending(rl, b, head);
             continue;
         }
+        /* keep remaining buckets pending for when transfers complete, or
+         *      tokens are refilled */
+        if (budget <= 0
+            || !_winecord_ratelimiter_global_take(
+                rl, _winecord_bucket_peek(b), now))
+        {
+            _winecord_ratelimiter_keep_pending(rl, b, head);
+            QUEUE_ADD(&rl->queues.pending, &queue);
+            break;
+        }
 
-        _winecord_bucket_request_select(b);
+        _winecord_bucket_request_select(rl, b);
+        winecord_retry_on_select(b);
         (*iter)(data, b->busy_req);
+        --budget;
 
         /* if bucket has no pending requests then remove it from
          * ratelimiter pending buckets queue */
-        if (QUEUE_EMPTY(&b->queues.next))
+        if (!_winecord_bucket_peek(b))
             QUEUE_INIT(qelem);
         else /* otherwise move it back to pending buckets queue */
-            QUEUE_INSERT_TAIL(&rl->queues.pending, qelem);
+            _winecord_ratelimiter_keep_pending(rl, b, head);
     }
 }
 
@@ -447,7 +987,7 @@ winecord_bucket_request_unselect(struct winecord_ratelimiter *rl,
     ASSERT_S(req == b->busy_req,
              "Attempt to unlock a bucket with a non-busy request");
 
-    if (QUEUE_EMPTY(&b->queues.next)) {
+    if (!winecord_flows_peek(&b->queues.next)) {
         QUEUE_REMOVE(&b->entry);
         QUEUE_INIT(&b->entry);
     }
@@ -455,6 +995,21 @@ winecord_bucket_request_unselect(struct winecord_ratelimiter *rl,
     req->b = NULL;
 }
 
+bool
+winecord_bucket_hedge_take(struct winecord_ratelimiter *rl,
+                          struct winecord_bucket *b,
+                          struct winecord_request *req)
+{
+    /* the request in flight has already been counted against `remaining`
+     *      by the server, so at least one more must be left */
+    if (b->is_provisional || b->remaining < 2) return false;
+    if (!_winecord_ratelimiter_global_take(rl, req, cog_timestamp_ms()))
+        return false;
+
+    --b->remaining;
+    return true;
+}
+
 void
 winecord_bucket_set_timeout(struct winecord_bucket *b, u64unix_ms wait_ms)
 {
@@ -462,3 +1017,60 @@ winecord_bucket_set_timeout(struct winecord_bucket *b, u64unix_ms wait_ms)
     b->reset_tstamp = cog_timestamp_ms() + wait_ms;
     b->busy_req = NULL;
 }
+
+void
+winecord_rest_set_rate(struct winecord *client, long rate)
+{
+    __atomic_store_n(&client->rest.shards->requestor.ratelimiter.global->rate,
+                     rate, __ATOMIC_RELAXED);
+}
+
+struct _winecord_ratelimit_inspect {
+    struct winecord_ratelimit_info *infos;
+    int size;
+    int count;
+};
+
+static void
+_winecord_ratelimit_inspect_cb(void *p_inspect,
+                               const char key[],
+                               const char hash[],
+                               struct winecord_bucket *b)
+{
+    struct _winecord_ratelimit_inspect *inspect = p_inspect;
+
+    if (inspect->count < inspect->size) {
+        struct winecord_ratelimit_info *info = inspect->infos + inspect->count;
+
+        snprintf(info->key, sizeof(info->key), "%s", key);
+        snprintf(info->hash, sizeof(info->hash), "%s", hash);
+        info->limit = __atomic_load_n(&b->limit, __ATOMIC_RELAXED);
+        info->remaining = __atomic_load_n(&b->remaining, __ATOMIC_RELAXED);
+        info->reset_tstamp =
+            __atomic_load_n(&b->reset_tstamp, __ATOMIC_RELAXED);
+    }
+    ++inspect->count;
+}
+
+int
+winecord_ratelimit_inspect(struct winecord *client,
+                           struct winecord_ratelimit_info infos[],
+                           int size)
+{
+    struct _winecord_ratelimit_inspect inspect = { infos, size, 0 };
+
+    for (int i = 0; i < client->rest.n_shards; ++i)
+        winecord_ratelimiter_foreach(
+            &client->rest.shards[i].requestor.ratelimiter,
+            &_winecord_ratelimit_inspect_cb, &inspect);
+
+    return inspect.count;
+}
+
+void
+winecord_rest_persist_ratelimits(struct winecord *client, const char path[])
+{
+    for (int i = 0; i < client->rest.n_shards; ++i)
+        winecord_ratelimiter_persist(
+            &client->rest.shards[i].requestor.ratelimiter, path);
+}
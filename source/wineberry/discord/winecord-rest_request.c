@@ -1,9 +1,78 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 
 #include "winecord.h"
 #include "winecord-internal.h"
+#include "winecord-worker.h"
+
+#define CHASH_BUCKETS_FIELD inflights
+#include "chash.h"
+
+/* chash heap-mode (auto-increase hashtable) */
+#define SINGLEFLIGHT_TABLE_HEAP   1
+#define SINGLEFLIGHT_TABLE_BUCKET struct _winecord_inflight
+#define SINGLEFLIGHT_TABLE_FREE_KEY(_key)
+#define SINGLEFLIGHT_TABLE_HASH(_key, _hash) chash_string_hash(_key, _hash)
+#define SINGLEFLIGHT_TABLE_FREE_VALUE(_value)
+#define SINGLEFLIGHT_TABLE_COMPARE(_cmp_a, _cmp_b)                            \
+    chash_string_compare(_cmp_a, _cmp_b)
+#define SINGLEFLIGHT_TABLE_INIT(inflight, _key, _value)                       \
+    chash_default_init(inflight, _key, _value)
+
+struct _winecord_inflight {
+    /** the leader request's endpoint */
+    const char *key;
+    /** the leader request, whose response is shared with its followers */
+    struct winecord_request *value;
+    /** the inflight state in the hashtable (see chash.h 'State enums') */
+    int state;
+};
+
+/** initial size of a request's body buffer */
+#define WINECORD_BODY_MIN_LEN 4096
+/** max size a request's body buffer may grow to */
+#define WINECORD_BODY_MAX_LEN (1 << 22)
+
+/** initial limit of a `REST` thread's in-flight transfers */
+#define WINECORD_AIMD_INITIAL 16
+/** floor of the in-flight transfers limit */
+#define WINECORD_AIMD_MIN 1
+/** ceiling of the in-flight transfers limit */
+#define WINECORD_AIMD_MAX 256
+/** transfers this many times slower than the smoothed latency are
+ *      considered degraded */
+#define WINECORD_AIMD_TOLERANCE 3
+/** transfers faster than this (in microseconds) are never considered
+ *      degraded by their latency alone */
+#define WINECORD_AIMD_LATENCY_MIN_US 500000
+
+/** latency quantile after which a `GET` request is duplicated */
+#define WINECORD_HEDGE_QUANTILE 0.95
+/** transfers a route must have completed before its requests are
+ *      duplicated */
+#define WINECORD_HEDGE_MIN_SAMPLES 20
+
+/** max amount of requests kept at a thread's recycling cache */
+#define WINECORD_REQUEST_CACHE_MAX 64
+/** amount of requests moved at once between a thread's cache and the
+ *      requestor's shared recycling queue */
+#define WINECORD_REQUEST_CACHE_BATCH 32
+
+/** @brief Thread-local cache of recycled requests
+ * @note only kept by `REST` threads for as long as they run, and by other
+ *      threads for the duration of a dispatch, so that threads outliving
+ *      the requestor (e.g. the threadpool's) don't hold on to requests */
+struct _winecord_request_cache {
+    /** stack of cached requests (linked by @ref winecord_request `next`) */
+    struct winecord_request *head;
+    /** amount of cached requests */
+    int size;
+};
+
+static pthread_key_t g_request_cache_key;
+static pthread_once_t g_request_cache_once = PTHREAD_ONCE_INIT;
 
 static struct winecord_request *
 _winecord_request_init(void)
@@ -16,71 +85,350 @@ _winecord_request_cleanup(struct winecord_request *req)
 {
     winecord_attachments_cleanup(&req->attachments);
     if (req->body.start) free(req->body.start);
+    if (req->recv.body.start) free(req->recv.body.start);
+    if (req->recv.items.start) free(req->recv.items.start);
+    if (req->hedge.body.start) free(req->hedge.body.start);
     if (req->reason) free(req->reason);
     free(req);
 }
 
+static void
+_winecord_request_cache_cleanup(void *p_cache)
+{
+    struct _winecord_request_cache *cache = p_cache;
+    struct winecord_request *req;
+
+    while ((req = cache->head) != NULL) {
+        cache->head = req->next;
+        _winecord_request_cleanup(req);
+    }
+    free(cache);
+}
+
+static void
+_winecord_request_cache_key_init(void)
+{
+    ASSERT_S(!pthread_key_create(&g_request_cache_key,
+                                 &_winecord_request_cache_cleanup),
+             "Couldn't create requests cache key");
+}
+
+/* get the calling thread's recycling cache, `NULL` if it doesn't keep one */
+static struct _winecord_request_cache *
+_winecord_request_cache_get(void)
+{
+    pthread_once(&g_request_cache_once, &_winecord_request_cache_key_init);
+    return pthread_getspecific(g_request_cache_key);
+}
+
+/* have the calling thread keep a recycling cache, returns `true` if it
+ *      has been created by this call and should be ended by the caller */
+static bool
+_winecord_request_cache_begin(void)
+{
+    if (_winecord_request_cache_get()) return false;
+
+    pthread_setspecific(g_request_cache_key,
+                        calloc(1, sizeof(struct _winecord_request_cache)));
+    return true;
+}
+
+/* move a batch of requests from the requestor's recycling queue to the
+ *      thread's cache */
+static void
+_winecord_request_cache_refill(struct winecord_requestor *rqtor,
+                               struct _winecord_request_cache *cache)
+{
+    QUEUE(struct winecord_request) *qelem;
+    struct winecord_request *req;
+
+    pthread_mutex_lock(&rqtor->qlocks->recycling);
+    while (cache->size < WINECORD_REQUEST_CACHE_BATCH
+           && !QUEUE_EMPTY(&rqtor->queues->recycling))
+    {
+        qelem = QUEUE_HEAD(&rqtor->queues->recycling);
+        QUEUE_REMOVE(qelem);
+
+        req = QUEUE_DATA(qelem, struct winecord_request, entry);
+        req->next = cache->head;
+        cache->head = req;
+        ++cache->size;
+    }
+    pthread_mutex_unlock(&rqtor->qlocks->recycling);
+}
+
+/* move a batch of requests from the thread's cache back to the requestor's
+ *      recycling queue, so they may be reused by other threads */
+static void
+_winecord_request_cache_flush(struct winecord_requestor *rqtor,
+                              struct _winecord_request_cache *cache,
+                              int amount)
+{
+    struct winecord_request *req;
+
+    pthread_mutex_lock(&rqtor->qlocks->recycling);
+    while (amount-- > 0 && (req = cache->head) != NULL) {
+        cache->head = req->next;
+        --cache->size;
+
+        req->next = NULL;
+        QUEUE_INIT(&req->entry);
+        QUEUE_INSERT_TAIL(&rqtor->queues->recycling, &req->entry);
+    }
+    pthread_mutex_unlock(&rqtor->qlocks->recycling);
+}
+
+/* hand the calling thread's cached requests back to the requestor, and stop
+ *      caching them */
+static void
+_winecord_request_cache_end(struct winecord_requestor *rqtor, bool is_owner)
+{
+    struct _winecord_request_cache *cache;
+
+    if (!is_owner) return;
+
+    cache = _winecord_request_cache_get();
+    pthread_setspecific(g_request_cache_key, NULL);
+    _winecord_request_cache_flush(rqtor, cache, cache->size);
+    free(cache);
+}
+
+void
+winecord_requestor_cache_attach(void)
+{
+    _winecord_request_cache_begin();
+}
+
+static void
+_winecord_request_recycle(struct winecord_requestor *rqtor,
+                          struct winecord_request *req)
+{
+    struct _winecord_request_cache *cache = _winecord_request_cache_get();
+
+    if (!cache) {
+        req->next = NULL;
+        pthread_mutex_lock(&rqtor->qlocks->recycling);
+        QUEUE_INSERT_TAIL(&rqtor->queues->recycling, &req->entry);
+        pthread_mutex_unlock(&rqtor->qlocks->recycling);
+        return;
+    }
+    req->next = cache->head;
+    cache->head = req;
+    if (++cache->size > WINECORD_REQUEST_CACHE_MAX)
+        _winecord_request_cache_flush(rqtor, cache,
+                                      WINECORD_REQUEST_CACHE_BATCH);
+}
+
 static void
 _winecord_on_curl_setopt(struct ua_conn *conn, void *p_token)
 {
+    CURL *ehandle = ua_conn_get_easy_handle(conn);
+    CURLSH *share = winecord_global_share();
     char auth[128];
     int len = snprintf(auth, sizeof(auth), "Bot %s", (char *)p_token);
     ASSERT_NOT_OOB(len, sizeof(auth));
 
     ua_conn_add_header(conn, "Authorization", auth);
+    /* detect connections that have been dropped while idle */
+    curl_easy_setopt(ehandle, CURLOPT_TCP_KEEPALIVE, 1L);
+    if (share) curl_easy_setopt(ehandle, CURLOPT_SHARE, share);
 #ifdef WINEBERRY_DEBUG_HTTP
-    curl_easy_setopt(ua_conn_get_easy_handle(conn), CURLOPT_VERBOSE, 1L);
+    curl_easy_setopt(ehandle, CURLOPT_VERBOSE, 1L);
 #endif
 }
 
+/** @brief A socket of the requestor's transfers being polled for */
+struct _winecord_socket {
+    /** the requestor that the socket's transfers belong to */
+    struct winecord_requestor *rqtor;
+    /** the socket's file descriptor */
+    curl_socket_t fd;
+};
+
+/* let curl act on a single socket that is ready, rather than having it
+ *      walk through every transfer */
+static void
+_winecord_on_socket_ready(struct io_poller *io,
+                          enum io_poller_events events,
+                          void *p_socket)
+{
+    struct _winecord_socket *sock = p_socket;
+    int mask = 0, alive = 0;
+    (void)io;
+
+    if (events & IO_POLLER_IN) mask |= CURL_CSELECT_IN;
+    if (events & IO_POLLER_OUT) mask |= CURL_CSELECT_OUT;
+    curl_multi_socket_action(sock->rqtor->mhandle, sock->fd, mask, &alive);
+}
+
+/* curl asks for a socket to be polled for, or to stop being polled for */
+static int
+_winecord_on_curl_socket(CURL *ehandle,
+                         curl_socket_t fd,
+                         int what,
+                         void *p_rqtor,
+                         void *p_socket)
+{
+    struct winecord_requestor *rqtor = p_rqtor;
+    struct winecord_rest_shard *shard = REST_SHARD(rqtor);
+    struct _winecord_socket *sock = p_socket;
+    enum io_poller_events events = 0;
+    (void)ehandle;
+
+    if (CURL_POLL_REMOVE == what) {
+        io_poller_socket_del(shard->io_poller, fd);
+        free(sock);
+        return 0;
+    }
+
+    if (!sock) {
+        sock = malloc(sizeof *sock);
+        sock->rqtor = rqtor;
+        sock->fd = fd;
+        curl_multi_assign(rqtor->mhandle, fd, sock);
+    }
+    if (what & CURL_POLL_IN) events |= IO_POLLER_IN;
+    if (what & CURL_POLL_OUT) events |= IO_POLLER_OUT;
+    io_poller_socket_add(shard->io_poller, fd, events,
+                         &_winecord_on_socket_ready, sock);
+
+    return 0;
+}
+
+/* curl asks to be notified once `timeout_ms` is over, the `REST` thread
+ *      polls no longer than that */
+static int
+_winecord_on_curl_timer(CURLM *mhandle, long timeout_ms, void *p_rqtor)
+{
+    struct winecord_requestor *rqtor = p_rqtor;
+    (void)mhandle;
+
+    if (timeout_ms < 0)
+        rqtor->timeout = -1;
+    else
+        rqtor->timeout =
+            (int64_t)winecord_timestamp_us(REQUESTOR_CLIENT(rqtor))
+            + (int64_t)timeout_ms * 1000;
+
+    return 0;
+}
+
 void
 winecord_requestor_init(struct winecord_requestor *rqtor,
                        struct logconf *conf,
                        const char token[])
 {
+    struct winecord_requestor *first =
+        &REST_SHARD(rqtor)->rest->shards->requestor;
+
     logconf_branch(&rqtor->conf, conf, "WINECORD_REQUEST");
 
     rqtor->ua = ua_init(&(struct ua_attr){ .conf = conf });
     ua_set_url(rqtor->ua, WINECORD_API_BASE_URL);
     ua_set_opt(rqtor->ua, (char *)token, &_winecord_on_curl_setopt);
 
-    /* queues are malloc'd to guarantee a client cloned by
-     * winecord_clone() will share the same queue with the original */
-    rqtor->queues = malloc(sizeof *rqtor->queues);
-    QUEUE_INIT(&rqtor->queues->recycling);
-    QUEUE_INIT(&rqtor->queues->pending);
-    QUEUE_INIT(&rqtor->queues->finished);
-
-    rqtor->qlocks = malloc(sizeof *rqtor->qlocks);
-    ASSERT_S(!pthread_mutex_init(&rqtor->qlocks->recycling, NULL),
-             "Couldn't initialize requestor's recycling queue mutex");
-    ASSERT_S(!pthread_mutex_init(&rqtor->qlocks->pending, NULL),
-             "Couldn't initialize requestor's pending queue mutex");
-    ASSERT_S(!pthread_mutex_init(&rqtor->qlocks->finished, NULL),
-             "Couldn't initialize requestor's finished queue mutex");
+    rqtor->pending = NULL;
+    rqtor->wakeup_pending = false;
+
+    if (rqtor != first) {
+        /* every `REST` thread hands its requests over to the same queues */
+        rqtor->queues = first->queues;
+        rqtor->qlocks = first->qlocks;
+        rqtor->retry = first->retry;
+        rqtor->cache = first->cache;
+    }
+    else {
+        /* queues are malloc'd to guarantee a client cloned by
+         * winecord_clone() will share the same queue with the original */
+        rqtor->queues = malloc(sizeof *rqtor->queues);
+        QUEUE_INIT(&rqtor->queues->recycling);
+        QUEUE_INIT(&rqtor->queues->finished);
+        for (int i = 0; i < WINECORD_LANES_MAX; ++i) {
+            struct winecord_lane *lane = rqtor->queues->lanes + i;
+
+            QUEUE_INIT(&lane->finished);
+            lane->is_busy = false;
+            ASSERT_S(!pthread_mutex_init(&lane->lock, NULL),
+                     "Couldn't initialize requestor's lane mutex");
+        }
+        rqtor->queues->has_stalled_lanes = false;
+
+        rqtor->qlocks = malloc(sizeof *rqtor->qlocks);
+        ASSERT_S(!pthread_mutex_init(&rqtor->qlocks->recycling, NULL),
+                 "Couldn't initialize requestor's recycling queue mutex");
+        ASSERT_S(!pthread_mutex_init(&rqtor->qlocks->pending, NULL),
+                 "Couldn't initialize requestor's pending queue mutex");
+        ASSERT_S(!pthread_mutex_init(&rqtor->qlocks->finished, NULL),
+                 "Couldn't initialize requestor's finished queue mutex");
+
+        rqtor->retry = malloc(sizeof *rqtor->retry);
+        winecord_retry_init(rqtor->retry, &rqtor->conf);
+    }
 
     rqtor->mhandle = curl_multi_init();
-    rqtor->retry_limit = 3; /* FIXME: shouldn't be a hard limit */
+    rqtor->timeout = -1;
+    memset(&rqtor->conns, 0, sizeof(rqtor->conns));
+    memset(&rqtor->aimd, 0, sizeof(rqtor->aimd));
+    rqtor->aimd.limit = WINECORD_AIMD_INITIAL;
+    curl_multi_setopt(rqtor->mhandle, CURLMOPT_SOCKETFUNCTION,
+                      &_winecord_on_curl_socket);
+    curl_multi_setopt(rqtor->mhandle, CURLMOPT_SOCKETDATA, rqtor);
+    curl_multi_setopt(rqtor->mhandle, CURLMOPT_TIMERFUNCTION,
+                      &_winecord_on_curl_timer);
+    curl_multi_setopt(rqtor->mhandle, CURLMOPT_TIMERDATA, rqtor);
 
     winecord_ratelimiter_init(&rqtor->ratelimiter, &rqtor->conf);
+    __chash_init(&rqtor->singleflight, SINGLEFLIGHT_TABLE);
 }
 
 void
 winecord_requestor_cleanup(struct winecord_requestor *rqtor)
 {
-    struct winecord_rest *rest =
-        CONTAINEROF(rqtor, struct winecord_rest, requestor);
     QUEUE *const req_queues[] = { &rqtor->queues->recycling,
-                                  &rqtor->queues->pending,
                                   &rqtor->queues->finished };
+    struct _winecord_request_cache *cache;
+    struct winecord_request *req;
 
     /* cleanup ratelimiting handle */
     winecord_ratelimiter_cleanup(&rqtor->ratelimiter);
+    /* requests have been canceled by now */
+    __chash_free(&rqtor->singleflight, SINGLEFLIGHT_TABLE);
+
+    /* cleanup requests that haven't been assigned to a bucket yet */
+    while ((req = rqtor->pending) != NULL) {
+        rqtor->pending = req->next;
+        _winecord_request_cleanup(req);
+    }
+
+    /* cleanup warm-up transfers that are still in flight */
+    for (int i = 0; i < WINECORD_WARM_MAX; ++i) {
+        if (!rqtor->conns.warming[i]) continue;
+        curl_multi_remove_handle(rqtor->mhandle, rqtor->conns.warming[i]);
+        curl_easy_cleanup(rqtor->conns.warming[i]);
+    }
+    /* cleanup curl's multi handle (its sockets are removed from the poller) */
+    curl_multi_cleanup(rqtor->mhandle);
+    /* cleanup User-Agent handle */
+    ua_cleanup(rqtor->ua);
+
+    /* shared state is owned by the first `REST` thread */
+    if (rqtor != &REST_SHARD(rqtor)->rest->shards->requestor) return;
+
+    /* cleanup retry policies */
+    winecord_retry_cleanup(rqtor->retry);
+    free(rqtor->retry);
+    /* cleanup response cache */
+    if (rqtor->cache) {
+        winecord_rest_cache_cleanup(rqtor->cache);
+        free(rqtor->cache);
+    }
+    /* cleanup calling thread's cached requests, if it keeps any */
+    if ((cache = _winecord_request_cache_get()) != NULL)
+        _winecord_request_cache_flush(rqtor, cache, cache->size);
 
     /* cleanup queues */
     for (size_t i = 0; i < sizeof(req_queues) / sizeof *req_queues; ++i) {
         QUEUE(struct winecord_request) queue, *qelem;
-        struct winecord_request *req;
 
         QUEUE_MOVE(req_queues[i], &queue);
         while (!QUEUE_EMPTY(&queue)) {
@@ -91,6 +439,20 @@ winecord_requestor_cleanup(struct winecord_requestor *rqtor)
             _winecord_request_cleanup(req);
         }
     }
+    /* cleanup lanes, their workers have been joined by now */
+    for (int i = 0; i < WINECORD_LANES_MAX; ++i) {
+        struct winecord_lane *lane = rqtor->queues->lanes + i;
+
+        while (!QUEUE_EMPTY(&lane->finished)) {
+            QUEUE(struct winecord_request) *qelem =
+                QUEUE_HEAD(&lane->finished);
+
+            QUEUE_REMOVE(qelem);
+            req = QUEUE_DATA(qelem, struct winecord_request, entry);
+            _winecord_request_cleanup(req);
+        }
+        pthread_mutex_destroy(&lane->lock);
+    }
     free(rqtor->queues);
 
     /* cleanup queue locks */
@@ -98,12 +460,55 @@ winecord_requestor_cleanup(struct winecord_requestor *rqtor)
     pthread_mutex_destroy(&rqtor->qlocks->pending);
     pthread_mutex_destroy(&rqtor->qlocks->finished);
     free(rqtor->qlocks);
+}
 
-    /* cleanup curl's multi handle */
-    io_poller_curlm_del(rest->io_poller, rqtor->mhandle);
-    curl_multi_cleanup(rqtor->mhandle);
-    /* cleanup User-Agent handle */
-    ua_cleanup(rqtor->ua);
+/** @brief Read cursor of a multipart's part that is streamed to curl */
+struct _winecord_mime_stream {
+    /** the part's content */
+    const char *start;
+    /** the part's content size in bytes */
+    size_t size;
+    /** amount of bytes read so far */
+    size_t pos;
+};
+
+static size_t
+_winecord_mime_stream_read(char *buf, size_t size, size_t nitems, void *p)
+{
+    struct _winecord_mime_stream *stream = p;
+    size_t len = size * nitems;
+
+    if (len > stream->size - stream->pos) len = stream->size - stream->pos;
+    memcpy(buf, stream->start + stream->pos, len);
+    stream->pos += len;
+
+    return len;
+}
+
+static int
+_winecord_mime_stream_seek(void *p, curl_off_t offset, int origin)
+{
+    struct _winecord_mime_stream *stream = p;
+
+    if (origin != SEEK_SET || offset < 0 || (size_t)offset > stream->size)
+        return CURL_SEEKFUNC_CANTSEEK;
+    stream->pos = (size_t)offset;
+
+    return CURL_SEEKFUNC_OK;
+}
+
+/* have curl read the part's content straight from the request as it is
+ *      uploaded, rather than keeping a copy of its own */
+static void
+_winecord_mime_stream(curl_mimepart *part, const char *start, size_t size)
+{
+    struct _winecord_mime_stream *stream = malloc(sizeof *stream);
+
+    stream->start = start;
+    stream->size = size;
+    stream->pos = 0;
+    curl_mime_data_cb(part, (curl_off_t)size, &_winecord_mime_stream_read,
+                      &_winecord_mime_stream_seek, &free, stream);
 }
 
 static void
@@ -116,7 +521,7 @@ _winecord_request_to_multipart(curl_mime *mime, void *p_req)
     /* json part */
     if (req->body.start && req->body.size) {
         part = curl_mime_addpart(mime);
-        curl_mime_data(part, req->body.start, req->body.size);
+        _winecord_mime_stream(part, req->body.start, req->body.size);
         curl_mime_type(part, "application/json");
         curl_mime_name(part, "payload_json");
     }
@@ -129,10 +534,8 @@ _winecord_request_to_multipart(curl_mime *mime, void *p_req)
 
         if (req->attachments.array[i].content) {
             part = curl_mime_addpart(mime);
-            curl_mime_data(part, req->attachments.array[i].content,
-                           req->attachments.array[i].size
-                               ? req->attachments.array[i].size
-                               : CURL_ZERO_TERMINATED);
+            _winecord_mime_stream(part, req->attachments.array[i].content,
+                                  req->attachments.array[i].size);
             curl_mime_filename(part, !req->attachments.array[i].filename
                                          ? "a.out"
                                          : req->attachments.array[i].filename);
@@ -164,6 +567,13 @@ _winecord_request_to_multipart(curl_mime *mime, void *p_req)
     }
 }
 
+static struct ua_szbuf_readonly
+_winecord_request_get_body(struct winecord_request *req)
+{
+    return (struct ua_szbuf_readonly){ req->recv.body.start,
+                                       req->recv.body.size };
+}
+
 static bool
 _winecord_request_info_extract(struct winecord_requestor *rqtor,
                               struct winecord_request *req,
@@ -177,6 +587,9 @@ _winecord_request_info_extract(struct winecord_requestor *rqtor,
     }
 
     switch (info->httpcode) {
+    case HTTP_NOT_MODIFIED: /* cached response has been revalidated */
+        req->code = WINEBERRY_OK;
+        return false;
     case HTTP_FORBIDDEN:
     case HTTP_NOT_FOUND:
     case HTTP_BAD_REQUEST:
@@ -196,7 +609,7 @@ _winecord_request_info_extract(struct winecord_requestor *rqtor,
         req->code = info->code;
         return false;
     case HTTP_TOO_MANY_REQUESTS: {
-        struct ua_szbuf_readonly body = ua_info_get_body(info);
+        struct ua_szbuf_readonly body = _winecord_request_get_body(req);
         struct jsmnftok message = { 0 };
         u64unix_ms retry_after_ms = 1000;
         bool is_global = false;
@@ -233,6 +646,22 @@ _winecord_request_info_extract(struct winecord_requestor *rqtor,
                      is_global ? "GLOBAL " : "", retry_after_ms, message.len,
                      body.start + message.pos);
 
+        if (is_global) {
+            __atomic_fetch_add(&req->b->metrics.ratelimited.global, 1,
+                               __ATOMIC_RELAXED);
+        }
+        else {
+            struct ua_szbuf_readonly scope =
+                ua_info_get_header(info, "x-ratelimit-scope");
+
+            if (scope.size == 6 && 0 == strncmp(scope.start, "shared", 6))
+                __atomic_fetch_add(&req->b->metrics.ratelimited.shared, 1,
+                                   __ATOMIC_RELAXED);
+            else
+                __atomic_fetch_add(&req->b->metrics.ratelimited.bucket, 1,
+                                   __ATOMIC_RELAXED);
+        }
+
         if (is_global)
             winecord_ratelimiter_set_global_timeout(&rqtor->ratelimiter, req->b,
                                                    retry_after_ms);
@@ -248,18 +677,182 @@ _winecord_request_info_extract(struct winecord_requestor *rqtor,
     }
 }
 
-void
-winecord_request_cancel(struct winecord_requestor *rqtor,
-                       struct winecord_request *req)
+/* whether request is eligible for sharing an identical request's response */
+static bool
+_winecord_request_can_coalesce(const struct winecord_request *req)
+{
+    /* synchronous requests expect to be performed on-spot, elements
+     *      streamed to the `item` callback aren't kept for sharing, and a
+     *      request skipping the cache can't share an older request's
+     *      response either */
+    return HTTP_GET == req->method && !req->dispatch.sync
+           && !req->dispatch.item && !req->dispatch.skip_cache;
+}
+
+/* whether request would be held back by waiting at the leader's place in its
+ *      bucket, for having a higher class or an earlier deadline */
+static bool
+_winecord_request_is_stricter(const struct winecord_request *req,
+                             const struct winecord_request *leader)
+{
+    const int class_req = winecord_request_get_class(req),
+              class_leader = winecord_request_get_class(leader);
+
+    if (class_req != class_leader) return class_req > class_leader;
+    return req->deadline
+           && (!leader->deadline || req->deadline < leader->deadline);
+}
+
+/* attach request to an identical in-flight request, or become the one
+ *      others attach to */
+static bool
+_winecord_request_coalesce(struct winecord_requestor *rqtor,
+                          struct winecord_request *req)
+{
+    struct _winecord_inflight *inflight;
+    struct winecord_request *leader;
+    int ret;
+
+    if (!_winecord_request_can_coalesce(req)) return false;
+
+    ret = chash_contains(&rqtor->singleflight, req->endpoint, ret,
+                         SINGLEFLIGHT_TABLE);
+    if (!ret) {
+        chash_assign(&rqtor->singleflight, req->endpoint, req,
+                     SINGLEFLIGHT_TABLE);
+        return false;
+    }
+
+    inflight = chash_lookup_bucket(&rqtor->singleflight, req->endpoint,
+                                   inflight, SINGLEFLIGHT_TABLE);
+    leader = inflight->value;
+    /* a leader that is still waiting at its bucket is taken over by the
+     *      stricter request, and attached to it along with its followers */
+    if (leader->is_queued && _winecord_request_is_stricter(req, leader))
+    {
+        winecord_bucket_remove(leader->b, leader);
+        leader->b->has_new_head = true;
+        leader->b = NULL;
+
+        req->followers = leader->followers;
+        leader->followers = NULL;
+        leader->next = req->followers;
+        req->followers = leader;
+
+        inflight->key = req->endpoint;
+        inflight->value = req;
+
+        logconf_trace(&rqtor->conf,
+                      "Coalesced request to [%s] takes over (key: %s)",
+                      req->endpoint, req->key);
+
+        return false;
+    }
+
+    req->next = leader->followers;
+    leader->followers = req;
+
+    logconf_trace(&rqtor->conf, "Coalesced request to [%s] (key: %s)",
+                  req->endpoint, req->key);
+
+    return true;
+}
+
+/* stop accepting followers, so a request can be safely recycled */
+static void
+_winecord_request_uncoalesce(struct winecord_requestor *rqtor,
+                            struct winecord_request *req)
+{
+    struct winecord_request *leader;
+    int ret;
+
+    if (!_winecord_request_can_coalesce(req)) return;
+
+    ret = chash_contains(&rqtor->singleflight, req->endpoint, ret,
+                         SINGLEFLIGHT_TABLE);
+    if (!ret) return;
+
+    leader = chash_lookup(&rqtor->singleflight, req->endpoint, leader,
+                          SINGLEFLIGHT_TABLE);
+    if (leader == req)
+        chash_delete(&rqtor->singleflight, req->endpoint, SINGLEFLIGHT_TABLE);
+}
+
+/* drop the references held to shared contents, and free the copied ones */
+static void
+_winecord_attachments_release(struct winecord_refcounter *rc,
+                             struct winecord_attachments *attachments)
+{
+    for (int i = 0; i < attachments->size; ++i)
+        if (attachments->array[i].content
+            && WINEBERRY_OK
+                   == winecord_refcounter_decr(rc,
+                                              attachments->array[i].content))
+            attachments->array[i].content = NULL;
+    winecord_attachments_cleanup(attachments);
+}
+
+/* stop one of a hedged request's transfers */
+static void
+_winecord_request_hedge_stop(struct winecord_request *req,
+                            struct ua_conn *conn)
+{
+    if (NOT_EMPTY_STR(req->reason))
+        ua_conn_remove_header(conn, "X-Audit-Log-Reason");
+    ua_conn_stop(conn);
+}
+
+/* cleanup the list elements decoded for the `item` callback */
+static void
+_winecord_request_items_discard(struct winecord_request *req)
+{
+    struct ccord_szbuf_reusable *items = &req->recv.items;
+
+    if (req->response.item.cleanup)
+        for (size_t i = 0; i < items->size; i += req->response.item.size)
+            req->response.item.cleanup(items->start + i);
+    items->size = 0;
+}
+
+/* hand the list elements over to the `item` callback, in the order they
+ *      have been received */
+static void
+_winecord_request_items_dispatch(struct winecord_request *req,
+                                 struct winecord_response *resp)
 {
-    struct winecord_refcounter *rc = &CLIENT(rqtor, rest.requestor)->refcounter;
+    struct winecord *client = REQUESTOR_CLIENT(req->rqtor);
+    struct ccord_szbuf_reusable *items = &req->recv.items;
+
+    for (size_t i = 0; i < items->size; i += req->response.item.size)
+        req->dispatch.item(client, resp, items->start + i);
+    _winecord_request_items_discard(req);
+}
 
+/* reset request and enqueue it for recycle
+ * @note may be called from any thread, so it must not have followers left */
+static void
+_winecord_request_release(struct winecord_requestor *rqtor,
+                          struct winecord_request *req)
+{
+    struct winecord_refcounter *rc = &REQUESTOR_CLIENT(rqtor)->refcounter;
+
+    /* pending duplicates are deleted along with their timers, or once the
+     *      request completes */
+    req->hedge.timer = 0;
+    if (req->hedge.conn) {
+        curl_multi_remove_handle(rqtor->mhandle,
+                                 ua_conn_get_easy_handle(req->hedge.conn));
+        _winecord_request_hedge_stop(req, req->hedge.conn);
+        req->hedge.conn = NULL;
+    }
     if (NOT_EMPTY_STR(req->reason)) {
-        ua_conn_remove_header(req->conn, "X-Audit-Log-Reason");
+        if (req->conn) ua_conn_remove_header(req->conn, "X-Audit-Log-Reason");
         free(req->reason);
         req->reason = NULL;
     }
     if (req->conn) {
+        if (req->is_revalidating)
+            ua_conn_remove_header(req->conn, "If-None-Match");
         ua_conn_stop(req->conn);
     }
     if (req->dispatch.keep) {
@@ -268,94 +861,708 @@ winecord_request_cancel(struct winecord_requestor *rqtor,
     if (req->dispatch.data) {
         winecord_refcounter_decr(rc, req->dispatch.data);
     }
+    if (req->future) {
+        winecord_future_complete(req->future, WINEBERRY_WINECORD_CANCELED,
+                                 NULL);
+        winecord_future_dispatch(req->future);
+        req->future = NULL;
+    }
 
     req->body.size = 0;
     req->method = 0;
     *req->endpoint = '\0';
     *req->key = '\0';
     req->conn = NULL;
+    req->route = NULL;
+    /* a request canceled while queued is dropped from its bucket */
+    if (req->is_queued) winecord_bucket_remove(req->b, req);
+    req->deadline = 0;
+    req->is_revalidating = false;
+    req->recv.is_streaming = false;
+    _winecord_request_items_discard(req);
     req->retry_attempt = 0;
-    winecord_attachments_cleanup(&req->attachments);
+    _winecord_attachments_release(rc, &req->attachments);
     memset(req, 0, sizeof(struct winecord_attributes));
 
     QUEUE_REMOVE(&req->entry);
-    pthread_mutex_lock(&rqtor->qlocks->recycling);
-    QUEUE_INSERT_TAIL(&rqtor->queues->recycling, &req->entry);
-    pthread_mutex_unlock(&rqtor->qlocks->recycling);
+    QUEUE_INIT(&req->entry);
+    _winecord_request_recycle(rqtor, req);
+}
+
+static WINEBERRY _winecord_request_dispatch_response(
+    struct winecord_requestor *rqtor, struct winecord_request *req);
+
+void
+winecord_request_cancel(struct winecord_requestor *rqtor,
+                       struct winecord_request *req)
+{
+    struct winecord_request *follower;
+
+    /* followers were waiting on a request that won't be completed */
+    _winecord_request_uncoalesce(rqtor, req);
+    while ((follower = req->followers) != NULL) {
+        req->followers = follower->next;
+        follower->next = NULL;
+
+        follower->code = WINEBERRY_WINECORD_CANCELED;
+        if (follower->future)
+            winecord_future_complete(follower->future, follower->code, NULL);
+        _winecord_request_dispatch_response(rqtor, follower);
+    }
+    _winecord_request_release(rqtor, req);
 }
 
 static WINEBERRY
 _winecord_request_dispatch_response(struct winecord_requestor *rqtor,
                                    struct winecord_request *req)
 {
-    struct winecord *client = CLIENT(rqtor, rest.requestor);
+    struct winecord *client = REQUESTOR_CLIENT(rqtor);
     struct winecord_response resp = { .data = req->dispatch.data,
                                      .keep = req->dispatch.keep,
                                      .code = req->code };
+    /* requests made from the callbacks share the request's tenant */
+    const u64snowflake tenant =
+        winecord_tenant_context_swap(req->dispatch.tenant);
 
     if (req->code != WINEBERRY_OK) {
         if (req->dispatch.fail) req->dispatch.fail(client, &resp);
     }
-    else if (req->dispatch.done.typed) {
-        if (!req->dispatch.has_type) {
-            req->dispatch.done.typeless(client, &resp);
+    else {
+        if (req->recv.items.size) _winecord_request_items_dispatch(req, &resp);
+
+        if (req->dispatch.done.typed) {
+            if (!req->dispatch.has_type) {
+                req->dispatch.done.typeless(client, &resp);
+            }
+            else {
+                req->dispatch.done.typed(client, &resp, req->response.data);
+                winecord_refcounter_decr(&client->refcounter,
+                                         req->response.data);
+            }
         }
-        else {
-            req->dispatch.done.typed(client, &resp, req->response.data);
+        else if (req->dispatch.has_type && req->response.data) {
+            /* no callback to hand the datatype over to */
             winecord_refcounter_decr(&client->refcounter, req->response.data);
         }
     }
-    /* enqueue request for recycle */
-    winecord_request_cancel(rqtor, req);
+    if (req->future) {
+        winecord_future_dispatch(req->future);
+        req->future = NULL;
+    }
+    winecord_tenant_context_swap(tenant);
+    /* enqueue request for recycle, its followers have been handed its
+     *      outcome by the `REST` thread */
+    _winecord_request_release(rqtor, req);
 
     return resp.code;
 }
 
+static void
+_winecord_request_worker_cb(void *p_req)
+{
+    struct winecord_request *req = p_req;
+
+    _winecord_request_dispatch_response(req->rqtor, req);
+}
+
+/* execute a lane's callbacks in order, until it has none left */
+static void
+_winecord_lane_worker_cb(void *p_lane)
+{
+    struct winecord_lane *lane = p_lane;
+    QUEUE(struct winecord_request) *qelem;
+    struct winecord_request *req;
+    struct winecord_requestor *rqtor = NULL;
+    bool is_cache_owner = false;
+
+    while (1) {
+        pthread_mutex_lock(&lane->lock);
+        if (QUEUE_EMPTY(&lane->finished)) {
+            lane->is_busy = false;
+            pthread_mutex_unlock(&lane->lock);
+            break;
+        }
+        qelem = QUEUE_HEAD(&lane->finished);
+        QUEUE_REMOVE(qelem);
+        QUEUE_INIT(qelem);
+        pthread_mutex_unlock(&lane->lock);
+
+        req = QUEUE_DATA(qelem, struct winecord_request, entry);
+        if (!rqtor) {
+            /* requests are cached for as long as the lane has callbacks
+             *      left */
+            rqtor = req->rqtor;
+            is_cache_owner = _winecord_request_cache_begin();
+        }
+        _winecord_request_dispatch_response(req->rqtor, req);
+    }
+    if (rqtor) _winecord_request_cache_end(rqtor, is_cache_owner);
+}
+
+/* assign a worker to the lane, unless it already has one */
+static void
+_winecord_lane_assign(struct winecord_requestor *rqtor,
+                      struct winecord_lane *lane)
+{
+    bool is_busy;
+
+    pthread_mutex_lock(&lane->lock);
+    is_busy = lane->is_busy || QUEUE_EMPTY(&lane->finished);
+    if (!is_busy) lane->is_busy = true;
+    pthread_mutex_unlock(&lane->lock);
+
+    if (is_busy) return;
+
+    if (WINEBERRY_OK
+        != winecord_worker_add(REQUESTOR_CLIENT(rqtor),
+                              &_winecord_lane_worker_cb, lane))
+    {
+        /* threadpool is full, try again from the main thread */
+        pthread_mutex_lock(&lane->lock);
+        lane->is_busy = false;
+        pthread_mutex_unlock(&lane->lock);
+        __atomic_store_n(&rqtor->queues->has_stalled_lanes, true,
+                         __ATOMIC_RELEASE);
+    }
+}
+
+/* push request to its lane, requests of the same channel, guild or webhook
+ *      share a lane by default */
+static void
+_winecord_lane_push(struct winecord_requestor *rqtor,
+                    struct winecord_request *req)
+{
+    const unsigned long hash = req->dispatch.lane
+                                   ? (unsigned long)req->dispatch.lane
+                                   : winecord_ratelimiter_hash_major(req->key);
+    struct winecord_lane *lane =
+        rqtor->queues->lanes + hash % WINECORD_LANES_MAX;
+
+    pthread_mutex_lock(&lane->lock);
+    QUEUE_INSERT_TAIL(&lane->finished, &req->entry);
+    pthread_mutex_unlock(&lane->lock);
+
+    _winecord_lane_assign(rqtor, lane);
+}
+
 void
 winecord_requestor_dispatch_responses(struct winecord_requestor *rqtor)
 {
+    if (__atomic_exchange_n(&rqtor->queues->has_stalled_lanes, false,
+                            __ATOMIC_ACQ_REL))
+        for (int i = 0; i < WINECORD_LANES_MAX; ++i)
+            _winecord_lane_assign(rqtor, rqtor->queues->lanes + i);
+
     if (0 == pthread_mutex_trylock(&rqtor->qlocks->finished)) {
         QUEUE(struct winecord_request) queue;
         QUEUE_MOVE(&rqtor->queues->finished, &queue);
         pthread_mutex_unlock(&rqtor->qlocks->finished);
 
         if (!QUEUE_EMPTY(&queue)) {
-            struct winecord_rest *rest =
-                CONTAINEROF(rqtor, struct winecord_rest, requestor);
+            struct winecord_rest *rest = REST_SHARD(rqtor)->rest;
+            const bool is_cache_owner = _winecord_request_cache_begin();
             QUEUE(struct winecord_request) * qelem;
             struct winecord_request *req;
 
             do {
                 qelem = QUEUE_HEAD(&queue);
                 req = QUEUE_DATA(qelem, struct winecord_request, entry);
-                _winecord_request_dispatch_response(rqtor, req);
+                _winecord_request_dispatch_response(req->rqtor, req);
             } while (!QUEUE_EMPTY(&queue));
-            io_poller_wakeup(rest->io_poller);
+            _winecord_request_cache_end(rqtor, is_cache_owner);
+            /* finished requests are shared by every `REST` thread */
+            for (int i = 0; i < rest->n_shards; ++i)
+                io_poller_wakeup(rest->shards[i].io_poller);
         }
     }
 }
 
+static void _winecord_request_finish(struct winecord_requestor *rqtor,
+                                    struct winecord_request *req);
+
+/* whether request expects a response datatype to be populated */
 static bool
-_winecord_request_retry(struct winecord_requestor *rqtor,
-                       struct winecord_request *req)
+_winecord_request_has_response(const struct winecord_request *req)
 {
-    if (req->retry_attempt++ >= rqtor->retry_limit) return false;
+    return req->dispatch.has_type && req->dispatch.sync != WINECORD_SYNC_FLAG;
+}
 
-    ua_conn_reset(req->conn);
-    winecord_bucket_insert(&rqtor->ratelimiter, req->b, req, true);
+/* assign request's response datatype, if not yet assigned */
+static void
+_winecord_request_response_init(struct winecord_request *req)
+{
+    if (req->response.data) return;
 
-    return true;
+    if (req->dispatch.sync) {
+        req->response.data = req->dispatch.sync;
+    }
+    else {
+        req->response.data = calloc(1, req->response.size);
+        winecord_refcounter_add_internal(
+            &REQUESTOR_CLIENT(req->rqtor)->refcounter,
+            req->response.data, req->response.cleanup, true);
+    }
+    if (req->response.init) req->response.init(req->response.data);
 }
 
-WINEBERRY
-winecord_requestor_info_read(struct winecord_requestor *rqtor)
+/* discard response datatype that has been partially populated */
+static void
+_winecord_request_response_discard(struct winecord_request *req)
 {
-    int alive = 0;
+    if (!req->response.data) return;
 
-    if (CURLM_OK != curl_multi_socket_all(rqtor->mhandle, &alive))
-        return WINEBERRY_CURLM_INTERNAL;
-
-    while (1) {
+    if (req->response.data == req->dispatch.sync) {
+        if (req->response.cleanup) req->response.cleanup(req->response.data);
+        memset(req->response.data, 0, req->response.size);
+    }
+    else {
+        winecord_refcounter_decr(
+            &REQUESTOR_CLIENT(req->rqtor)->refcounter,
+            req->response.data);
+    }
+    req->response.data = NULL;
+}
+
+/* populate request's response datatype */
+static void
+_winecord_request_parse(struct winecord_request *req,
+                       const char json[],
+                       size_t length)
+{
+    if (!_winecord_request_has_response(req)) return;
+
+    _winecord_request_response_init(req);
+    if (req->response.from_json)
+        req->response.from_json(json, length, req->response.data);
+}
+
+static struct winecord_rest_cache *
+_winecord_response_cache_get(struct winecord_requestor *rqtor,
+                             struct winecord_request *req)
+{
+    if (HTTP_GET != req->method || !req->route) return NULL;
+    /* cache may be enabled concurrently from another thread */
+    return __atomic_load_n(&rqtor->cache, __ATOMIC_ACQUIRE);
+}
+
+/* serve request from cache, without going through its bucket */
+static bool
+_winecord_response_cache_serve(struct winecord_requestor *rqtor,
+                               struct winecord_request *req)
+{
+    struct winecord_rest_cache *cache =
+        _winecord_response_cache_get(rqtor, req);
+    struct ccord_szbuf body = { 0 };
+
+    /* a cached response may still be revalidated once the request is sent */
+    if (!cache || req->dispatch.skip_cache
+        || !winecord_rest_cache_find(cache, req->endpoint, &body))
+        return false;
+
+    logconf_trace(&rqtor->conf, "Cache hit for [%s]", req->endpoint);
+
+    req->code = WINEBERRY_OK;
+    _winecord_request_parse(req, body.start, body.size);
+    free(body.start);
+    _winecord_request_finish(rqtor, req);
+
+    return true;
+}
+
+/* ask for the server to only send a response if it has been modified */
+static void
+_winecord_response_cache_prepare(struct winecord_requestor *rqtor,
+                                 struct winecord_request *req)
+{
+    struct winecord_rest_cache *cache =
+        _winecord_response_cache_get(rqtor, req);
+    char etag[128];
+
+    if (cache
+        && winecord_rest_cache_get_etag(cache, req->endpoint, etag,
+                                       sizeof(etag)))
+    {
+        ua_conn_add_header(req->conn, "If-None-Match", etag);
+        req->is_revalidating = true;
+    }
+}
+
+/* store a successful response, or retrieve a revalidated one (return `false`
+ *      if it has been dropped meanwhile and request must be retried), or
+ *      drop the responses a successful write has outdated */
+static bool
+_winecord_response_cache_update(struct winecord_requestor *rqtor,
+                                struct winecord_request *req,
+                                struct ua_info *info,
+                                struct ua_szbuf_readonly *body,
+                                struct ccord_szbuf *cached)
+{
+    struct winecord_rest_cache *cache =
+        _winecord_response_cache_get(rqtor, req);
+
+    if (HTTP_GET != req->method) {
+        /* responses of the resource that has been written are outdated */
+        if ((cache = __atomic_load_n(&rqtor->cache, __ATOMIC_ACQUIRE)))
+            winecord_rest_cache_on_write(cache, req->endpoint);
+        return true;
+    }
+    /* streamed responses aren't kept whole */
+    if (!cache || req->recv.is_streaming) return true;
+
+    if (HTTP_NOT_MODIFIED == info->httpcode) {
+        if (!winecord_rest_cache_revalidate(cache, req->route, req->endpoint,
+                                           cached))
+            return false;
+
+        body->start = cached->start;
+        body->size = cached->size;
+    }
+    else {
+        struct ua_szbuf_readonly etag = ua_info_get_header(info, "etag");
+
+        winecord_rest_cache_store(cache, req->route, req->endpoint, body,
+                                 &etag);
+    }
+    return true;
+}
+
+/* whether a transport error may go away once the request is retried */
+static bool
+_winecord_request_is_transient(const struct winecord_request *req,
+                               CURLcode ecode)
+{
+    switch (ecode) {
+    /* the request couldn't have reached the server */
+    case CURLE_COULDNT_RESOLVE_HOST:
+    case CURLE_COULDNT_CONNECT:
+    case CURLE_READ_ERROR:
+        return true;
+    /* the request may have been acted upon by the server, so only the ones
+     *      that can be repeated are retried */
+    case CURLE_OPERATION_TIMEDOUT:
+    case CURLE_SEND_ERROR:
+    case CURLE_RECV_ERROR:
+    case CURLE_GOT_NOTHING:
+    case CURLE_PARTIAL_FILE:
+    case CURLE_HTTP2:
+    case CURLE_HTTP2_STREAM:
+        return req->method != HTTP_POST && req->method != HTTP_MIMEPOST;
+    default:
+        return false;
+    }
+}
+
+/* stop accepting followers and hand request's outcome over to them */
+static void
+_winecord_request_finish_followers(struct winecord_requestor *rqtor,
+                                  struct winecord_request *req)
+{
+    struct winecord_refcounter *rc = &REQUESTOR_CLIENT(rqtor)->refcounter;
+    /* the outcome is specific to the request, rather than its endpoint */
+    const bool is_requeued = (WINEBERRY_WINECORD_DEADLINE == req->code
+                              || WINEBERRY_WINECORD_CANCELED == req->code);
+    struct winecord_request *follower;
+
+    _winecord_request_uncoalesce(rqtor, req);
+    while ((follower = req->followers) != NULL) {
+        req->followers = follower->next;
+        follower->next = NULL;
+
+        if (is_requeued) {
+            /* the first follower becomes the new leader */
+            if (!_winecord_request_coalesce(rqtor, follower))
+                winecord_bucket_insert(
+                    &rqtor->ratelimiter,
+                    winecord_bucket_get(&rqtor->ratelimiter, follower->key),
+                    follower, false);
+            continue;
+        }
+
+        follower->code = req->code;
+        if (WINEBERRY_OK == req->code && follower->dispatch.has_type
+            && req->response.data)
+        {
+            /* follower has its own reference to the shared datatype */
+            follower->response.data = req->response.data;
+            winecord_refcounter_incr(rc, follower->response.data);
+        }
+        _winecord_request_finish(rqtor, follower);
+    }
+}
+
+/* hand the request over to the executor of its callbacks */
+static void
+_winecord_request_execute(struct winecord_requestor *rqtor,
+                          struct winecord_request *req)
+{
+    enum winecord_executor executor = req->dispatch.executor;
+
+    if (WINECORD_EXECUTOR_DEFAULT == executor)
+        executor = __atomic_load_n(&REST_SHARD(rqtor)->rest->executor,
+                                   __ATOMIC_RELAXED);
+
+    switch (executor) {
+    case WINECORD_EXECUTOR_WORKER:
+        if (WINEBERRY_OK
+            == winecord_worker_add(REQUESTOR_CLIENT(rqtor),
+                                  &_winecord_request_worker_cb, req))
+            return;
+        /* threadpool is full, fallback to the main thread */
+        break;
+    case WINECORD_EXECUTOR_LANES:
+        _winecord_lane_push(rqtor, req);
+        return;
+    case WINECORD_EXECUTOR_DEFAULT:
+    case WINECORD_EXECUTOR_MAIN:
+    default:
+        break;
+    }
+
+    pthread_mutex_lock(&rqtor->qlocks->finished);
+    QUEUE_INSERT_TAIL(&rqtor->queues->finished, &req->entry);
+    pthread_mutex_unlock(&rqtor->qlocks->finished);
+}
+
+/* wake up whoever is waiting on the request's completion */
+static void
+_winecord_request_finish(struct winecord_requestor *rqtor,
+                        struct winecord_request *req)
+{
+    _winecord_request_finish_followers(rqtor, req);
+
+    if (req->future)
+        winecord_future_complete(
+            req->future, req->code,
+            WINEBERRY_OK == req->code ? req->response.data : NULL);
+
+    if (req->dispatch.sync) {
+        pthread_mutex_lock(&rqtor->qlocks->pending);
+        pthread_cond_signal(req->cond);
+        pthread_mutex_unlock(&rqtor->qlocks->pending);
+    }
+    else {
+        _winecord_request_execute(rqtor, req);
+    }
+}
+
+void
+winecord_request_fail(struct winecord_requestor *rqtor,
+                      struct winecord_request *req,
+                      WINEBERRYcode code)
+{
+    winecord_bucket_remove(req->b, req);
+    req->b = NULL;
+    req->code = code;
+    _winecord_request_finish(rqtor, req);
+}
+
+int64_t
+winecord_requestor_get_next_trigger(struct winecord_requestor *rqtor,
+                                   int64_t now,
+                                   int64_t max_time)
+{
+    if (-1 == rqtor->timeout) return max_time;
+    if (rqtor->timeout <= now) return 0;
+    return (rqtor->timeout - now < max_time) ? rqtor->timeout - now
+                                             : max_time;
+}
+
+/* keep track of whether the transfer had to open a connection */
+static void
+_winecord_requestor_count_connects(struct winecord_requestor *rqtor,
+                                   CURL *ehandle)
+{
+    long n_connects = 0;
+
+    curl_easy_getinfo(ehandle, CURLINFO_NUM_CONNECTS, &n_connects);
+    __atomic_fetch_add(&rqtor->conns.transfers, 1, __ATOMIC_RELAXED);
+    if (!n_connects)
+        __atomic_fetch_add(&rqtor->conns.reused, 1, __ATOMIC_RELAXED);
+    else
+        __atomic_fetch_add(&rqtor->conns.handshakes, (uint64_t)n_connects,
+                           __ATOMIC_RELAXED);
+}
+
+static void
+_winecord_requestor_warm_done(struct winecord_requestor *rqtor,
+                              CURL *ehandle)
+{
+    long n_connects = 0;
+
+    curl_easy_getinfo(ehandle, CURLINFO_NUM_CONNECTS, &n_connects);
+    __atomic_fetch_add(&rqtor->conns.warm_handshakes, (uint64_t)n_connects,
+                       __ATOMIC_RELAXED);
+
+    for (int i = 0; i < WINECORD_WARM_MAX; ++i) {
+        if (rqtor->conns.warming[i] != ehandle) continue;
+        rqtor->conns.warming[i] = NULL;
+        break;
+    }
+    /* the connection is kept at the multi handle's connection pool */
+    curl_easy_cleanup(ehandle);
+}
+
+void
+winecord_requestor_warm(struct winecord_requestor *rqtor,
+                        int amount,
+                        bool force)
+{
+    const int64_t now =
+        (int64_t)winecord_timestamp_us(REQUESTOR_CLIENT(rqtor));
+
+    if (!force
+        && now - rqtor->conns.last_tstamp
+               < (int64_t)WINECORD_WARM_INTERVAL_MS * 1000)
+        return;
+
+    if (amount > WINECORD_WARM_MAX) amount = WINECORD_WARM_MAX;
+    for (int i = 0; i < WINECORD_WARM_MAX && amount > 0; ++i) {
+        CURL *ehandle;
+
+        if (rqtor->conns.warming[i]) {
+            --amount;
+            continue;
+        }
+
+        /* a cheap request that doesn't require authorization */
+        ehandle = curl_easy_init();
+        curl_easy_setopt(ehandle, CURLOPT_URL,
+                         WINECORD_API_BASE_URL "/gateway");
+        curl_easy_setopt(ehandle, CURLOPT_NOBODY, 1L);
+        curl_easy_setopt(ehandle, CURLOPT_TCP_KEEPALIVE, 1L);
+        /* open a connection of its own, rather than waiting to multiplex
+         *      over another warm-up's */
+        curl_easy_setopt(ehandle, CURLOPT_PIPEWAIT, 0L);
+        curl_easy_setopt(ehandle, CURLOPT_PRIVATE, NULL);
+        if (winecord_global_share())
+            curl_easy_setopt(ehandle, CURLOPT_SHARE, winecord_global_share());
+
+        rqtor->conns.warming[i] = ehandle;
+        curl_multi_add_handle(rqtor->mhandle, ehandle);
+        --amount;
+    }
+    rqtor->conns.last_tstamp = now;
+}
+
+/* adapt the limit of in-flight transfers to how healthy they are */
+static void
+_winecord_requestor_adapt(struct winecord_requestor *rqtor,
+                          int64_t now,
+                          int64_t elapsed,
+                          bool is_degraded)
+{
+    int limit = rqtor->aimd.limit;
+
+    --rqtor->aimd.in_flight;
+
+    /* a transfer much slower than usual hints at an overloaded server */
+    if (rqtor->aimd.latency && elapsed > WINECORD_AIMD_LATENCY_MIN_US
+        && elapsed > WINECORD_AIMD_TOLERANCE * rqtor->aimd.latency)
+        is_degraded = true;
+    /* exponential moving average, with a weight of 1/8 per transfer */
+    rqtor->aimd.latency = rqtor->aimd.latency
+                              ? rqtor->aimd.latency
+                                    + (elapsed - rqtor->aimd.latency) / 8
+                              : elapsed;
+
+    if (is_degraded) {
+        /* transfers sent before the previous cut degrade alongside it, so
+         *      the limit is cut at most once per round-trip */
+        if (now - rqtor->aimd.cut_tstamp < rqtor->aimd.latency) return;
+
+        limit /= 2;
+        if (limit < WINECORD_AIMD_MIN) limit = WINECORD_AIMD_MIN;
+        rqtor->aimd.cut_tstamp = now;
+        rqtor->aimd.healthy = 0;
+        logconf_debug(&rqtor->conf, "In-flight limit cut to %d", limit);
+    }
+    /* grow by one per round of `limit` healthy transfers */
+    else if (++rqtor->aimd.healthy >= limit && limit < WINECORD_AIMD_MAX) {
+        ++limit;
+        rqtor->aimd.healthy = 0;
+    }
+    __atomic_store_n(&rqtor->aimd.limit, limit, __ATOMIC_RELAXED);
+}
+
+/* cancel the request's duplicate, if it hasn't been sent yet */
+static void
+_winecord_request_hedge_unschedule(struct winecord_requestor *rqtor,
+                                  struct winecord_request *req)
+{
+    if (!req->hedge.timer) return;
+
+    _winecord_timer_ctl(REQUESTOR_CLIENT(rqtor), &REST_SHARD(rqtor)->timers,
+                       &(struct winecord_timer){
+                           .id = req->hedge.timer,
+                           .flags = WINECORD_TIMER_DELETE,
+                       });
+    req->hedge.timer = 0;
+}
+
+/*
+ * settle a hedged request once either of its transfers completes, the
+ *      first successful one is kept and the other is stopped
+ * @return `true` if the completed transfer has failed and is dropped in
+ *      favor of the one still in flight
+ */
+static bool
+_winecord_request_hedge_settle(struct winecord_requestor *rqtor,
+                              struct winecord_request *req,
+                              CURL *ehandle,
+                              CURLcode ecode)
+{
+    const bool is_hedge =
+        !req->conn || ehandle != ua_conn_get_easy_handle(req->conn);
+    struct ua_conn *other = is_hedge ? req->conn : req->hedge.conn;
+
+    if (other) {
+        /* the transfer that is dropped is accounted for here, the one kept
+         *      is accounted for by _winecord_requestor_adapt() */
+        --rqtor->aimd.in_flight;
+        if (CURLE_OK != ecode) {
+            if (is_hedge) {
+                _winecord_request_hedge_stop(req, req->hedge.conn);
+                req->hedge.conn = NULL;
+            }
+            else {
+                _winecord_request_hedge_stop(req, req->conn);
+                req->conn = NULL;
+            }
+            return true;
+        }
+        curl_multi_remove_handle(rqtor->mhandle,
+                                 ua_conn_get_easy_handle(other));
+        _winecord_request_hedge_stop(req, other);
+    }
+    if (is_hedge) {
+        struct ccord_szbuf_reusable body = req->recv.body;
+
+        req->recv.body = req->hedge.body;
+        req->hedge.body = body;
+        req->conn = req->hedge.conn;
+    }
+    req->hedge.conn = NULL;
+
+    return false;
+}
+
+WINEBERRY
+winecord_requestor_info_read(struct winecord_requestor *rqtor)
+{
+    const int64_t now =
+        (int64_t)winecord_timestamp_us(REQUESTOR_CLIENT(rqtor));
+    int alive = 0;
+
+    /* ready sockets have been acted on already, only timeouts are left */
+    if (rqtor->timeout != -1 && rqtor->timeout <= now) {
+        rqtor->timeout = -1;
+        if (CURLM_OK
+            != curl_multi_socket_action(rqtor->mhandle, CURL_SOCKET_TIMEOUT,
+                                        0, &alive))
+            return WINEBERRY_CURLM_INTERNAL;
+    }
+
+    while (1) {
         int msgq = 0;
         struct CURLMsg *msg = curl_multi_info_read(rqtor->mhandle, &msgq);
 
@@ -364,70 +1571,105 @@ winecord_requestor_info_read(struct winecord_requestor *rqtor)
         if (CURLMSG_DONE == msg->msg) {
             const CURLcode ecode = msg->data.result;
             struct winecord_request *req;
-            bool retry = false;
+            bool retry = false, has_failed = false;
+            int64_t elapsed;
+            long httpcode = 0;
 
             curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &req);
             curl_multi_remove_handle(rqtor->mhandle, msg->easy_handle);
+            /* warm-up transfers don't belong to any request */
+            if (!req) {
+                _winecord_requestor_warm_done(rqtor, msg->easy_handle);
+                continue;
+            }
+            _winecord_requestor_count_connects(rqtor, msg->easy_handle);
+            if (req->hedge.timer) {
+                _winecord_request_hedge_unschedule(rqtor, req);
+            }
+            else if ((req->hedge.conn || !req->conn)
+                     && _winecord_request_hedge_settle(rqtor, req,
+                                                       msg->easy_handle, ecode))
+            {
+                /* wait on the transfer still in flight */
+                continue;
+            }
+            elapsed = now - req->tstamps.sent;
+            winecord_metrics_observe(&req->b->metrics.http, elapsed);
+            if (req->is_revalidating) {
+                ua_conn_remove_header(req->conn, "If-None-Match");
+                req->is_revalidating = false;
+            }
 
             switch (ecode) {
             case CURLE_OK: {
                 struct ua_szbuf_readonly body;
                 struct ua_info info;
 
+                struct ccord_szbuf cached = { 0 };
+
                 retry = _winecord_request_info_extract(rqtor, req, &info);
-                body = ua_info_get_body(&info);
+                httpcode = info.httpcode;
+                has_failed = (WINEBERRY_HTTP_CODE == req->code
+                              && info.httpcode >= 500);
+                body = _winecord_request_get_body(req);
 
-                if (info.code != WINEBERRY_OK) {
+                if (req->code != WINEBERRY_OK) {
                     logconf_error(&rqtor->conf, "%.*s", (int)body.size,
                                   body.start);
                 }
-                else if (req->dispatch.has_type
-                         && req->dispatch.sync != WINECORD_SYNC_FLAG) {
-                    if (req->dispatch.sync) {
-                        req->response.data = req->dispatch.sync;
+                else if (req->recv.is_streaming) {
+                    if (!req->recv.has_ended) {
+                        logconf_error(&rqtor->conf,
+                                      "Incomplete list received from [%s]",
+                                      req->endpoint);
+                        req->code = WINEBERRY_BAD_JSON;
                     }
-                    else {
-                        req->response.data = calloc(1, req->response.size);
-                        winecord_refcounter_add_internal(
-                            &CLIENT(rqtor, rest.requestor)->refcounter,
-                            req->response.data, req->response.cleanup, true);
+                    else if (_winecord_request_has_response(req)) {
+                        /* list has been populated as it was received */
+                        _winecord_request_response_init(req);
                     }
-
-                    if (req->response.init)
-                        req->response.init(req->response.data);
-                    if (req->response.from_json)
-                        req->response.from_json(body.start, body.size,
-                                                req->response.data);
+                }
+                else if (!_winecord_response_cache_update(rqtor, req, &info,
+                                                          &body, &cached))
+                {
+                    retry = true;
+                }
+                else {
+                    _winecord_request_parse(req, body.start, body.size);
                 }
 
                 winecord_ratelimiter_build(&rqtor->ratelimiter, req->b,
                                           req->key, &info);
 
+                free(cached.start);
                 ua_info_cleanup(&info);
             } break;
             default:
                 logconf_warn(&rqtor->conf, "%s (CURLE code: %d)",
                              curl_easy_strerror(ecode), ecode);
 
-                retry = (ecode == CURLE_READ_ERROR);
+                retry = _winecord_request_is_transient(req, ecode);
+                has_failed = true;
                 req->code = WINEBERRY_CURLE_INTERNAL;
                 break;
             }
 
-            if (!retry || !_winecord_request_retry(rqtor, req)) {
+            _winecord_requestor_adapt(rqtor, now, elapsed,
+                                      CURLE_OK != ecode || 429 == httpcode
+                                          || httpcode >= 500);
+            winecord_retry_record(rqtor->retry, req, has_failed);
+            if (retry
+                && winecord_retry_schedule(rqtor->retry, req, has_failed))
+            {
+                __atomic_fetch_add(&req->b->metrics.retries, 1,
+                                   __ATOMIC_RELAXED);
+            }
+            else {
+                __atomic_fetch_add(&req->b->metrics.requests, 1,
+                                   __ATOMIC_RELAXED);
                 winecord_bucket_request_unselect(&rqtor->ratelimiter, req->b,
                                                 req);
-
-                if (req->dispatch.sync) {
-                    pthread_mutex_lock(&rqtor->qlocks->pending);
-                    pthread_cond_signal(req->cond);
-                    pthread_mutex_unlock(&rqtor->qlocks->pending);
-                }
-                else {
-                    pthread_mutex_lock(&rqtor->qlocks->finished);
-                    QUEUE_INSERT_TAIL(&rqtor->queues->finished, &req->entry);
-                    pthread_mutex_unlock(&rqtor->qlocks->finished);
-                }
+                _winecord_request_finish(rqtor, req);
             }
         }
     }
@@ -435,21 +1677,295 @@ winecord_requestor_info_read(struct winecord_requestor *rqtor)
     return WINEBERRY_OK;
 }
 
+/* make room for `len` more bytes */
 static void
-_winecord_request_send(void *p_rqtor, struct winecord_request *req)
+_winecord_request_recv_reserve(struct ccord_szbuf_reusable *body, size_t len)
+{
+    if (body->size + len > body->realsize) {
+        size_t realsize = body->realsize ? body->realsize : 1024;
+        void *tmp;
+
+        while (realsize < body->size + len)
+            realsize *= 2;
+
+        tmp = realloc(body->start, realsize);
+        ASSERT_S(tmp != NULL, "Out of memory");
+
+        body->start = tmp;
+        body->realsize = realsize;
+    }
+}
+
+static void
+_winecord_request_recv_append(struct ccord_szbuf_reusable *body,
+                             const char *ptr,
+                             size_t len)
+{
+    _winecord_request_recv_reserve(body, len);
+    memcpy(body->start + body->size, ptr, len);
+    body->size += len;
+}
+
+/* decode the list element that has just been received */
+static void
+_winecord_request_recv_item(struct winecord_request *req)
+{
+    const size_t size = req->response.item.size;
+    struct ccord_szbuf_reusable *body = &req->recv.body;
+
+    if (req->dispatch.item) {
+        /* kept until the list is received whole, so that a retried
+         *      transfer doesn't hand the same elements over again */
+        struct ccord_szbuf_reusable *items = &req->recv.items;
+
+        _winecord_request_recv_reserve(items, size);
+        memset(items->start + items->size, 0, size);
+        req->response.item.from_json(body->start, body->size,
+                                     items->start + items->size);
+        items->size += size;
+    }
+    else if (_winecord_request_has_response(req)) {
+        _winecord_request_response_init(req);
+        req->response.item.from_json(
+            body->start, body->size,
+            req->response.item.push(req->response.data));
+    }
+    body->size = 0;
+}
+
+/* split a JSON array into its elements as they are received */
+static void
+_winecord_request_recv_stream(struct winecord_request *req,
+                             const char *ptr,
+                             size_t len)
+{
+    /* start of the element's span that hasn't been appended yet */
+    size_t mark = 0, i;
+
+    for (i = 0; i < len; ++i) {
+        const char c = ptr[i];
+
+        if (req->recv.has_ended) break;
+
+        if (!req->recv.has_started) {
+            if (isspace((unsigned char)c)) {
+                mark = i + 1;
+                continue;
+            }
+            if (c != '[') {
+                /* not a list, fallback to decoding it at once */
+                req->recv.is_streaming = false;
+                _winecord_request_recv_append(&req->recv.body, ptr + i,
+                                             len - i);
+                return;
+            }
+            req->recv.has_started = true;
+            mark = i + 1;
+            continue;
+        }
+
+        if (req->recv.in_string) {
+            if (req->recv.is_escaped)
+                req->recv.is_escaped = false;
+            else if ('\\' == c)
+                req->recv.is_escaped = true;
+            else if ('"' == c)
+                req->recv.in_string = false;
+        }
+        else if (0 == req->recv.depth) { /* in between elements */
+            if (',' == c || ']' == c || isspace((unsigned char)c)) {
+                _winecord_request_recv_append(&req->recv.body, ptr + mark,
+                                             i - mark);
+                mark = i + 1;
+                if (isspace((unsigned char)c)) continue;
+
+                if (req->recv.body.size) _winecord_request_recv_item(req);
+                if (']' == c) req->recv.has_ended = true;
+                continue;
+            }
+            if ('"' == c) req->recv.in_string = true;
+            if ('{' == c || '[' == c) ++req->recv.depth;
+        }
+        else {
+            if ('"' == c) req->recv.in_string = true;
+            if ('{' == c || '[' == c) ++req->recv.depth;
+            if ('}' == c || ']' == c) --req->recv.depth;
+        }
+    }
+    /* the element's remainder is completed by the next chunk */
+    if (!req->recv.has_ended && i > mark)
+        _winecord_request_recv_append(&req->recv.body, ptr + mark, i - mark);
+}
+
+static size_t
+_winecord_request_on_recv(char *ptr, size_t size, size_t nmemb, void *p_req)
+{
+    struct winecord_request *req = p_req;
+    const size_t len = size * nmemb;
+
+    if (req->recv.is_streaming) {
+        long httpcode = 0;
+
+        curl_easy_getinfo(ua_conn_get_easy_handle(req->conn),
+                          CURLINFO_RESPONSE_CODE, &httpcode);
+        /* error responses are kept whole */
+        if (httpcode < 200 || httpcode >= 300)
+            req->recv.is_streaming = false;
+        else {
+            _winecord_request_recv_stream(req, ptr, len);
+            return len;
+        }
+    }
+    _winecord_request_recv_append(&req->recv.body, ptr, len);
+
+    return len;
+}
+
+/* reset the state for receiving a response */
+static void
+_winecord_request_recv_reset(struct winecord_requestor *rqtor,
+                            struct winecord_request *req)
 {
-    static struct ua_szbuf_readonly hide_headers[] = {
-        { "Authorization", sizeof("Authorization") - 1 }
-    };
+    struct winecord_rest_cache *cache =
+        _winecord_response_cache_get(rqtor, req);
+
+    /* discard list elements decoded by a previous attempt */
+    if (req->recv.is_streaming) _winecord_request_response_discard(req);
+    _winecord_request_items_discard(req);
+
+    req->recv.body.size = 0;
+    req->recv.has_started = false;
+    req->recv.has_ended = false;
+    req->recv.in_string = false;
+    req->recv.is_escaped = false;
+    req->recv.depth = 0;
+    /* responses that may be cached must be kept whole */
+    req->recv.is_streaming =
+        req->response.item.from_json
+        && (req->dispatch.item || _winecord_request_has_response(req))
+        && !(cache && winecord_rest_cache_get_ttl(cache, req->route));
+}
+
+/* headers that are kept out of the logs */
+static struct ua_szbuf_readonly g_hide_headers[] = {
+    { "Authorization", sizeof("Authorization") - 1 }
+};
+
+/* the duplicate's response is kept apart, until it's known which transfer
+ *      completes first */
+static size_t
+_winecord_request_on_hedge_recv(char *ptr,
+                               size_t size,
+                               size_t nmemb,
+                               void *p_req)
+{
+    struct winecord_request *req = p_req;
+    const size_t len = size * nmemb;
+
+    _winecord_request_recv_append(&req->hedge.body, ptr, len);
+
+    return len;
+}
+
+static void
+_winecord_request_hedge_cb(struct winecord *client,
+                          struct winecord_timer *timer)
+{
+    (void)client;
+    struct winecord_request *req = timer->data;
+    struct winecord_requestor *rqtor = req->rqtor;
+    CURL *ehandle;
+
+    req->hedge.timer = 0;
+    /* the duplicate must fit within the in-flight and ratelimit budgets */
+    if (rqtor->aimd.in_flight >= rqtor->aimd.limit
+        || req->b->busy_req != req
+        || !winecord_bucket_hedge_take(&rqtor->ratelimiter, req->b, req))
+        return;
+
+    logconf_debug(&rqtor->conf, "[%.4s] Duplicating slow request to [%s]",
+                  req->b->hash, req->endpoint);
+
+    ++rqtor->aimd.in_flight;
+    __atomic_fetch_add(&req->b->metrics.hedges, 1, __ATOMIC_RELAXED);
+
+    req->hedge.conn = ua_conn_start(rqtor->ua);
+    ehandle = ua_conn_get_easy_handle(req->hedge.conn);
+
+    if (NOT_EMPTY_STR(req->reason))
+        ua_conn_add_header(req->hedge.conn, "X-Audit-Log-Reason",
+                           req->reason);
+    ua_conn_remove_header(req->hedge.conn, "Content-Type");
+
+    ua_conn_setup(req->hedge.conn, &(struct ua_conn_attr){
+                                       .method = req->method,
+                                       .endpoint = req->endpoint,
+                                       .base_url = NULL,
+                                       .log_filter = {
+                                          .headers = g_hide_headers,
+                                          .length = sizeof(g_hide_headers) / sizeof *g_hide_headers,
+                                       },
+                                   });
+
+    req->hedge.body.size = 0;
+    curl_easy_setopt(ehandle, CURLOPT_WRITEFUNCTION,
+                     &_winecord_request_on_hedge_recv);
+    curl_easy_setopt(ehandle, CURLOPT_WRITEDATA, req);
+    /* a connection of its own, rather than queueing behind the slow one */
+    curl_easy_setopt(ehandle, CURLOPT_FRESH_CONNECT, 1L);
+
+    curl_easy_setopt(ehandle, CURLOPT_PRIVATE, req);
+    curl_multi_add_handle(rqtor->mhandle, ehandle);
+}
 
+/* schedule a duplicate of the request for once it has taken longer than
+ *      its route's p95 */
+static void
+_winecord_request_hedge_schedule(struct winecord_requestor *rqtor,
+                                struct winecord_request *req)
+{
+    struct winecord *client = REQUESTOR_CLIENT(rqtor);
+    int64_t p95;
+
+    if (HTTP_GET != req->method || req->recv.is_streaming
+        || req->is_revalidating
+        || !__atomic_load_n(&client->rest.is_hedging, __ATOMIC_RELAXED))
+        return;
+
+    p95 = winecord_metrics_quantile(&req->b->metrics.http,
+                                    WINECORD_HEDGE_QUANTILE,
+                                    WINECORD_HEDGE_MIN_SAMPLES);
+    if (p95 <= 0) return;
+
+    req->hedge.timer =
+        _winecord_timer_ctl(client, &REST_SHARD(rqtor)->timers,
+                           &(struct winecord_timer){
+                               .on_tick = &_winecord_request_hedge_cb,
+                               .data = req,
+                               .delay = (p95 + 999) / 1000,
+                               .flags = WINECORD_TIMER_DELETE_AUTO,
+                           });
+}
+
+static void
+_winecord_request_send(void *p_rqtor, struct winecord_request *req)
+{
     struct winecord_requestor *rqtor = p_rqtor;
     CURL *ehandle;
 
+    req->tstamps.sent =
+        (int64_t)winecord_timestamp_us(REQUESTOR_CLIENT(rqtor));
+    rqtor->conns.last_tstamp = req->tstamps.sent;
+    ++rqtor->aimd.in_flight;
+    winecord_metrics_observe(&req->b->metrics.ratelimit_wait,
+                             req->tstamps.sent - req->tstamps.bucketed);
+
     req->conn = ua_conn_start(rqtor->ua);
     ehandle = ua_conn_get_easy_handle(req->conn);
 
     if (NOT_EMPTY_STR(req->reason))
         ua_conn_add_header(req->conn, "X-Audit-Log-Reason", req->reason);
+    if (HTTP_GET == req->method) _winecord_response_cache_prepare(rqtor, req);
 
     if (HTTP_MIMEPOST == req->method) {
         ua_conn_add_header(req->conn, "Content-Type", "multipart/form-data");
@@ -467,44 +1983,69 @@ _winecord_request_send(void *p_rqtor, struct winecord_request *req)
                                  .endpoint = req->endpoint,
                                  .base_url = NULL,
                                  .log_filter = {
-                                    .headers = hide_headers,
-                                    .length = sizeof(hide_headers) / sizeof *hide_headers,
+                                    .headers = g_hide_headers,
+                                    .length = sizeof(g_hide_headers) / sizeof *g_hide_headers,
                                  },
                              });
 
+    /* responses are received by the request itself, so lists can be
+     *      decoded as they arrive */
+    _winecord_request_recv_reset(rqtor, req);
+    curl_easy_setopt(ehandle, CURLOPT_WRITEFUNCTION,
+                     &_winecord_request_on_recv);
+    curl_easy_setopt(ehandle, CURLOPT_WRITEDATA, req);
+    /* may have been set by a previous duplicate */
+    curl_easy_setopt(ehandle, CURLOPT_FRESH_CONNECT, 0L);
+
     curl_easy_setopt(ehandle, CURLOPT_PRIVATE, req);
     curl_multi_add_handle(rqtor->mhandle, ehandle);
+
+    _winecord_request_hedge_schedule(rqtor, req);
 }
 
 WINEBERRY
 winecord_requestor_start_pending(struct winecord_requestor *rqtor)
 {
-    QUEUE(struct winecord_request) queue, *qelem;
-    struct winecord_request *req;
+    struct winecord_request *req, *next, *stack = NULL;
     struct winecord_bucket *b;
 
-    pthread_mutex_lock(&rqtor->qlocks->pending);
-    QUEUE_MOVE(&rqtor->queues->pending, &queue);
-    pthread_mutex_unlock(&rqtor->qlocks->pending);
+    /* clear wakeup flag before draining, any request pushed after this point
+     *      will trigger a new wakeup */
+    __atomic_store_n(&rqtor->wakeup_pending, false, __ATOMIC_SEQ_CST);
+    req = __atomic_exchange_n(&rqtor->pending, NULL, __ATOMIC_SEQ_CST);
 
-    while (!QUEUE_EMPTY(&queue)) {
-        qelem = QUEUE_HEAD(&queue);
-        QUEUE_REMOVE(qelem);
+    /* reverse stack to preserve order of arrival */
+    for (; req != NULL; req = next) {
+        next = req->next;
+        req->next = stack;
+        stack = req;
+    }
+
+    while (stack != NULL) {
+        req = stack;
+        stack = req->next;
+        req->next = NULL;
+
+        if (_winecord_response_cache_serve(rqtor, req)
+            || _winecord_request_coalesce(rqtor, req))
+            continue;
 
-        req = QUEUE_DATA(qelem, struct winecord_request, entry);
         b = winecord_bucket_get(&rqtor->ratelimiter, req->key);
-        winecord_bucket_insert(&rqtor->ratelimiter, b, req,
-                              req->dispatch.high_priority);
+        winecord_bucket_insert(&rqtor->ratelimiter, b, req, false);
+        winecord_metrics_observe(&b->metrics.queue_wait,
+                                 req->tstamps.bucketed - req->tstamps.started);
     }
 
-    winecord_bucket_request_selector(&rqtor->ratelimiter, rqtor,
-                                    &_winecord_request_send);
+    winecord_bucket_request_selector(
+        &rqtor->ratelimiter, rqtor->aimd.limit - rqtor->aimd.in_flight, rqtor,
+        &_winecord_request_send);
 
     return WINEBERRY_OK;
 }
 
 static void
-_winecord_attachments_dup(struct winecord_attachments *dest,
+_winecord_attachments_dup(struct winecord_refcounter *rc,
+                         struct winecord_attachments *dest,
                          const struct winecord_attachments *src)
 {
     int i;
@@ -516,9 +2057,14 @@ _winecord_attachments_dup(struct winecord_attachments *dest,
             dest->array[i].size = src->array[i].size
                                       ? src->array[i].size
                                       : strlen(src->array[i].content) + 1;
-            dest->array[i].content = malloc(dest->array[i].size);
-            memcpy(dest->array[i].content, src->array[i].content,
-                   dest->array[i].size);
+            /* shared contents are referenced rather than copied */
+            if (WINEBERRY_OK
+                != winecord_refcounter_incr(rc, src->array[i].content))
+            {
+                dest->array[i].content = malloc(dest->array[i].size);
+                memcpy(dest->array[i].content, src->array[i].content,
+                       dest->array[i].size);
+            }
         }
         if (src->array[i].filename)
             cog_strndup(src->array[i].filename, strlen(src->array[i].filename),
@@ -543,49 +2089,197 @@ _winecord_request_attributes_copy(struct winecord_request *dest,
         snprintf(dest->reason, WINECORD_MAX_REASON_LEN, "%s", src->reason);
     }
     if (src->attachments.size)
-        _winecord_attachments_dup(&dest->attachments, &src->attachments);
+        _winecord_attachments_dup(
+            &REQUESTOR_CLIENT(dest->rqtor)->refcounter,
+            &dest->attachments, &src->attachments);
 }
 
+void
+winecord_attachment_share(struct winecord *client,
+                          void *content,
+                          void (*cleanup)(struct winecord *client,
+                                          void *content),
+                          bool should_free)
+{
+    winecord_refcounter_add_client(&client->refcounter, content, cleanup,
+                                  should_free);
+}
+
+void
+winecord_attachment_unshare(struct winecord *client, void *content)
+{
+    winecord_refcounter_decr(&client->refcounter, content);
+}
+
+/* take a request from the requestor's recycling queue, for threads that
+ *      don't keep a cache */
 static struct winecord_request *
-_winecord_request_get(struct winecord_requestor *rqtor)
+_winecord_request_get_shared(struct winecord_requestor *rqtor)
 {
-    struct winecord_request *req;
+    QUEUE(struct winecord_request) *qelem;
+    struct winecord_request *req = NULL;
 
     pthread_mutex_lock(&rqtor->qlocks->recycling);
-    if (QUEUE_EMPTY(&rqtor->queues->recycling)) {
-        req = _winecord_request_init();
-    }
-    else {
-        QUEUE(struct winecord_request) *qelem =
-            QUEUE_HEAD(&rqtor->queues->recycling);
-
+    if (!QUEUE_EMPTY(&rqtor->queues->recycling)) {
+        qelem = QUEUE_HEAD(&rqtor->queues->recycling);
         QUEUE_REMOVE(qelem);
         req = QUEUE_DATA(qelem, struct winecord_request, entry);
     }
     pthread_mutex_unlock(&rqtor->qlocks->recycling);
 
+    return req ? req : _winecord_request_init();
+}
+
+static struct winecord_request *
+_winecord_request_get(struct winecord_requestor *rqtor)
+{
+    struct _winecord_request_cache *cache = _winecord_request_cache_get();
+    struct winecord_request *req;
+
+    if (!cache) {
+        req = _winecord_request_get_shared(rqtor);
+    }
+    else {
+        if (!cache->head) _winecord_request_cache_refill(rqtor, cache);
+
+        if (!cache->head) {
+            req = _winecord_request_init();
+        }
+        else {
+            req = cache->head;
+            cache->head = req->next;
+            --cache->size;
+        }
+    }
+    req->next = NULL;
     QUEUE_INIT(&req->entry);
 
     return req;
 }
 
+/* push request to the lock-free pending stack, and wake up the `REST` thread
+ *      if it hasn't been already */
+static void
+_winecord_request_push_pending(struct winecord_requestor *rqtor,
+                               struct winecord_request *req)
+{
+    struct winecord_rest_shard *shard = REST_SHARD(rqtor);
+    struct winecord_request *head =
+        __atomic_load_n(&rqtor->pending, __ATOMIC_RELAXED);
+
+    do {
+        req->next = head;
+    } while (!__atomic_compare_exchange_n(&rqtor->pending, &head, req,
+                                          true, __ATOMIC_SEQ_CST,
+                                          __ATOMIC_RELAXED));
+
+    if (!__atomic_exchange_n(&rqtor->wakeup_pending, true,
+                             __ATOMIC_SEQ_CST))
+        io_poller_wakeup(shard->io_poller);
+}
+
+/* serialize the request's body straight into its reusable buffer, growing it
+ *      until the payload fits */
+static bool
+_winecord_request_build_body(struct winecord_request *req,
+                             const struct winecord_body_builder *builder)
+{
+    size_t size = req->body.realsize;
+
+    if (size < WINECORD_BODY_MIN_LEN) size = WINECORD_BODY_MIN_LEN;
+    while (1) {
+        if (size > req->body.realsize) {
+            void *tmp = realloc(req->body.start, size);
+            ASSERT_S(tmp != NULL, "Out of memory");
+
+            req->body.start = tmp;
+            req->body.realsize = size;
+        }
+        req->body.size = builder->to_json(req->body.start, req->body.realsize,
+                                          builder->params);
+        if (req->body.size) return true;
+        if (size >= WINECORD_BODY_MAX_LEN) return false;
+        size *= 2;
+    }
+}
+
+/* reference the user data until the request's callbacks are dispatched */
+static void
+_winecord_request_hold(struct winecord *client, struct winecord_request *req)
+{
+    if (req->dispatch.keep) {
+        WINEBERRY code = winecord_refcounter_incr(&client->refcounter,
+                                                 (void *)req->dispatch.keep);
+
+        ASSERT_S(code == WINEBERRY_OK, "'.keep' data must be a Winecord resource");
+    }
+    if (req->dispatch.data
+        && WINEBERRY_RESOURCE_UNAVAILABLE
+               == winecord_refcounter_incr(&client->refcounter,
+                                          req->dispatch.data))
+    {
+        winecord_refcounter_add_client(&client->refcounter, req->dispatch.data,
+                                      req->dispatch.cleanup, false);
+    }
+}
+
+void
+winecord_request_dispatch_code(struct winecord_requestor *rqtor,
+                               struct winecord_attributes *attr,
+                               WINEBERRYcode code)
+{
+    struct winecord *client = REQUESTOR_CLIENT(rqtor);
+    struct winecord_request *req = _winecord_request_get(rqtor);
+
+    ASSERT_S(!attr->dispatch.sync, "Outcome can't be waited on");
+
+    /* the request is never started, so it has no followers nor connection
+     *      to be cleaned up */
+    req->rqtor = rqtor;
+    req->code = code;
+    _winecord_request_attributes_copy(req, attr);
+    if (!req->dispatch.tenant)
+        req->dispatch.tenant = winecord_tenant_context_get();
+    _winecord_request_hold(client, req);
+    if (req->dispatch.future) {
+        req->future = winecord_future_create(client);
+        *req->dispatch.future = req->future;
+    }
+    _winecord_request_finish(rqtor, req);
+}
+
 WINEBERRY
 winecord_request_begin(struct winecord_requestor *rqtor,
                       struct winecord_attributes *attr,
                       struct ccord_szbuf *body,
                       enum http_method method,
                       char endpoint[WINECORD_ENDPT_LEN],
-                      char key[WINECORD_ROUTE_LEN])
+                      char key[WINECORD_ROUTE_LEN],
+                      const char route[])
 {
-    struct winecord_rest *rest =
-        CONTAINEROF(rqtor, struct winecord_rest, requestor);
+    struct winecord_rest *rest = REST_SHARD(rqtor)->rest;
     struct winecord *client = CLIENT(rest, rest);
 
     struct winecord_request *req = _winecord_request_get(rqtor);
     WINEBERRY code;
 
     req->method = method;
-    if (body) {
+    if (attr->builder.to_json) {
+        if (!_winecord_request_build_body(req, &attr->builder)) {
+            logconf_error(&rest->conf,
+                          "Request body exceeds %d bytes, or couldn't be "
+                          "formed",
+                          WINECORD_BODY_MAX_LEN);
+            _winecord_request_recycle(rqtor, req);
+            if (attr->dispatch.sync) return WINEBERRY_MALFORMED_PAYLOAD;
+            /* asynchronous requests get their outcome at their callbacks
+             *      and future, so `data` is cleaned up as usual */
+            winecord_request_dispatch_code(rqtor, attr,
+                                           WINEBERRY_MALFORMED_PAYLOAD);
+            return WINEBERRY_PENDING;
+        }
+    }
+    else if (body) {
         if (body->size > req->body.realsize) {
             void *tmp = realloc(req->body.start, body->size);
             ASSERT_S(tmp != NULL, "Out of memory");
@@ -598,34 +2292,33 @@ winecord_request_begin(struct winecord_requestor *rqtor,
     }
     memcpy(req->endpoint, endpoint, sizeof(req->endpoint));
     memcpy(req->key, key, sizeof(req->key));
+    req->route = route;
+    req->rqtor = rqtor;
+    req->tstamps.started = (int64_t)winecord_timestamp_us(client);
 
     _winecord_request_attributes_copy(req, attr);
-
-    if (req->dispatch.keep) {
-        code = winecord_refcounter_incr(&client->refcounter,
-                                       (void *)req->dispatch.keep);
-
-        ASSERT_S(code == WINEBERRY_OK, "'.keep' data must be a Winecord resource");
-    }
-    if (req->dispatch.data
-        && WINEBERRY_RESOURCE_UNAVAILABLE
-               == winecord_refcounter_incr(&client->refcounter,
-                                          req->dispatch.data))
-    {
-        winecord_refcounter_add_client(&client->refcounter, req->dispatch.data,
-                                      req->dispatch.cleanup, false);
+    if (!req->dispatch.tenant)
+        req->dispatch.tenant = winecord_tenant_context_get();
+    if (req->dispatch.deadline_ms)
+        req->deadline = winecord_timestamp(client) + req->dispatch.deadline_ms;
+
+    _winecord_request_hold(client, req);
+    if (req->dispatch.future) {
+        req->future = winecord_future_create(client);
+        *req->dispatch.future = req->future;
     }
 
-    pthread_mutex_lock(&rqtor->qlocks->pending);
-    QUEUE_INSERT_TAIL(&rqtor->queues->pending, &req->entry);
-    io_poller_wakeup(rest->io_poller);
     if (!req->dispatch.sync) {
-        pthread_mutex_unlock(&rqtor->qlocks->pending);
+        _winecord_request_push_pending(rqtor, req);
         code = WINEBERRY_PENDING;
     }
     else {
         pthread_cond_t temp_cond = PTHREAD_COND_INITIALIZER;
+
+        /* lock is held until waiting, so the signal can't be missed */
+        pthread_mutex_lock(&rqtor->qlocks->pending);
         req->cond = &temp_cond;
+        _winecord_request_push_pending(rqtor, req);
         pthread_cond_wait(req->cond, &rqtor->qlocks->pending);
         req->cond = NULL;
         pthread_mutex_unlock(&rqtor->qlocks->pending);
@@ -0,0 +1,267 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "winecord.h"
+#include "winecord-internal.h"
+#include "winecord-rest.h"
+
+#include "cog-utils.h"
+
+#define CHASH_BUCKETS_FIELD buckets
+#include "chash.h"
+
+/* chash heap-mode (auto-increase hashtable) */
+#define POLICIES_TABLE_HEAP   1
+#define POLICIES_TABLE_BUCKET struct _winecord_retry_route
+#define POLICIES_TABLE_FREE_KEY(_key) free(_key)
+#define POLICIES_TABLE_HASH(_key, _hash) chash_string_hash(_key, _hash)
+#define POLICIES_TABLE_FREE_VALUE(_value)
+#define POLICIES_TABLE_COMPARE(_cmp_a, _cmp_b)                                \
+    chash_string_compare(_cmp_a, _cmp_b)
+#define POLICIES_TABLE_INIT(route, _key, _value)                              \
+    chash_default_init(route, _key, _value)
+
+/** retries that may be made before any request has paid them back */
+#define WINECORD_RETRY_BUDGET_MAX 10.0
+
+struct _winecord_retry_route {
+    /** the route's endpoint format string */
+    char *key;
+    /** the route's retry policy */
+    struct winecord_retry_policy value;
+    /** the route state in the hashtable (see chash.h 'State enums') */
+    int state;
+};
+
+void
+winecord_retry_init(struct winecord_retry *retry, struct logconf *conf)
+{
+    logconf_branch(&retry->conf, conf, "WINECORD_RETRY");
+
+    retry->default_policy =
+        (struct winecord_retry_policy)WINECORD_RETRY_POLICY_DEFAULT;
+    __chash_init(&retry->routes, POLICIES_TABLE);
+    retry->seed = (unsigned)cog_timestamp_ms();
+
+    ASSERT_S(!pthread_mutex_init(&retry->lock, NULL),
+             "Couldn't initialize retry policies mutex");
+}
+
+void
+winecord_retry_cleanup(struct winecord_retry *retry)
+{
+    __chash_free(&retry->routes, POLICIES_TABLE);
+    pthread_mutex_destroy(&retry->lock);
+}
+
+static void
+_winecord_retry_get_policy(struct winecord_retry *retry,
+                           const char route[],
+                           struct winecord_retry_policy *policy)
+{
+    int ret = 0;
+
+    pthread_mutex_lock(&retry->lock);
+    if (route)
+        ret = chash_contains(&retry->routes, (char *)route, ret,
+                             POLICIES_TABLE);
+    if (ret) {
+        struct _winecord_retry_route *r = chash_lookup_bucket(
+            &retry->routes, (char *)route, r, POLICIES_TABLE);
+        *policy = r->value;
+    }
+    else {
+        *policy = retry->default_policy;
+    }
+    pthread_mutex_unlock(&retry->lock);
+}
+
+bool
+winecord_retry_is_open(const struct winecord_bucket *b, u64unix_ms now)
+{
+    return b->retry.open_tstamp > now;
+}
+
+bool
+winecord_retry_is_probing(const struct winecord_bucket *b)
+{
+    return b->retry.is_probing;
+}
+
+void
+winecord_retry_on_select(struct winecord_bucket *b)
+{
+    /* once the cooldown is over the circuit is half-open, until the single
+     *      request it lets through succeeds */
+    if (b->retry.open_tstamp) b->retry.is_probing = true;
+}
+
+void
+winecord_retry_record(struct winecord_retry *retry,
+                      struct winecord_request *req,
+                      bool has_failed)
+{
+    struct winecord_bucket *b = req->b;
+    struct winecord_retry_policy policy;
+
+    _winecord_retry_get_policy(retry, req->route, &policy);
+
+    /* a request sent for the first time pays back part of a retry */
+    if (!req->retry_attempt) {
+        b->retry.spent -= policy.budget_ratio;
+        if (b->retry.spent < 0) b->retry.spent = 0;
+    }
+
+    if (!has_failed) {
+        if (b->retry.open_tstamp)
+            logconf_info(&retry->conf, "[%.4s] Circuit closed for '%s'",
+                         b->hash, req->key);
+        b->retry.failures = 0;
+        b->retry.open_tstamp = 0;
+        b->retry.is_probing = false;
+        return;
+    }
+
+    /* a failed probe reopens the half-open circuit right away */
+    if ((++b->retry.failures >= policy.failure_threshold
+         && policy.failure_threshold > 0)
+        || b->retry.is_probing)
+    {
+        b->retry.is_probing = false;
+        b->retry.open_tstamp = cog_timestamp_ms() + policy.cooldown_ms;
+        logconf_warn(&retry->conf,
+                     "[%.4s] Circuit opened for '%s' after %d consecutive "
+                     "failures (cooldown %" PRIu64 " ms)",
+                     b->hash, req->key, b->retry.failures,
+                     policy.cooldown_ms);
+    }
+}
+
+/* exponential backoff with "equal jitter": half of the delay is kept, and
+ *      the other half is randomized so that retries don't synchronize */
+static u64unix_ms
+_winecord_retry_backoff(struct winecord_retry *retry,
+                        const struct winecord_retry_policy *policy,
+                        int attempt)
+{
+    u64unix_ms delay_ms = policy->base_delay_ms;
+    unsigned jitter;
+
+    while (attempt-- > 0 && delay_ms < policy->max_delay_ms)
+        delay_ms *= 2;
+    if (delay_ms > policy->max_delay_ms) delay_ms = policy->max_delay_ms;
+
+    /* seed is shared by every REST thread */
+    pthread_mutex_lock(&retry->lock);
+    jitter = (unsigned)rand_r(&retry->seed);
+    pthread_mutex_unlock(&retry->lock);
+
+    return delay_ms / 2 + (u64unix_ms)jitter % (delay_ms / 2 + 1);
+}
+
+static void
+_winecord_retry_wake_cb(struct winecord *client, struct winecord_timer *timer)
+{
+    (void)client;
+    struct winecord_request *req = timer->data;
+
+    winecord_bucket_insert(&req->rqtor->ratelimiter, req->b, req, true);
+}
+
+static void
+_winecord_retry_status_cb(struct winecord *client,
+                          struct winecord_timer *timer)
+{
+    (void)client;
+    struct winecord_request *req = timer->data;
+
+    /* REST timers are canceled once the client is being cleaned up */
+    if (timer->flags & WINECORD_TIMER_CANCELED)
+        winecord_request_cancel(req->rqtor, req);
+}
+
+bool
+winecord_retry_schedule(struct winecord_retry *retry,
+                        struct winecord_request *req,
+                        bool has_failed)
+{
+    struct winecord_requestor *rqtor = req->rqtor;
+    struct winecord *client = REQUESTOR_CLIENT(rqtor);
+    struct winecord_bucket *b = req->b;
+    struct winecord_retry_policy policy;
+    u64unix_ms delay_ms = 0, now;
+
+    _winecord_retry_get_policy(retry, req->route, &policy);
+    if (req->retry_attempt >= policy.max_attempts) return false;
+
+    if (has_failed) {
+        now = cog_timestamp_ms();
+        if (winecord_retry_is_open(b, now)) return false;
+
+        delay_ms = _winecord_retry_backoff(retry, &policy, req->retry_attempt);
+        if (req->deadline && req->deadline < now + delay_ms) return false;
+
+        if (policy.budget_ratio > 0) {
+            if (b->retry.spent + 1 > WINECORD_RETRY_BUDGET_MAX) {
+                logconf_warn(&retry->conf,
+                             "[%.4s] Out of retry budget, giving up on '%s'",
+                             b->hash, req->endpoint);
+                return false;
+            }
+            b->retry.spent += 1;
+        }
+    }
+
+    ++req->retry_attempt;
+    ua_conn_reset(req->conn);
+    /* release bucket, so that its other requests aren't held back */
+    if (b->busy_req == req) b->busy_req = NULL;
+
+    if (!has_failed) {
+        winecord_bucket_insert(&rqtor->ratelimiter, b, req, true);
+        return true;
+    }
+
+    _winecord_timer_ctl(client, &REST_SHARD(rqtor)->timers,
+                       &(struct winecord_timer){
+                           .on_tick = &_winecord_retry_wake_cb,
+                           .on_status_changed = &_winecord_retry_status_cb,
+                           .data = req,
+                           .delay = (int64_t)delay_ms,
+                           .flags = WINECORD_TIMER_DELETE_AUTO,
+                       });
+
+    logconf_info(&retry->conf,
+                 "[%.4s] Retrying '%s' in %" PRIu64 " ms (attempt %d)",
+                 b->hash, req->endpoint, delay_ms, req->retry_attempt);
+
+    return true;
+}
+
+void
+winecord_rest_set_retry_policy(struct winecord *client,
+                               const char route[],
+                               const struct winecord_retry_policy *policy)
+{
+    struct winecord_retry *retry = client->rest.shards->requestor.retry;
+    int ret;
+
+    pthread_mutex_lock(&retry->lock);
+    if (!route) {
+        retry->default_policy = *policy;
+        pthread_mutex_unlock(&retry->lock);
+        return;
+    }
+
+    ret = chash_contains(&retry->routes, (char *)route, ret, POLICIES_TABLE);
+    if (ret) {
+        struct _winecord_retry_route *r = chash_lookup_bucket(
+            &retry->routes, (char *)route, r, POLICIES_TABLE);
+        r->value = *policy;
+    }
+    else {
+        chash_assign(&retry->routes, strdup(route), *policy, POLICIES_TABLE);
+    }
+    pthread_mutex_unlock(&retry->lock);
+}
@@ -0,0 +1,580 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "winecord.h"
+#include "winecord-internal.h"
+#include "winecord-request.h"
+#include "winecord-rest.h"
+
+#define CHASH_BUCKETS_FIELD buckets
+#include "chash.h"
+
+/* chash heap-mode (auto-increase hashtable) */
+#define ROLES_TABLE_HEAP   1
+#define ROLES_TABLE_BUCKET struct _winecord_role_deltas_entry
+#define ROLES_TABLE_FREE_KEY(_key)
+#define ROLES_TABLE_HASH(_key, _hash) chash_string_hash(_key, _hash)
+#define ROLES_TABLE_FREE_VALUE(_value) _winecord_role_delta_free(_value)
+#define ROLES_TABLE_COMPARE(_cmp_a, _cmp_b)                                   \
+    chash_string_compare(_cmp_a, _cmp_b)
+#define ROLES_TABLE_INIT(entry, _key, _value)                                 \
+    chash_default_init(entry, _key, _value)
+
+/** a member's net role changes up to this amount are sent as a request per
+ *      role, rather than fetching and modifying the member at the cost of
+ *      two requests */
+#define WINECORD_ROLE_CHANGES_SINGLE_MAX 2
+
+/** @brief A role change waiting to be sent */
+struct _winecord_role_change {
+    /** the role to be added or removed */
+    u64snowflake role_id;
+    /** `true` if the role is added, `false` if removed */
+    bool is_added;
+    /** the outcome of the request the change has been sent with,
+     *      @ref WINEBERRY_PENDING if it's been sent along other roles */
+    WINEBERRYcode code;
+    /** the change's return handle */
+    struct winecord_ret ret;
+};
+
+/** @brief Role changes of a guild member */
+struct _winecord_role_delta {
+    /** the client the changes have been issued from */
+    struct winecord *client;
+    /** `<guild_id>:<user_id>` */
+    char key[48];
+    /** the guild the member belongs to */
+    u64snowflake guild_id;
+    /** the member's user id */
+    u64snowflake user_id;
+    /** the audit log reason of the first change that has one */
+    char *reason;
+    /** timestamp after which the changes are sent */
+    u64unix_ms deadline;
+    /** the changes, in the order they have been issued */
+    struct _winecord_role_change *array;
+    /** amount of changes */
+    int size;
+    /** changes cap before increase */
+    int realsize;
+    /** the first `n_sending` changes are part of the requests in flight */
+    int n_sending;
+    /** amount of role requests in flight, if the changes have been sent as
+     *      a request per role */
+    int n_requests;
+    /** `true` while the changes' requests are in flight, so changes issued
+     *      in the meantime are collected for the next ones */
+    bool is_busy;
+    /** entry for collecting the members whose changes are due */
+    QUEUE entry;
+};
+
+struct _winecord_role_deltas_entry {
+    /** the member's key @note points to its delta's `key` */
+    const char *key;
+    /** the member's changes */
+    struct _winecord_role_delta *value;
+    /** the entry state in the hashtable (see chash.h 'State enums') */
+    int state;
+};
+
+/* @note deltas detached from the hashtable leave a `NULL` behind */
+static void
+_winecord_role_delta_free(struct _winecord_role_delta *delta)
+{
+    if (!delta) return;
+
+    for (int i = 0; i < delta->size; ++i)
+        winecord_refcounter_release_ret(&delta->client->refcounter,
+                                        &delta->array[i].ret);
+    free(delta->array);
+    free(delta->reason);
+    free(delta);
+}
+
+void
+winecord_role_deltas_init(struct winecord_role_deltas *deltas,
+                          struct logconf *conf)
+{
+    logconf_branch(&deltas->conf, conf, "WINECORD_ROLES");
+
+    __chash_init(&deltas->members, ROLES_TABLE);
+
+    ASSERT_S(!pthread_mutex_init(&deltas->lock, NULL),
+             "Couldn't initialize role changes mutex");
+}
+
+void
+winecord_role_deltas_cleanup(struct winecord_role_deltas *deltas)
+{
+    __chash_free(&deltas->members, ROLES_TABLE);
+    pthread_mutex_destroy(&deltas->lock);
+}
+
+void
+winecord_rest_set_role_coalescing(struct winecord *client,
+                                  u64unix_ms window_ms)
+{
+    __atomic_store_n(&client->rest.role_deltas.window, window_ms,
+                     __ATOMIC_RELAXED);
+}
+
+static void _winecord_role_deltas_schedule(struct winecord *client,
+                                           u64unix_ms delay_ms);
+
+/* execute the callbacks of the changes that have been sent, and collect
+ *      the next ones if any */
+static void
+_winecord_role_delta_complete(struct winecord *client,
+                              struct _winecord_role_delta *delta,
+                              WINEBERRYcode code)
+{
+    struct winecord_role_deltas *deltas = &client->rest.role_deltas;
+    struct _winecord_role_change *sent;
+    int n_sent;
+
+    pthread_mutex_lock(&deltas->lock);
+    n_sent = delta->n_sending;
+    sent = malloc((size_t)n_sent * sizeof *sent);
+    ASSERT_S(n_sent == 0 || sent != NULL, "Out of memory");
+    memcpy(sent, delta->array, (size_t)n_sent * sizeof *sent);
+    memmove(delta->array, delta->array + n_sent,
+            (size_t)(delta->size - n_sent) * sizeof *delta->array);
+    delta->size -= n_sent;
+    delta->n_sending = 0;
+    delta->is_busy = false;
+    if (delta->size) {
+        /* changes issued in the meantime have waited long enough */
+        delta->deadline = winecord_timestamp(client);
+        _winecord_role_deltas_schedule(client, 0);
+        delta = NULL;
+    }
+    else {
+        struct _winecord_role_deltas_entry *entry = chash_lookup_bucket(
+            &deltas->members, delta->key, entry, ROLES_TABLE);
+
+        entry->value = NULL;
+        chash_delete(&deltas->members, delta->key, ROLES_TABLE);
+    }
+    pthread_mutex_unlock(&deltas->lock);
+
+    /* callbacks are executed from the client's executor, whichever thread
+     *      the changes are completed from */
+    for (int i = 0; i < n_sent; ++i) {
+        if (sent[i].ret.done || sent[i].ret.fail) {
+            struct winecord_attributes attr = { 0 };
+
+            WINECORD_ATTR_BLANK_INIT(attr, &sent[i].ret, NULL);
+
+            winecord_request_dispatch_code(
+                &client->rest.shards->requestor, &attr,
+                WINEBERRY_PENDING == sent[i].code ? code : sent[i].code);
+        }
+        winecord_refcounter_release_ret(&client->refcounter, &sent[i].ret);
+    }
+    free(sent);
+    /* the member has no changes left */
+    if (delta) _winecord_role_delta_free(delta);
+}
+
+static void
+_winecord_role_delta_on_fail(struct winecord *client,
+                             struct winecord_response *resp)
+{
+    struct _winecord_role_delta *delta = resp->data;
+
+    logconf_error(&client->rest.role_deltas.conf,
+                  "Couldn't change %d role(s) of member %" PRIu64
+                  " at guild %" PRIu64 ": %s",
+                  delta->n_sending, delta->user_id, delta->guild_id,
+                  winecord_strerror(resp->code, client));
+
+    _winecord_role_delta_complete(client, delta, resp->code);
+}
+
+static void
+_winecord_role_delta_on_modified(struct winecord *client,
+                                 struct winecord_response *resp,
+                                 const struct winecord_guild_member *member)
+{
+    (void)member;
+    _winecord_role_delta_complete(client, resp->data, WINEBERRY_OK);
+}
+
+static bool
+_winecord_snowflakes_find(const struct snowflakes *list,
+                          u64snowflake id,
+                          int *p_index)
+{
+    for (int i = 0; i < list->size; ++i)
+        if (list->array[i] == id) {
+            *p_index = i;
+            return true;
+        }
+    return false;
+}
+
+/* apply the changes to the member's current roles, and send them at once */
+static void
+_winecord_role_delta_on_member(struct winecord *client,
+                               struct winecord_response *resp,
+                               const struct winecord_guild_member *member)
+{
+    struct winecord_role_deltas *deltas = &client->rest.role_deltas;
+    struct _winecord_role_delta *delta = resp->data;
+    struct snowflakes roles = { 0 };
+    bool is_changed = false;
+    int realsize, index;
+    WINEBERRYcode code;
+
+    pthread_mutex_lock(&deltas->lock);
+    realsize = delta->n_sending;
+    if (member->roles) realsize += member->roles->size;
+    roles.array = malloc((size_t)(realsize ? realsize : 1)
+                         * sizeof *roles.array);
+    ASSERT_S(roles.array != NULL, "Out of memory");
+    roles.realsize = realsize;
+    if (member->roles) {
+        memcpy(roles.array, member->roles->array,
+               (size_t)member->roles->size * sizeof *roles.array);
+        roles.size = member->roles->size;
+    }
+
+    for (int i = 0; i < delta->n_sending; ++i) {
+        const struct _winecord_role_change *change = delta->array + i;
+        const bool has_role =
+            _winecord_snowflakes_find(&roles, change->role_id, &index);
+
+        if (change->is_added && !has_role) {
+            roles.array[roles.size++] = change->role_id;
+            is_changed = true;
+        }
+        else if (!change->is_added && has_role) {
+            roles.array[index] = roles.array[--roles.size];
+            is_changed = true;
+        }
+    }
+    pthread_mutex_unlock(&deltas->lock);
+
+    /* the member already has its final roles */
+    if (!is_changed) {
+        free(roles.array);
+        _winecord_role_delta_complete(client, delta, WINEBERRY_OK);
+        return;
+    }
+
+    logconf_info(&deltas->conf,
+                 "Changing %d role(s) of member %" PRIu64 " at guild %" PRIu64
+                 " at once",
+                 delta->n_sending, delta->user_id, delta->guild_id);
+
+    /* the body is serialized at once, so the roles may be freed after */
+    code = winecord_modify_guild_member(
+        client, delta->guild_id, delta->user_id,
+        &(struct winecord_modify_guild_member){ .roles = &roles,
+                                                .reason = delta->reason },
+        &(struct winecord_ret_guild_member){
+            .data = delta,
+            .done = &_winecord_role_delta_on_modified,
+            .fail = &_winecord_role_delta_on_fail,
+        });
+    free(roles.array);
+
+    if (code != WINEBERRY_PENDING)
+        _winecord_role_delta_complete(client, delta, code);
+}
+
+/** @brief A role request of a member's changes */
+struct _winecord_role_request {
+    /** the member's changes */
+    struct _winecord_role_delta *delta;
+    /** the role changed by the request */
+    u64snowflake role_id;
+};
+
+static void
+_winecord_role_request_cleanup(struct winecord *client, void *p_rreq)
+{
+    (void)client;
+    free(p_rreq);
+}
+
+/* hand a role request's outcome to the changes of its role, and complete
+ *      the member's changes once it's the last request */
+static void
+_winecord_role_delta_on_request(struct winecord *client,
+                                struct _winecord_role_delta *delta,
+                                u64snowflake role_id,
+                                WINEBERRYcode code)
+{
+    struct winecord_role_deltas *deltas = &client->rest.role_deltas;
+    bool is_last;
+
+    pthread_mutex_lock(&deltas->lock);
+    for (int i = 0; i < delta->n_sending; ++i)
+        if (delta->array[i].role_id == role_id) delta->array[i].code = code;
+    is_last = (0 == --delta->n_requests);
+    pthread_mutex_unlock(&deltas->lock);
+
+    if (is_last) _winecord_role_delta_complete(client, delta, WINEBERRY_OK);
+}
+
+static void
+_winecord_role_request_on_done(struct winecord *client,
+                               struct winecord_response *resp)
+{
+    struct _winecord_role_request *rreq = resp->data;
+
+    _winecord_role_delta_on_request(client, rreq->delta, rreq->role_id,
+                                    WINEBERRY_OK);
+}
+
+static void
+_winecord_role_request_on_fail(struct winecord *client,
+                               struct winecord_response *resp)
+{
+    struct _winecord_role_request *rreq = resp->data;
+
+    logconf_error(&client->rest.role_deltas.conf,
+                  "Couldn't change role %" PRIu64 " of member %" PRIu64
+                  " at guild %" PRIu64 ": %s",
+                  rreq->role_id, rreq->delta->user_id, rreq->delta->guild_id,
+                  winecord_strerror(resp->code, client));
+
+    _winecord_role_delta_on_request(client, rreq->delta, rreq->role_id,
+                                    resp->code);
+}
+
+/* add or remove a single role of the member */
+static void
+_winecord_role_delta_send_role(struct _winecord_role_delta *delta,
+                               const struct _winecord_role_change *change)
+{
+    struct winecord *client = delta->client;
+    struct _winecord_role_request *rreq = malloc(sizeof *rreq);
+    struct winecord_ret ret = {
+        .data = rreq,
+        .cleanup = &_winecord_role_request_cleanup,
+        .done = &_winecord_role_request_on_done,
+        .fail = &_winecord_role_request_on_fail,
+    };
+    struct winecord_attributes attr = { 0 };
+    WINEBERRYcode code;
+
+    ASSERT_S(rreq != NULL, "Out of memory");
+    rreq->delta = delta;
+    rreq->role_id = change->role_id;
+
+    WINECORD_ATTR_BLANK_INIT(attr, &ret, delta->reason);
+
+    code = winecord_rest_run(&client->rest, &attr, NULL,
+                            change->is_added ? HTTP_PUT : HTTP_DELETE,
+                            "/guilds/%" PRIu64 "/members/%" PRIu64
+                            "/roles/%" PRIu64,
+                            delta->guild_id, delta->user_id, change->role_id);
+    if (code != WINEBERRY_PENDING) {
+        /* the request has been refused before referencing `rreq` */
+        free(rreq);
+        _winecord_role_delta_on_request(client, delta, change->role_id,
+                                        code);
+    }
+}
+
+/* fetch the member's current roles, a cached copy would have the member
+ *      modify undo changes made since it's been cached */
+static WINEBERRYcode
+_winecord_role_delta_get_member(struct _winecord_role_delta *delta)
+{
+    struct winecord_ret_guild_member ret = {
+        .data = delta,
+        .done = &_winecord_role_delta_on_member,
+        .fail = &_winecord_role_delta_on_fail,
+    };
+    struct winecord_attributes attr = { 0 };
+
+    WINECORD_ATTR_INIT(attr, winecord_guild_member, &ret, NULL);
+    attr.dispatch.skip_cache = true;
+
+    return winecord_rest_run(&delta->client->rest, &attr, NULL, HTTP_GET,
+                            "/guilds/%" PRIu64 "/members/%" PRIu64,
+                            delta->guild_id, delta->user_id);
+}
+
+/* send the changes as a request per role if they're few enough, otherwise
+ *      fetch the member so that they are applied to its current roles */
+static void
+_winecord_role_delta_send(struct _winecord_role_delta *delta)
+{
+    struct winecord *client = delta->client;
+    struct winecord_role_deltas *deltas = &client->rest.role_deltas;
+    /* the last change of a role is the one that decides it */
+    struct _winecord_role_change net[WINECORD_ROLE_CHANGES_SINGLE_MAX];
+    int n_net = 0;
+    bool is_per_role = true;
+    WINEBERRYcode code;
+
+    pthread_mutex_lock(&deltas->lock);
+    for (int i = delta->n_sending - 1; i >= 0; --i) {
+        const struct _winecord_role_change *change = delta->array + i;
+        int j = 0;
+
+        while (j < n_net && net[j].role_id != change->role_id)
+            ++j;
+        if (j < n_net) continue;
+
+        if (WINECORD_ROLE_CHANGES_SINGLE_MAX == n_net) {
+            /* cheaper to fetch and modify the member */
+            is_per_role = false;
+            break;
+        }
+        net[n_net].role_id = change->role_id;
+        net[n_net].is_added = change->is_added;
+        ++n_net;
+    }
+    if (is_per_role) delta->n_requests = n_net;
+    pthread_mutex_unlock(&deltas->lock);
+
+    if (is_per_role) {
+        for (int i = 0; i < n_net; ++i)
+            _winecord_role_delta_send_role(delta, net + i);
+        return;
+    }
+
+    code = _winecord_role_delta_get_member(delta);
+    if (code != WINEBERRY_PENDING)
+        _winecord_role_delta_complete(client, delta, code);
+}
+
+/* send the changes whose window has elapsed */
+static void
+_winecord_role_deltas_sweep_cb(struct winecord *client,
+                               struct winecord_timer *timer)
+{
+    (void)timer;
+    struct winecord_role_deltas *deltas = &client->rest.role_deltas;
+    const u64unix_ms now = winecord_timestamp(client);
+    QUEUE(struct _winecord_role_delta) queue, *qelem;
+    u64unix_ms next = 0;
+
+    QUEUE_INIT(&queue);
+
+    pthread_mutex_lock(&deltas->lock);
+    deltas->is_scheduled = false;
+    for (int i = 0; i < deltas->members.capacity; ++i) {
+        struct _winecord_role_deltas_entry *entry =
+            deltas->members.buckets + i;
+        struct _winecord_role_delta *delta;
+
+        if (CHASH_FILLED != entry->state) continue;
+
+        delta = entry->value;
+        if (delta->is_busy) continue;
+        if (delta->deadline <= now) {
+            delta->is_busy = true;
+            delta->n_sending = delta->size;
+            QUEUE_INSERT_TAIL(&queue, &delta->entry);
+        }
+        else if (!next || delta->deadline < next) {
+            next = delta->deadline;
+        }
+    }
+    if (next) _winecord_role_deltas_schedule(client, next - now);
+    pthread_mutex_unlock(&deltas->lock);
+
+    while (!QUEUE_EMPTY(&queue)) {
+        qelem = QUEUE_HEAD(&queue);
+        QUEUE_REMOVE(qelem);
+        QUEUE_INIT(qelem);
+        _winecord_role_delta_send(
+            QUEUE_DATA(qelem, struct _winecord_role_delta, entry));
+    }
+}
+
+/* @note must be called with the role changes lock held */
+static void
+_winecord_role_deltas_schedule(struct winecord *client, u64unix_ms delay_ms)
+{
+    struct winecord_role_deltas *deltas = &client->rest.role_deltas;
+
+    if (deltas->is_scheduled) return;
+
+    deltas->is_scheduled = true;
+    /* changes are sent from the first `REST` thread, so that they are
+     *      coalesced whether or not the Gateway is running */
+    _winecord_timer_ctl(client, &client->rest.shards->timers,
+                       &(struct winecord_timer){
+                           .on_tick = &_winecord_role_deltas_sweep_cb,
+                           .delay = (int64_t)delay_ms,
+                           .flags = WINECORD_TIMER_DELETE_AUTO,
+                       });
+}
+
+bool
+winecord_role_deltas_coalesce(struct winecord *client,
+                              u64snowflake guild_id,
+                              u64snowflake user_id,
+                              u64snowflake role_id,
+                              bool is_added,
+                              const char reason[],
+                              struct winecord_ret *ret)
+{
+    struct winecord_role_deltas *deltas = &client->rest.role_deltas;
+    const u64unix_ms window =
+        __atomic_load_n(&deltas->window, __ATOMIC_RELAXED);
+    struct _winecord_role_delta *delta = NULL;
+    struct _winecord_role_change *change;
+    char key[48];
+    int found;
+
+    /* the caller is expecting the change to be performed on its own */
+    if (!window || (ret && (ret->sync || ret->future))) return false;
+
+    snprintf(key, sizeof(key), "%" PRIu64 ":%" PRIu64, guild_id, user_id);
+
+    pthread_mutex_lock(&deltas->lock);
+    found = chash_contains(&deltas->members, key, found, ROLES_TABLE);
+    if (found) {
+        delta = chash_lookup(&deltas->members, key, delta, ROLES_TABLE);
+    }
+    else {
+        delta = calloc(1, sizeof *delta);
+        delta->client = client;
+        memcpy(delta->key, key, sizeof(delta->key));
+        delta->guild_id = guild_id;
+        delta->user_id = user_id;
+        QUEUE_INIT(&delta->entry);
+        chash_assign(&deltas->members, delta->key, delta, ROLES_TABLE);
+    }
+
+    if (delta->size == delta->realsize) {
+        int realsize = delta->realsize ? delta->realsize * 2 : 4;
+        void *tmp =
+            realloc(delta->array, (size_t)realsize * sizeof *delta->array);
+        ASSERT_S(tmp != NULL, "Out of memory");
+
+        delta->array = tmp;
+        delta->realsize = realsize;
+    }
+    change = delta->array + delta->size++;
+    memset(change, 0, sizeof *change);
+    change->role_id = role_id;
+    change->is_added = is_added;
+    change->code = WINEBERRY_PENDING;
+    if (ret) {
+        change->ret = *ret;
+        /* kept alive until the change's requests complete */
+        winecord_refcounter_hold_ret(&client->refcounter, &change->ret);
+    }
+    if (!delta->reason && reason) delta->reason = strdup(reason);
+
+    /* the window starts from the first change waiting to be sent */
+    if (!delta->is_busy && delta->size == 1) {
+        delta->deadline = winecord_timestamp(client) + window;
+        _winecord_role_deltas_schedule(client, window);
+    }
+    pthread_mutex_unlock(&deltas->lock);
+
+    return true;
+}
@@ -0,0 +1,329 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "winecord.h"
+#include "winecord-internal.h"
+#include "winecord-request.h"
+#include "winecord-rest.h"
+
+#define CHASH_BUCKETS_FIELD buckets
+#include "chash.h"
+
+/* chash heap-mode (auto-increase hashtable) */
+#define WEBHOOKS_TABLE_HEAP   1
+#define WEBHOOKS_TABLE_BUCKET struct _winecord_webhooks_entry
+#define WEBHOOKS_TABLE_FREE_KEY(_key)
+#define WEBHOOKS_TABLE_HASH(_key, _hash) ((intptr_t)(_key))
+#define WEBHOOKS_TABLE_FREE_VALUE(_value) _winecord_webhook_cleanup(_value)
+#define WEBHOOKS_TABLE_COMPARE(_cmp_a, _cmp_b) (_cmp_a == _cmp_b)
+#define WEBHOOKS_TABLE_INIT(entry, _key, _value)                              \
+    chash_default_init(entry, _key, _value)
+
+/** max amount of embeds per message */
+#define WINECORD_WEBHOOK_EMBEDS_MAX 10
+/** max amount of characters shared by a message's embeds */
+#define WINECORD_WEBHOOK_CHARS_MAX 6000
+/** initial size of an embed's serialization buffer */
+#define WINECORD_WEBHOOK_EMBED_LEN 4096
+
+/** @brief A serialized embed waiting to be sent */
+struct _winecord_webhook_embed {
+    /** the embed's JSON */
+    char *json;
+    /** `json` length */
+    size_t size;
+    /** characters that count towards the message's limit */
+    size_t chars;
+    /** entry for the webhook's queue */
+    QUEUE entry;
+};
+
+/** @brief A webhook's queue */
+struct _winecord_webhook {
+    /** the webhook's id */
+    u64snowflake id;
+    /** the webhook's token, replaced if pushed to with another one */
+    char *token;
+    /** embeds waiting to be sent */
+    QUEUE(struct _winecord_webhook_embed) queue;
+    /** embeds of the message in flight */
+    int n_sending;
+    /** `true` while a message is in flight, so embeds pushed in the meantime
+     *      are merged into the next one */
+    bool is_busy;
+};
+
+struct _winecord_webhooks_entry {
+    /** the webhook's id */
+    u64snowflake key;
+    /** the webhook's queue @note kept at the heap, as its address is
+     *      referenced by its message in flight */
+    struct _winecord_webhook *value;
+    /** the entry state in the hashtable (see chash.h 'State enums') */
+    int state;
+};
+
+/** @brief Embeds merged into a single message */
+struct _winecord_webhook_batch {
+    struct _winecord_webhook_embed *array[WINECORD_WEBHOOK_EMBEDS_MAX];
+    int size;
+};
+
+static void
+_winecord_webhook_embed_free(struct _winecord_webhook_embed *embed)
+{
+    free(embed->json);
+    free(embed);
+}
+
+static void
+_winecord_webhook_cleanup(struct _winecord_webhook *webhook)
+{
+    QUEUE(struct _winecord_webhook_embed) queue, *qelem;
+
+    QUEUE_MOVE(&webhook->queue, &queue);
+    while (!QUEUE_EMPTY(&queue)) {
+        qelem = QUEUE_HEAD(&queue);
+        QUEUE_REMOVE(qelem);
+        _winecord_webhook_embed_free(
+            QUEUE_DATA(qelem, struct _winecord_webhook_embed, entry));
+    }
+    free(webhook->token);
+    free(webhook);
+}
+
+void
+winecord_webhooks_init(struct winecord_webhooks *webhooks,
+                       struct logconf *conf)
+{
+    logconf_branch(&webhooks->conf, conf, "WINECORD_WEBHOOKS");
+
+    __chash_init(&webhooks->queues, WEBHOOKS_TABLE);
+
+    ASSERT_S(!pthread_mutex_init(&webhooks->lock, NULL),
+             "Couldn't initialize webhook queues mutex");
+}
+
+void
+winecord_webhooks_cleanup(struct winecord_webhooks *webhooks)
+{
+    __chash_free(&webhooks->queues, WEBHOOKS_TABLE);
+    pthread_mutex_destroy(&webhooks->lock);
+}
+
+#define _LEN(_str) ((_str) ? strlen(_str) : 0)
+
+/* bytes are counted rather than characters, which errs on the safe side */
+static size_t
+_winecord_embed_count_chars(const struct winecord_embed *embed)
+{
+    size_t chars = _LEN(embed->title) + _LEN(embed->description);
+
+    if (embed->footer) chars += _LEN(embed->footer->text);
+    if (embed->author) chars += _LEN(embed->author->name);
+    if (embed->fields)
+        for (int i = 0; i < embed->fields->size; ++i)
+            chars += _LEN(embed->fields->array[i].name)
+                     + _LEN(embed->fields->array[i].value);
+
+    return chars;
+}
+
+#undef _LEN
+
+static struct _winecord_webhook_embed *
+_winecord_webhook_embed_create(const struct winecord_embed *embed)
+{
+    struct _winecord_webhook_embed *new_embed = calloc(1, sizeof *new_embed);
+    size_t size = WINECORD_WEBHOOK_EMBED_LEN;
+
+    while (1) {
+        void *tmp = realloc(new_embed->json, size);
+        ASSERT_S(tmp != NULL, "Out of memory");
+
+        new_embed->json = tmp;
+        if ((new_embed->size = winecord_embed_to_json(tmp, size, embed)))
+            break;
+        /* an embed is capped at 6000 characters, something went wrong */
+        if (size >= 16 * WINECORD_WEBHOOK_EMBED_LEN) {
+            _winecord_webhook_embed_free(new_embed);
+            return NULL;
+        }
+        size *= 2;
+    }
+    new_embed->chars = _winecord_embed_count_chars(embed);
+    QUEUE_INIT(&new_embed->entry);
+
+    return new_embed;
+}
+
+/* write `{"embeds":[...]}` out of the already serialized embeds */
+static size_t
+_winecord_webhook_batch_to_json(char buf[], size_t size, const void *p_batch)
+{
+    const struct _winecord_webhook_batch *batch = p_batch;
+    size_t len = sizeof("{\"embeds\":[]}") - 1 + (size_t)batch->size - 1;
+    char *p = buf;
+
+    for (int i = 0; i < batch->size; ++i)
+        len += batch->array[i]->size;
+    if (len >= size) return 0;
+
+    memcpy(p, "{\"embeds\":[", sizeof("{\"embeds\":[") - 1);
+    p += sizeof("{\"embeds\":[") - 1;
+    for (int i = 0; i < batch->size; ++i) {
+        if (i) *p++ = ',';
+        memcpy(p, batch->array[i]->json, batch->array[i]->size);
+        p += batch->array[i]->size;
+    }
+    memcpy(p, "]}", sizeof("]}"));
+
+    return len;
+}
+
+static void _winecord_webhook_flush(struct winecord *client,
+                                    struct _winecord_webhook *webhook);
+
+static void
+_winecord_webhook_on_done(struct winecord *client,
+                          struct winecord_response *resp)
+{
+    _winecord_webhook_flush(client, resp->data);
+}
+
+static void
+_winecord_webhook_on_fail(struct winecord *client,
+                          struct winecord_response *resp)
+{
+    struct winecord_webhooks *webhooks = &client->rest.webhooks;
+    struct _winecord_webhook *webhook = resp->data;
+
+    logconf_error(&webhooks->conf,
+                  "Couldn't send %d embed(s) to webhook %" PRIu64 ": %s",
+                  webhook->n_sending, webhook->id,
+                  winecord_strerror(resp->code, client));
+
+    /* client is being cleaned up, remaining embeds are dropped */
+    if (WINEBERRY_WINECORD_CANCELED == resp->code) return;
+
+    _winecord_webhook_flush(client, webhook);
+}
+
+/* send the next message out of the webhook's queue, merging as many embeds
+ *      as a single message allows
+ * @note the webhook must have been marked as busy by the caller */
+static void
+_winecord_webhook_flush(struct winecord *client,
+                        struct _winecord_webhook *webhook)
+{
+    struct winecord_webhooks *webhooks = &client->rest.webhooks;
+    struct _winecord_webhook_batch batch = { 0 };
+    struct winecord_attributes attr = { 0 };
+    struct winecord_ret ret = {
+        .data = webhook,
+        .done = &_winecord_webhook_on_done,
+        .fail = &_winecord_webhook_on_fail,
+    };
+    size_t chars = 0;
+    char *token = NULL;
+    WINEBERRY code;
+
+    pthread_mutex_lock(&webhooks->lock);
+    while (!QUEUE_EMPTY(&webhook->queue)
+           && batch.size < WINECORD_WEBHOOK_EMBEDS_MAX)
+    {
+        QUEUE(struct _winecord_webhook_embed) *qelem =
+            QUEUE_HEAD(&webhook->queue);
+        struct _winecord_webhook_embed *embed =
+            QUEUE_DATA(qelem, struct _winecord_webhook_embed, entry);
+
+        if (batch.size && chars + embed->chars > WINECORD_WEBHOOK_CHARS_MAX)
+            break;
+
+        chars += embed->chars;
+        QUEUE_REMOVE(qelem);
+        batch.array[batch.size++] = embed;
+    }
+    webhook->n_sending = batch.size;
+    if (!(webhook->is_busy = batch.size != 0)) {
+        pthread_mutex_unlock(&webhooks->lock);
+        return;
+    }
+    token = strdup(webhook->token);
+    pthread_mutex_unlock(&webhooks->lock);
+
+    attr.builder.to_json = &_winecord_webhook_batch_to_json;
+    attr.builder.params = &batch;
+
+    WINECORD_ATTR_BLANK_INIT(attr, &ret, NULL);
+
+    /* the body is serialized at once, so the batch can be freed after */
+    code = winecord_rest_run(&client->rest, &attr, NULL, HTTP_POST,
+                             "/webhooks/%" PRIu64 "/%s%s", webhook->id,
+                             token, "");
+    if (code != WINEBERRY_OK) {
+        logconf_error(&webhooks->conf,
+                      "Couldn't send %d embed(s) to webhook %" PRIu64 ": %s",
+                      batch.size, webhook->id,
+                      winecord_strerror(code, client));
+
+        /* the next push sends the remaining embeds */
+        pthread_mutex_lock(&webhooks->lock);
+        webhook->is_busy = false;
+        pthread_mutex_unlock(&webhooks->lock);
+    }
+
+    for (int i = 0; i < batch.size; ++i)
+        _winecord_webhook_embed_free(batch.array[i]);
+    free(token);
+}
+
+WINEBERRY
+winecord_rest_webhook_push(struct winecord *client,
+                           u64snowflake webhook_id,
+                           const char webhook_token[],
+                           const struct winecord_embed *embed)
+{
+    struct winecord_webhooks *webhooks = &client->rest.webhooks;
+    struct _winecord_webhook_embed *new_embed;
+    struct _winecord_webhook *webhook;
+    bool should_flush;
+    int ret;
+
+    WINEBERRY_EXPECT(client, webhook_id != 0, WINEBERRY_BAD_PARAMETER, "");
+    WINEBERRY_EXPECT(client, NOT_EMPTY_STR(webhook_token),
+                     WINEBERRY_BAD_PARAMETER, "");
+    WINEBERRY_EXPECT(client, embed != NULL, WINEBERRY_BAD_PARAMETER, "");
+
+    if (!(new_embed = _winecord_webhook_embed_create(embed))) {
+        logconf_error(&webhooks->conf, "Embed couldn't be formed");
+        return WINEBERRY_MALFORMED_PAYLOAD;
+    }
+
+    pthread_mutex_lock(&webhooks->lock);
+    ret = chash_contains(&webhooks->queues, webhook_id, ret, WEBHOOKS_TABLE);
+    if (ret) {
+        webhook = chash_lookup(&webhooks->queues, webhook_id, webhook,
+                               WEBHOOKS_TABLE);
+        if (strcmp(webhook->token, webhook_token)) {
+            free(webhook->token);
+            webhook->token = strdup(webhook_token);
+        }
+    }
+    else {
+        webhook = calloc(1, sizeof *webhook);
+        webhook->id = webhook_id;
+        webhook->token = strdup(webhook_token);
+        QUEUE_INIT(&webhook->queue);
+        chash_assign(&webhooks->queues, webhook_id, webhook, WEBHOOKS_TABLE);
+    }
+    QUEUE_INSERT_TAIL(&webhook->queue, &new_embed->entry);
+    /* reserve the webhook, so that a single message is in flight */
+    if ((should_flush = !webhook->is_busy)) webhook->is_busy = true;
+    pthread_mutex_unlock(&webhooks->lock);
+
+    if (should_flush) _winecord_webhook_flush(client, webhook);
+
+    return WINEBERRY_OK;
+}
@@ -740,10 +740,13 @@ event_loop(struct winecord_voice *vc)
 {
     struct WINECORD *client = vc->p_client;
     uint64_t tstamp;
+    CURL *ehandle;
 
     /* everything goes well, ws event_loop to serve */
     /* the ws server side events */
-    ws_start(vc->ws);
+    ehandle = ws_start(vc->ws);
+    if (winecord_global_share())
+        curl_easy_setopt(ehandle, CURLOPT_SHARE, winecord_global_share());
     while (1) {
         /* break on severed connection */
         if (!ws_easy_run(vc->ws, 5, &tstamp)) break;
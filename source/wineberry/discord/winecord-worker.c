@@ -57,10 +57,6 @@ _winecord_worker_cb(void *p_cxt)
 {
     struct winecord_worker_context *cxt = p_cxt;
 
-    pthread_mutex_lock(&cxt->client->workers->lock);
-    ++cxt->client->workers->count;
-    pthread_mutex_unlock(&cxt->client->workers->lock);
-
     cxt->callback(cxt->data);
 
     pthread_mutex_lock(&cxt->client->workers->lock);
@@ -79,9 +75,22 @@ winecord_worker_add(struct winecord *client,
     struct winecord_worker_context *cxt = malloc(sizeof *cxt);
     *cxt = (struct winecord_worker_context){ client, data, callback };
 
-    return 0 == threadpool_add(g_tpool, _winecord_worker_cb, cxt, 0)
-               ? WINEBERRY_OK
-               : WINEBERRY_FULL_WORKER;
+    /* tasks are counted as soon as they're queued, so that
+     *      winecord_worker_join() also waits on the ones yet to be started */
+    pthread_mutex_lock(&client->workers->lock);
+    ++client->workers->count;
+    pthread_mutex_unlock(&client->workers->lock);
+
+    if (0 == threadpool_add(g_tpool, _winecord_worker_cb, cxt, 0))
+        return WINEBERRY_OK;
+
+    pthread_mutex_lock(&client->workers->lock);
+    --client->workers->count;
+    pthread_cond_signal(&client->workers->cond);
+    pthread_mutex_unlock(&client->workers->lock);
+    free(cxt);
+
+    return WINEBERRY_FULL_WORKER;
 }
 
 WINEBERRYcode